@@ -14,19 +14,22 @@
 #include <unistd.h>
 #include <sys/stat.h>
 #include <webpage.h>
-#include <lqueue.h>
-#include <lhash.h>
 #include <pageio.h>
 #include <pthread.h>
+#include <typed.h>
 
-#define hsize 1000    // hashtable size
+#define URL_BATCH 64    // links taken from a page at a time
+
+/* pages to crawl, and the id each url seen was saved under; both are 
+ * guarded by crawl_mutex */
+TYPED_QUEUE(frontier, webpage_t*)
+TYPED_MAP(urls, char*, int, typed_strhash, typed_streq)
 
 static void crawl(int thread_id);
-static bool searchfn(void* elementp, const void* searchkeyp);
 static void* thread_start(void *arg);
 
-lqueue_t *qp;
-lhash_t *hp;
+frontier_t frontier;
+urls_t seen;
 char *seed_url, *dirname;
 int max_depth, pages_added=1, pages_retrieved=0, id=1;
 pthread_mutex_t crawl_mutex = PTHREAD_MUTEX_INITIALIZER;
@@ -61,6 +64,11 @@ int main(int argc, char *argv[]){
         }
     }
 
+    if(!webpage_init()){
+        printf("Error! Failed to initialize curl.\n");
+        exit(EXIT_FAILURE);
+    }
+
     /* initialize seed_page */
     webpage_t *seed_page;
     if(!(seed_page=webpage_new(seed_url,0,NULL))){
@@ -74,10 +82,12 @@ int main(int argc, char *argv[]){
         exit(EXIT_FAILURE);
     }
     
-    qp = lqopen();
-    hp = lhopen(hsize);
-    lqput(qp,seed_page);
-    lhput(hp,seed_url,seed_url,strlen(seed_url));
+    int *seed_id = urls_insert(&seen,seed_url,NULL);
+    if(frontier_put(&frontier,seed_page) != 0 || !seed_id){
+        printf("Error! Out of memory.\n");
+        exit(EXIT_FAILURE);
+    }
+    *seed_id = id;
     pagesave(seed_page,id++,dirname);
     /**********************************************************************/
 
@@ -98,67 +108,84 @@ int main(int argc, char *argv[]){
     }
     /**********************************************************************/
 
-    lhclose(hp);
-    lqclose(qp);
+    int i = 0;
+    for (urls_slot_t *s; (s = urls_next(&seen, &i)); )
+        free(s->key);
+    urls_free(&seen);
+    frontier_free(&frontier);
     pthread_mutex_destroy(&crawl_mutex);
+    webpage_cleanup();
     exit(EXIT_SUCCESS);
 }
 
 static void crawl(int thread_id){
-    int pos = 0, depth = 0;
+    int pos = 0, depth = 0, n;
     webpage_t *page, *curr;
-    char *url;
+    char *url, *urls[URL_BATCH];
     int status;
     //printf("id: %d entry\n", thread_id);
 
     /* BFS */
-    while((curr=(webpage_t*)lqget(qp)) || (pages_retrieved<pages_added)){
-        if(!curr) {
+    while(true){
+        pthread_mutex_lock(&crawl_mutex);
+        bool got = frontier_get(&frontier, &curr);
+        bool pending = pages_retrieved < pages_added;
+        pthread_mutex_unlock(&crawl_mutex);
+        if(!got) {
+            if(!pending)
+                break;
             continue;
         }
         pos = 0, depth = 0;
         depth = webpage_getDepth(curr);
 
-        /* crawl page and retrieve all urls */
-        while (depth<max_depth && (pos = webpage_getNextURL(curr, pos, &url)) > 0) {
-            printf("Thread %d Found url: %s ", thread_id, url);
+        /* crawl page and retrieve all urls, a batch at a time */
+        while (depth<max_depth && (n = webpage_getURLs(curr, &pos, urls, URL_BATCH)) > 0) {
+            for (int u = 0; u < n; u++) {
+                url = urls[u];
+                printf("Thread %d Found url: %s ", thread_id, url);
             
-            if(IsInternalURL(url)) {
-                printf("[internal]\n");
-                pthread_mutex_lock(&crawl_mutex); /*!******!*/
-                if (lhsearch(hp, searchfn, url, strlen(url)) == NULL){
-                    if(!(page=webpage_new(url,depth+1,NULL))) {
-                        printf("Error! Failed to initialize internal webpage.\n");
-                        exit(EXIT_FAILURE);
+                if(IsInternalURL(url)) {
+                    printf("[internal]\n");
+                    pthread_mutex_lock(&crawl_mutex); /*!******!*/
+                    if (urls_find(&seen, url) == NULL){
+                        if(!(page=webpage_new(url,depth+1,NULL))) {
+                            printf("Error! Failed to initialize internal webpage.\n");
+                            exit(EXIT_FAILURE);
+                        }
+
+                        if(!webpage_fetch(page)) {
+                            printf("Error! Failed to fetch html from internal page.\n");
+                            pthread_mutex_unlock(&crawl_mutex);
+                            free(url);
+                            webpage_delete(page);
+                            continue;
+                        }
+                    
+                        int *idp = urls_insert(&seen, url, NULL);
+                        if (frontier_put(&frontier, page) != 0 || idp == NULL) {
+                            printf("Error! Out of memory.\n");
+                            exit(EXIT_FAILURE);
+                        }
+                        pages_added++;
+                        *idp = id;
+                        status = pagesave(page, id++, dirname);
+                        pthread_mutex_unlock(&crawl_mutex); /*!******!*/
+                        if (status!=0){
+                            exit(EXIT_FAILURE);
+                        }
                     }
-
-                    if(!webpage_fetch(page)) {
-                        printf("Error! Failed to fetch html from internal page.\n");
+                    else{
                         pthread_mutex_unlock(&crawl_mutex);
+                        printf("[url: %s already in queue]\n",url);
                         free(url);
-                        webpage_delete(page);
-                        continue;
-                    }
-                    
-                    lqput(qp, page);
-                    pages_added++;
-                    lhput(hp,url,url,strlen(url));
-                    status = pagesave(page, id++, dirname);
-                    pthread_mutex_unlock(&crawl_mutex); /*!******!*/
-                    if (status!=0){
-                        exit(EXIT_FAILURE);
                     }
                 }
                 else{
-                    pthread_mutex_unlock(&crawl_mutex);
-                    printf("[url: %s already in queue]\n",url);
+                    printf("[external]\n");
                     free(url);
                 }
             }
-            else{
-                printf("[external]\n");
-                free(url);
-            }
         }
         pthread_mutex_lock(&crawl_mutex);
         pages_retrieved++;
@@ -169,11 +196,6 @@ static void crawl(int thread_id){
     //printf("added: %d, retrieved: %d\n",pages_added, pages_retrieved);
 }
 
-static bool searchfn(void* elementp, const void* searchkeyp){
-    char *p = (char*)elementp;
-    return strcmp(p,(char*)searchkeyp) == 0;
-}
-
 static void *thread_start(void *arg) {
     int thread_id = (intptr_t)arg;
     crawl(thread_id);
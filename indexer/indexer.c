@@ -9,45 +9,58 @@
  * data structure that can be used to look up a word and find out 1) which documents (in the crawler 
  * directory) contain the word, and 2) how many times the word occurs in that document.  
  * 
+ * With -u the indexer is incremental: only pages newer than the last 
+ * indexed document are indexed, into a new immutable segment that is 
+ * appended to the index manifest (see segment.h). 
+ * 
+ * With -m <megabytes> the in-memory index is bounded: whenever it grows 
+ * past the budget it is saved as a sorted run <indexnm>.runN and emptied, 
+ * and the runs are merged into the final index at the end (see indexmerge.h). 
+ * 
+ * With -p the position of every occurrence of a word is recorded too and 
+ * saved next to the index in <indexnm>.pos (see posio.h), which lets the 
+ * querier answer phrase queries. 
+ * 
  */
 
 #include <stdio.h>
 #include <string.h>
-#include <ctype.h>
 #include <stdlib.h>
 #include <sys/stat.h>
 #include <dirent.h>
 #include <pageio.h>
 #include <indexio.h>
+#include <segment.h>
+#include <indexmerge.h>
+#include <posio.h>
 #include <hash.h>
 #include <queue.h>
+#include <typed.h>
 
 #define hsize 1000    // hashtable size
+#define WORD_BATCH 256  // words taken from a page at a time
 
-static int total_count = 0;
+/* the entry of a word and its last document; pages are indexed in 
+ * increasing id order, so the page being indexed is either that 
+ * document or not yet among the word's documents */
+typedef struct latest {
+	entry_t *entry;
+	document_t *doc;
+} latest_t;
 
-/* searches for entry in the hash table */
-static bool entry_searchfn(void *elementp, const void *searchkeyp){
-    entry_t *ep = (entry_t*)elementp;
-    return strcmp(ep->word,(char*)searchkeyp) == 0;
-}
-
-/* searches for document in queue */
-static bool doc_searchfn(void *elementp, const void *id){
-	document_t *dp = (document_t*)elementp;
-	return dp->id == *(int*)id;
-}
+/* words of the index -> latest_t, keyed by the word of the entry */
+TYPED_MAP(words, char*, latest_t, typed_strhash, typed_streq)
 
 /* total word count in the queue ie. word count for a specific word */
-static void queue_sum_fn(void* elementp){
+static void queue_sum_fn(void* elementp, void *total){
 	document_t *dp = (document_t*)elementp;
-	total_count+=dp->word_count;
+	*(int*)total += dp->word_count;
 }
 
 /* total word count */
-static void total_sum_fn(void* ep){
+static void total_sum_fn(void* ep, void *total){
 	entry_t *p = (entry_t*)ep;
-	qapply(p->documents,queue_sum_fn);
+	qapply_arg(p->documents,queue_sum_fn,total);
 }
 
 static int compare_func(const void *a, const void *b){
@@ -64,48 +77,86 @@ static int compare_func(const void *a, const void *b){
 	}
 }
 
-static void NormalizeWord(char *word){
-	if(!word)
-		return;
-	
-	int len = strlen(word);
-
-	if(len < 3){
-		word[0] = '\0';
-	}
+/* records position as the last of the word_count positions of dp; the 
+ * array, in arena, doubles whenever the count passes a power of two
+ */
+static void add_position(arena_t *arena, document_t *dp, int position){
+	int recorded = dp->word_count - 1;
 
-	int i;
-	for(i=0; i<len; i++){
-		if(!isalpha(word[i])){
-			word[0] = '\0';
-			return;
+	if(recorded == 0 || (recorded & (recorded - 1)) == 0){
+		int size = recorded ? 2*recorded : 1;
+		dp->positions = arenagrow(arena, dp->positions, recorded * sizeof(int), size * sizeof(int));
+		if(dp->positions == NULL){
+			printf("Error: out of memory recording positions\n");
+			exit(EXIT_FAILURE);
 		}
-		word[i] = tolower(word[i]);
 	}
+	dp->positions[recorded] = position;
 }
 
-int main(int argc, char *argv[]){
-	if (argc!=3){
-		printf("usage: indexer <pagedir> <indexnm>\n");
-		exit(EXIT_FAILURE);
-	}
+/* adds every word of page id to the index, with its positions if asked; 
+ * everything is allocated in the arena of the index, and words holds 
+ * its entries
+ */
+static void index_page(hashtable_t *index, words_t *words, webpage_t *page, int id, bool positions){
+	arena_t *arena = harena(index);
+	int pos = 0, position = 0, n;
+	wordslice_t slices[WORD_BATCH];
+	char *word, *lower = malloc(webpage_getHTMLlen(page) + 1);
+	entry_t *ep;
+	document_t *dp;
+	latest_t *lp;
 
-	char *dirname = argv[1];
-	struct stat st_dir;
-	
-	/* check if <pagedir> exists */
-	if (stat(dirname, &st_dir) != 0 || !S_ISDIR(st_dir.st_mode)){
-		printf("Error: %s doesn't exist\n", dirname);
+	if(lower == NULL){
+		printf("Error: out of memory indexing page %d\n", id);
 		exit(EXIT_FAILURE);
 	}
+	/* the words come lowercased, in lower; those under 3 letters are
+	 * not indexed */
+	while((n=webpage_getWords(page,&pos,slices,WORD_BATCH,lower)) > 0){
+		for(int i=0; i<n; i++){
+			if(slices[i].len < 3)
+				continue;
+			word = lower + slices[i].offset;
+			if ((lp = words_find(words, word))){
+				if(lp->doc->id == id){
+					dp = lp->doc;
+					dp->word_count = dp->word_count + 1;
+				}
+				else{
+					dp = new_doc_arena(arena,id,1);
+					if(dp == NULL || qput(lp->entry->documents,dp) != 0){
+						printf("Error: out of memory indexing page %d\n", id);
+						exit(EXIT_FAILURE);
+					}
+					lp->doc = dp;
+				}
+			}
+			else{
+				ep = new_entry_arena(arena,word);
+				dp = new_doc_arena(arena,id,1);
+				if (ep == NULL || dp == NULL || qput(ep->documents,dp) != 0 ||
+				    hput(index, ep, word, slices[i].len) != 0 ||
+				    (lp = words_insert(words, ep->word, NULL)) == NULL){
+					printf("Error: out of memory indexing page %d\n", id);
+					exit(EXIT_FAILURE);
+				}
+				lp->entry = ep;
+				lp->doc = dp;
+			}
+			if(positions)
+				add_position(arena, dp, position);
+			position++;
+		}
+	}
+	free(lower);
+}
 
-	hashtable_t *index = hopen(hsize);
-	webpage_t *page;
+/* reads the page ids in dirname into a sorted array, returns the count */
+static int list_pages(char *dirname, int **files){
 	DIR *dir;
 	struct dirent *dir_entry;
-	int count= 0;
-	int *files = NULL;
-
+	int count = 0;
 
 	/* open directory */
 	dir = opendir(dirname);
@@ -115,67 +166,226 @@ int main(int argc, char *argv[]){
 	}
 
 	/* add file ids to array */
+	*files = NULL;
 	while ((dir_entry=readdir(dir)) !=NULL){
 		if (dir_entry->d_name[0] != '.'){
 			int id = atoi(dir_entry->d_name);
 			count++;
-			files = realloc(files, count* sizeof(int));	
-			files[count-1] = id;
+			*files = realloc(*files, count* sizeof(int));	
+			(*files)[count-1] = id;
 		 } 
 	}
 	closedir(dir);
 
 	/* sort the files in order using compare_func */
-	qsort(files, count, sizeof(int),  compare_func);
+	qsort(*files, count, sizeof(int),  compare_func);
+	return count;
+}
+
+/* removes the manifest, the segments and the positions of a previous 
+ * build of indexnm */
+static void remove_segments(char *indexnm){
+	char path[1024], posnm[1024];
+	segment_t *sp;
+
+	pos_path(indexnm, posnm, sizeof(posnm));
+	remove(posnm);
+	queue_t *segments = manifestload(indexnm);
+	if (segments == NULL)
+		return;
+	while ((sp = qget(segments))){
+		segment_path(indexnm, sp->name, path, sizeof(path));
+		pos_path(path, posnm, sizeof(posnm));
+		remove(posnm);
+		if (strcmp(path, indexnm) != 0)
+			remove(path);
+		free(sp->name);
+		free(sp);
+	}
+	qclose(segments);
+	snprintf(path, sizeof(path), "%s.manifest", indexnm);
+	remove(path);
+}
+
+/* saves the index, and its positions if asked, as sorted run number 
+ * nruns of indexnm
+ * returns: 0 for success; nonzero otherwise
+ */
+static int32_t flush_run(hashtable_t *index, char *indexnm, int nruns, char ***runs, bool positions){
+	char runnm[1024], posnm[1024];
+
+	snprintf(runnm, sizeof(runnm), "%s.run%d", indexnm, nruns);
+	pos_path(runnm, posnm, sizeof(posnm));
+	printf("flushing run: %s ...\n", runnm);
+	if (indexsave(index, runnm) != 0 || (positions && possave(index, posnm) != 0))
+		return 1;
+
+	*runs = realloc(*runs, (nruns+1) * sizeof(char*));
+	(*runs)[nruns] = malloc(strlen(runnm)+1);
+	strcpy((*runs)[nruns], runnm);
+	return 0;
+}
+
+/* removes and frees the run files and their positions */
+static void remove_runs(char **runs, int nruns){
+	char posnm[1024];
+
+	for (int i = 0; i < nruns; i++){
+		pos_path(runs[i], posnm, sizeof(posnm));
+		remove(posnm);
+		remove(runs[i]);
+		free(runs[i]);
+	}
+	free(runs);
+}
+
+/* merges the position files of the runs, which cover increasing ranges 
+ * of ids, into the position file of segnm
+ * returns: 0 for success; nonzero otherwise
+ */
+static int32_t merge_positions(char **runs, int nruns, char *segnm){
+	char posnm[1024];
+	char **inputs = malloc(nruns * sizeof(char*));
+	int32_t status = 0;
+
+	for (int i = 0; i < nruns; i++){
+		inputs[i] = malloc(1024);
+		pos_path(runs[i], inputs[i], 1024);
+	}
+	pos_path(segnm, posnm, sizeof(posnm));
+	status = posconcat(inputs, nruns, posnm);
+	for (int i = 0; i < nruns; i++)
+		free(inputs[i]);
+	free(inputs);
+	return status;
+}
+
+int main(int argc, char *argv[]){
+	bool incremental = false, positions = false;
+	size_t budget = 0;     // bytes; 0 means unbounded
+	int arg;
+	for (arg = 1; arg < argc - 2; arg++){
+		if (strcmp(argv[arg], "-u") == 0){
+			incremental = true;
+		}
+		else if (strcmp(argv[arg], "-p") == 0){
+			positions = true;
+		}
+		else if (strcmp(argv[arg], "-m") == 0 && arg + 1 < argc - 2 && atoi(argv[arg+1]) > 0){
+			budget = (size_t)atoi(argv[++arg]) << 20;
+		}
+		else {
+			break;
+		}
+	}
+	if (argc < 3 || arg != argc - 2){
+		printf("usage: indexer [-u] [-p] [-m <megabytes>] <pagedir> <indexnm>\n");
+		exit(EXIT_FAILURE);
+	}
+
+	char *dirname = argv[argc-2];
+	char *indexnm = argv[argc-1];
+	struct stat st_dir;
+	
+	/* check if <pagedir> exists */
+	if (stat(dirname, &st_dir) != 0 || !S_ISDIR(st_dir.st_mode)){
+		printf("Error: %s doesn't exist\n", dirname);
+		exit(EXIT_FAILURE);
+	}
+
+	webpage_t *page;
+	int *files = NULL;
+	int count = list_pages(dirname, &files);
+	int first = 0;
+	char segnm[1024];
+
+	/* incremental: index only pages newer than the last segment */
+	queue_t *segments = incremental ? manifestload(indexnm) : NULL;
+	if (segments != NULL){
+		int last_id = manifest_lastid(segments);
+		int nsegments = 0;
+		segment_t *sp;
+		while ((sp = qget(segments))){
+			nsegments++;
+			free(sp->name);
+			free(sp);
+		}
+		qclose(segments);
+
+		while (first < count && files[first] <= last_id)
+			first++;
+		if (first == count){
+			printf("Index is up to date (last id: %d)\n", last_id);
+			free(files);
+			exit(EXIT_SUCCESS);
+		}
+		snprintf(segnm, sizeof(segnm), "%s.seg%d", indexnm, nsegments);
+	}
+	else {
+		remove_segments(indexnm);
+		snprintf(segnm, sizeof(segnm), "%s", indexnm);
+	}
+
+	hashtable_t *index = hopen_arena(hsize);
+	words_t words = { NULL, 0, 0 };
+	int total_count = 0;
+	char **runs = NULL;
+	int nruns = 0;
 
 	/* loop over files */
-	for (int i=0; i<count; i++){
+	for (int i=first; i<count; i++){
 		printf("loading page id: %d ...\n", files[i]);
 		page = pageload(files[i], dirname);
 			
 		if(!page)
 			exit(EXIT_FAILURE);
 
-		int pos = 0;
-		char *word;
-		entry_t *ep;
-
-		while((pos=webpage_getNextWord(page,pos,&word)) > 0){
-			NormalizeWord(word);
-			if(word[0]!='\0'){
-				if (hsearch(index, entry_searchfn, word, strlen(word))){
-					ep = (entry_t*)hsearch(index, entry_searchfn, word, strlen(word));
-					document_t *dp;
-					if((dp = qsearch(ep->documents,doc_searchfn,&files[i]))){
-						dp->word_count = dp->word_count + 1;
-					}
-					else{
-						dp = new_doc(files[i],1);
-						qput(ep->documents,dp);
-					}
-				}
-				else{
-					ep = new_entry(word);
-					document_t *dp = new_doc(files[i],1);
-					qput(ep->documents,dp);
-					hput(index, ep, word, strlen(word));
-				}
-				//printf("%s\n",word);
-			}
-			free(word);
-		}
+		index_page(index, &words, page, files[i], positions);
 		printf("page id: %d loaded successfully.\n", files[i]);
 		webpage_delete(page);	
+
+		/* over budget: spill a sorted run to disk, then drop the index 
+		 * with its arena */
+		size_t bytes = arenabytes(harena(index)) + words.size * sizeof(words_slot_t);
+		if (budget > 0 && bytes >= budget){
+			happly_arg(index, total_sum_fn, &total_count);
+			if (flush_run(index, segnm, nruns++, &runs, positions) != 0)
+				exit(EXIT_FAILURE);
+			hclose(index);
+			index = hopen_arena(hsize);
+			words_clear(&words);
+		}
 	}
 
-	happly(index, total_sum_fn);
+	happly_arg(index, total_sum_fn, &total_count);
 	printf("Total word count in hashtable: %d\n", total_count);
 	
-	free(files);
-    if (indexsave(index, argv[2]) != 0){
+	if (nruns > 0){
+		/* merge the runs into the final index */
+		if (words.count > 0 && flush_run(index, segnm, nruns++, &runs, positions) != 0)
+			exit(EXIT_FAILURE);
+		printf("merging %d runs into %s ...\n", nruns, segnm);
+		int32_t status = indexmerge(runs, nruns, NULL, segnm);
+		if (status == 0 && positions)
+			status = merge_positions(runs, nruns, segnm);
+		remove_runs(runs, nruns);
+		if (status != 0)
+			exit(EXIT_FAILURE);
+	}
+	else if (indexsave(index, segnm) != 0){
+		exit(EXIT_FAILURE);
+	}
+	else if (positions){
+		char posnm[1024];
+		pos_path(segnm, posnm, sizeof(posnm));
+		if (possave(index, posnm) != 0)
+			exit(EXIT_FAILURE);
+	}
+	if (count > first && manifestappend(indexnm, segnm, files[first], files[count-1]) != 0){
 		exit(EXIT_FAILURE);
 	}
-	free_entries(index);
+	free(files);
+	words_free(&words);
 	hclose(index);
 	exit(EXIT_SUCCESS);
 }
@@ -0,0 +1,167 @@
+/* merger.c --- merges and compacts saved index files
+ *
+ * Authors: Abdibaset Bare, Ian Kamweru and Nathaniel Mensah
+ * Version: 1.0
+ *
+ * Description: merges several sorted index files into one consolidated
+ * index, streaming the inputs so that memory use does not grow with the
+ * size of the index. With -r the document ids of each input are shifted
+ * past the highest id of the inputs before it (for indices of separate
+ * crawls). With -c the segments listed in the manifest of an index are
+ * compacted into a single base segment, <indexnm>.base<last-id>; the
+ * position files of the segments (see posio.h) are kept if every
+ * segment has one. A merged index has no positions.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <indexmerge.h>
+#include <segment.h>
+#include <posio.h>
+#include <queue.h>
+
+#define MAX_PATH_LEN 1024
+
+static void usage(void){
+	printf("usage: merger [-r] <outindex> <index1> <index2> ...\n");
+	printf("       merger -c <indexnm>\n");
+}
+
+/* compacts every segment of index indexnm into the base segment */
+static int compact(char *indexnm){
+	queue_t *segments = manifestload(indexnm);
+	if (segments == NULL){
+		printf("Error: %s has no manifest\n", indexnm);
+		return 1;
+	}
+
+	char **inputs = NULL, **positions = NULL;
+	int count = 0, first_id = 0, last_id = 0;
+	bool has_positions = true;
+	segment_t *sp;
+	while ((sp = qget(segments))){
+		if (count == 0)
+			first_id = sp->first_id;
+		last_id = sp->last_id;
+		inputs = realloc(inputs, (count+1) * sizeof(char*));
+		inputs[count] = malloc(MAX_PATH_LEN);
+		segment_path(indexnm, sp->name, inputs[count], MAX_PATH_LEN);
+		positions = realloc(positions, (count+1) * sizeof(char*));
+		positions[count] = malloc(MAX_PATH_LEN);
+		pos_path(inputs[count], positions[count], MAX_PATH_LEN);
+		has_positions = has_positions && access(positions[count], R_OK) == 0;
+		count++;
+		free(sp->name);
+		free(sp);
+	}
+	qclose(segments);
+
+	int status = 0;
+	char tmpnm[MAX_PATH_LEN], manifest[MAX_PATH_LEN], tmpmanifest[MAX_PATH_LEN];
+	char segnm[MAX_PATH_LEN], posnm[MAX_PATH_LEN];
+	snprintf(tmpnm, sizeof(tmpnm), "%s.compact", indexnm);
+	snprintf(manifest, sizeof(manifest), "%s.manifest", indexnm);
+	snprintf(tmpmanifest, sizeof(tmpmanifest), "%s.compact.manifest", indexnm);
+	snprintf(segnm, sizeof(segnm), "%s.base%d", indexnm, last_id);
+	pos_path(segnm, posnm, sizeof(posnm));
+	bool fresh = true;
+	for (int i = 0; i < count; i++)
+		fresh = fresh && strcmp(inputs[i], segnm) != 0;
+
+	if (count < 2){
+		printf("Index %s has %d segment(s), nothing to compact\n", indexnm, count);
+	}
+	else if (!fresh){
+		printf("Segment %s is already in the manifest\n", segnm);
+		status = 1;
+	}
+	else {
+		/* the merged segment goes under a name no manifest lists, so until
+		 * the new manifest is renamed over the old one the index is left
+		 * as it was; the old segments are removed only after that */
+		remove(tmpmanifest);
+		status = indexmerge(inputs, count, NULL, segnm);
+		if (status == 0 && has_positions)
+			status = posconcat(positions, count, posnm);
+		if (status == 0)
+			status = manifestappend(tmpnm, segnm, first_id, last_id);
+		if (status == 0 && rename(tmpmanifest, manifest) != 0){
+			printf("Failed to replace %s\n", manifest);
+			status = 1;
+		}
+		if (status == 0){
+			printf("Compacted %d segments into %s\n", count, segnm);
+			for (int i = 0; i < count; i++){
+				if (access(positions[i], F_OK) == 0 && remove(positions[i]) != 0){
+					printf("Failed to remove %s\n", positions[i]);
+					status = 1;
+				}
+				if (remove(inputs[i]) != 0){
+					printf("Failed to remove %s\n", inputs[i]);
+					status = 1;
+				}
+			}
+		}
+		else {
+			remove(segnm);
+			remove(posnm);
+			remove(tmpmanifest);
+		}
+	}
+
+	for (int i = 0; i < count; i++){
+		free(inputs[i]);
+		free(positions[i]);
+	}
+	free(inputs);
+	free(positions);
+	return status;
+}
+
+int main(int argc, char *argv[]){
+	if (argc == 3 && strcmp(argv[1], "-c") == 0){
+		exit(compact(argv[2]) == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	bool remap = argc > 1 && strcmp(argv[1], "-r") == 0;
+	int first = remap ? 2 : 1;
+	if (argc - first < 3){
+		usage();
+		exit(EXIT_FAILURE);
+	}
+
+	char *outnm = argv[first];
+	char **inputs = &argv[first+1];
+	int ninputs = argc - first - 1;
+	int *offsets = NULL;
+
+	/* shift each input's ids past the highest id of the inputs before it */
+	if (remap){
+		offsets = malloc(ninputs * sizeof(int));
+		offsets[0] = 0;
+		for (int i = 1; i < ninputs; i++){
+			int maxid = index_maxid(inputs[i-1]);
+			if (maxid < 0){
+				printf("Failed to read index: %s\n", inputs[i-1]);
+				exit(EXIT_FAILURE);
+			}
+			offsets[i] = offsets[i-1] + maxid;
+		}
+	}
+
+	int status = indexmerge(inputs, ninputs, offsets, outnm);
+	free(offsets);
+
+	/* positions left by an earlier index of the same name no longer match */
+	char posnm[MAX_PATH_LEN];
+	pos_path(outnm, posnm, sizeof(posnm));
+	remove(posnm);
+	if (status != 0)
+		exit(EXIT_FAILURE);
+	printf("Merged %d indices into %s\n", ninputs, outnm);
+	exit(EXIT_SUCCESS);
+}
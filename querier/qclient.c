@@ -0,0 +1,237 @@
+/* qclient.c --- load generator for the query server
+ *
+ * Authors: Abdibaset Bare, Ian Kamweru and Nathaniel Mensah
+ * Version: 1.0
+ *
+ * Description: replays the queries of a query file against a querier
+ * started with -s <socket>. Each of the -c connections runs on its own
+ * thread and sends its share of the queries one at a time, waiting for
+ * each response. Reports throughput and latency percentiles; with -o
+ * the responses are printed to stdout in query file order.
+ *
+ */
+
+#define _POSIX_C_SOURCE 200809L    // getline, clock_gettime
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/**
+ * @brief the work of one client connection
+*/
+typedef struct client {
+    char *sockpath;
+    char **queries;     // every query of the file
+    int num_queries;
+    int first;          // this client sends queries first, first+step, ...
+    int step;
+    int total;          // number of queries to send, across repetitions
+    double *latencies;  // seconds, indexed like the queries; < 0 unless answered
+    char **responses;   // kept only if printing
+    int sent;           // queries written to the server
+    int answered;       // queries whose response was read
+} client_t;
+
+static double now(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int write_all(int fd, const char *buf, size_t len){
+    while(len > 0){
+        ssize_t n = write(fd, buf, len);
+        if(n < 0){
+            if(errno == EINTR)
+                continue;
+            return -1;
+        }
+        buf += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static int read_all(int fd, char *buf, size_t len){
+    while(len > 0){
+        ssize_t n = read(fd, buf, len);
+        if(n <= 0){
+            if(n < 0 && errno == EINTR)
+                continue;
+            return -1;
+        }
+        buf += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/* reads a "<length>\n<bytes>" response; returns the malloc'd bytes */
+static char *read_response(int fd){
+    char header[32];
+    size_t i = 0;
+    while(i < sizeof(header)-1){
+        if(read_all(fd, &header[i], 1) != 0)
+            return NULL;
+        if(header[i] == '\n')
+            break;
+        i++;
+    }
+    header[i] = '\0';
+    size_t len = strtoul(header, NULL, 10);
+    char *body = malloc(len + 1);
+    if(!body || read_all(fd, body, len) != 0){
+        free(body);
+        return NULL;
+    }
+    body[len] = '\0';
+    return body;
+}
+
+static void *client_start(void *arg){
+    client_t *cl = (client_t*)arg;
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, cl->sockpath, sizeof(addr.sun_path)-1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0){
+        perror("connect");
+        if(fd >= 0)
+            close(fd);
+        return NULL;
+    }
+
+    for(int n = cl->first; n < cl->total; n += cl->step){
+        char *query = cl->queries[n % cl->num_queries];
+        double start = now();
+        char *response = NULL;
+        if(write_all(fd, query, strlen(query)) != 0 || write_all(fd, "\n", 1) != 0)
+            break;
+        cl->sent++;
+        if(!(response = read_response(fd)))
+            break;
+        cl->answered++;
+        cl->latencies[n] = now() - start;
+        if(cl->responses)
+            cl->responses[n] = response;
+        else
+            free(response);
+    }
+    close(fd);
+    return NULL;
+}
+
+static int compare_double(const void *a, const void *b){
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char *argv[]){
+    const char *usage = "usage: qclient <socket> <queryfile> [-c <connections>] [-n <repetitions>] [-o]\n";
+    int connections = 1, repetitions = 1;
+    bool print = false;
+
+    if(argc < 3){
+        fprintf(stderr, "%s", usage);
+        exit(EXIT_FAILURE);
+    }
+    for(int i = 3; i < argc; i++){
+        if(strcmp(argv[i], "-c") == 0 && i + 1 < argc && atoi(argv[i+1]) > 0){
+            connections = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "-n") == 0 && i + 1 < argc && atoi(argv[i+1]) > 0){
+            repetitions = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "-o") == 0){
+            print = true;
+        } else {
+            fprintf(stderr, "%s", usage);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    /* read the queries */
+    FILE *file = fopen(argv[2], "r");
+    if(!file){
+        fprintf(stderr, "Error: cannot read query file '%s'\n", argv[2]);
+        exit(EXIT_FAILURE);
+    }
+    char **queries = NULL, *line = NULL;
+    size_t line_size = 0;
+    int num_queries = 0;
+    while(getline(&line, &line_size, file) > 0){
+        line[strcspn(line, "\r\n")] = '\0';
+        queries = realloc(queries, (num_queries+1) * sizeof(char*));
+        queries[num_queries] = malloc(strlen(line)+1);
+        strcpy(queries[num_queries++], line);
+    }
+    free(line);
+    fclose(file);
+    if(num_queries == 0){
+        fprintf(stderr, "Error: no queries in '%s'\n", argv[2]);
+        exit(EXIT_FAILURE);
+    }
+
+    int total = num_queries * repetitions;
+    double *latencies = malloc(total * sizeof(double));
+    for(int n = 0; n < total; n++)
+        latencies[n] = -1;
+    char **responses = print ? calloc(total, sizeof(char*)) : NULL;
+    client_t clients[connections];
+    pthread_t threads[connections];
+
+    double start = now();
+    for(int i = 0; i < connections; i++){
+        clients[i] = (client_t){ argv[1], queries, num_queries, i, connections,
+                                 total, latencies, responses, 0, 0 };
+        if(pthread_create(&threads[i], NULL, client_start, &clients[i]) != 0){
+            fprintf(stderr, "Error creating thread %d\n", i);
+            exit(EXIT_FAILURE);
+        }
+    }
+    int sent = 0, answered = 0;
+    for(int i = 0; i < connections; i++){
+        pthread_join(threads[i], NULL);
+        sent += clients[i].sent;
+        answered += clients[i].answered;
+    }
+    double elapsed = now() - start;
+
+    if(print){
+        for(int n = 0; n < total; n++){
+            printf("> %s\n%s", queries[n % num_queries], responses[n] ? responses[n] : "");
+            free(responses[n]);
+        }
+        free(responses);
+    }
+
+    /* the percentiles are over the queries answered; failures are
+     * counted, not timed */
+    int samples = 0;
+    for(int n = 0; n < total; n++){
+        if(latencies[n] >= 0)
+            latencies[samples++] = latencies[n];
+    }
+    qsort(latencies, samples, sizeof(double), compare_double);
+    fprintf(stderr, "%d queries, %d connections: %d sent, %d answered, %d failed (%d never sent)\n",
+            total, connections, sent, answered, total - answered, total - sent);
+    fprintf(stderr, "%d answered in %.3f s: %.1f queries/s\n", answered, elapsed, answered / elapsed);
+    if(samples > 0)
+        fprintf(stderr, "latency ms: p50 %.3f  p90 %.3f  p99 %.3f  max %.3f\n",
+                1e3*latencies[samples/2], 1e3*latencies[(int)(samples*0.9)],
+                1e3*latencies[(int)(samples*0.99)], 1e3*latencies[samples-1]);
+
+    for(int i = 0; i < num_queries; i++)
+        free(queries[i]);
+    free(queries);
+    free(latencies);
+    exit(answered == total ? EXIT_SUCCESS : EXIT_FAILURE);
+}
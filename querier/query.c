@@ -9,20 +9,53 @@
  * and prints a list of documents in rank order. In general, queries are a sequence of words
  * separated by spaces with optiona  boolean operators AND and OR, where AND has precedence over OR.
  * By default, all words typed in a query are implicitly connected by logical-AND. 
+ * Words in double quotes form a phrase, which matches the documents holding 
+ * them next to each other and in order; it needs an index built with 
+ * indexer -p. A word ending in * matches every word it is a prefix of. 
+ * 
+ * Options: -s <socket> serves queries over a Unix-domain socket (serve), 
+ * -b <queryfile> answers a file of queries (run_batch), both on -t <threads> 
+ * threads; -c and -i size the result and intersection caches in megabytes 
+ * (process_query, evaluate_query); -k <results> prints only the best ranked. 
+ * Each query is planned (plan_query) and then evaluated document at a time 
+ * by a tree of cursors (evaluate_query, cursor.h). 
  * 
  */
 
+#define _POSIX_C_SOURCE 200809L    // strtok_r, getline, open_memstream
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <ctype.h>
 #include <sys/stat.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
 #include <hash.h>
+#include <lqueue.h>
+#include <typed.h>
+#include <lrucache.h>
+#include <gdcache.h>
 #include <indexio.h>
 #include <pageio.h>
+#include <segment.h>
+#include <qindex.h>
+#include <cursor.h>
+#include <roaring.h>
+#include <intersect.h>
+#include <limits.h>
 
 #define MAX_QUERY_LEN 512
+#define DEFAULT_THREADS 4
+#define DEFAULT_CACHE_MB 16
 
 /**
  * @brief represents a ranked doc with id, ranked word_count and url
@@ -35,6 +68,81 @@ typedef struct doc {
     char *content;
 } rankedDoc_t;
 
+/* the ranked documents of a query, in a ring buffer that is walked and 
+ * sorted in place */
+TYPED_QUEUE(ranked, rankedDoc_t*)
+
+/**
+ * @brief command line options
+*/
+typedef struct options {
+    bool quiet;         // -q
+    char *socket;       // -s: serve queries on this Unix-domain socket
+    char *batch;        // -b: evaluate the queries of this file
+    int threads;        // -t: number of query worker threads
+    int cache_mb;       // -c: result cache size, 0 for none
+    int and_cache_mb;   // -i: intersection cache size, 0 for none
+    int top_k;          // -k: number of results to print, 0 for all
+} options_t;
+
+/**
+ * @brief a node of a query plan: a word, or an AND or OR of child nodes
+*/
+typedef enum { PLAN_TERM, PLAN_PHRASE, PLAN_PREFIX, PLAN_AND, PLAN_OR } plan_type_t;
+
+typedef struct plan {
+    plan_type_t type;
+    char *word;                 // PLAN_TERM, PLAN_PHRASE, PLAN_PREFIX: as typed
+    postings_t *term;           // PLAN_TERM: the word's documents; 
+                                // PLAN_PHRASE, PLAN_PREFIX: the phrase's or 
+                                // the prefix's, owned by the node
+    struct plan **children;     // PLAN_AND: by ascending cost; PLAN_OR
+    int num_children;
+    int cost;                   // most documents the node can match
+} plan_t;
+
+/**
+ * @brief the intersection cache entry of a set of words: the cost of 
+ * computing it, then the ids and then the ranks of its documents
+*/
+typedef struct cached_and {
+    double cost;
+    int count;
+    int data[];
+} cached_and_t;
+
+/**
+ * @brief how the cursor of an AND node uses the intersection cache
+*/
+typedef struct and_state {
+    cached_and_t *hit;      // cached intersection the cursor reads, may be NULL
+    cursor_t *record;       // records the documents to cache, may be NULL
+    double base_cost;       // cost of what the cursor does not walk
+    int *dense;             // ids of the bitmap intersection, may be NULL
+    int *dense_ranks;
+    int *pair;              // ids of the intersection of the two shortest lists
+    int *pair_ranks;
+    cached_and_t *pair_hit; // cached intersection of the two shortest lists, may be NULL
+} and_state_t;
+
+/**
+ * @brief the state shared by every query; the index is read-only while
+ * a query holds the lock for reading, and replaced under the write lock
+*/
+typedef struct querier {
+    qindex_t *index;
+    char *pagedir;
+    char *index_file;
+    lrucache_t *cache;          // query results by normalized query, may be NULL
+    gdcache_t *and_cache;       // intersections by sorted term set, may be NULL
+    int top_k;                  // number of results to print, 0 for all
+    pthread_rwlock_t lock;      // protects index
+    pthread_mutex_t stamp_mutex;// protects stamp, checked and reloading
+    long long stamp;            // modification stamp of the loaded index files
+    time_t checked;             // last time the stamp was checked
+    bool reloading;             // a thread is loading a changed index
+} querier_t;
+
 /*************************** PROTOTYPES ********************************/
 /**
  * Initializes a ranked document
@@ -49,9 +157,10 @@ static rankedDoc_t* init_doc(int id, int rank);
  * get user input from standard in
  * 
  * @param buffer buffer for the input
+ * @param quiet whether to suppress the prompt
  * @return -1 if end of file(EOF), 0 if successful
 */
-static int get_input(char *buffer);
+static int get_input(char *buffer, bool quiet);
 
 /**
  * split the query into an array of tokens
@@ -62,6 +171,16 @@ static int get_input(char *buffer);
 */
 static char** tokenize_query(char *query, int *num_tokens);
 
+/**
+ * @brief reads the rest of a quoted phrase whose first token is first
+ * 
+ * @param first the token holding the opening quote
+ * @param saveptr the tokenizer state, advanced past the closing quote
+ * @return the normalized words of 3 letters or more, space separated and 
+ * quoted; "" if there are none; NULL if the phrase is invalid or unclosed
+*/
+static char* read_phrase(char *first, char **saveptr);
+
 /**
  * Normalizes a word (from the query) by converting to lowercase
  * 
@@ -84,33 +203,89 @@ static bool validate_query(char **query, int num_tokens);
  * 
  * @param pagedir a pointer to a buffer in which to write crawled pagedir
  * @param indexfile a pointer to a buffer in which to write the index file
+ * @param opts the options to fill in
  * @return 0 if successful, -1 if invalid
 */
-static int parse_args(int argc, char *argv[], char **pagedir, char **indexfile);
+static int parse_args(int argc, char *argv[], char **pagedir, char **indexfile, options_t *opts);
 
 /**
- * searches for a query token in the index
+ * evaluates a query and writes the ranked documents to out; results are 
+ * kept in a bounded LRU cache (-c <megabytes>, 0 disables it) keyed by the 
+ * normalized token sequence of the query, emptied when the index is reloaded
  * 
- * @param elementp a pointer to an element in the index (elementp contains a word and wordcount)
- * @param key the token to search for
- * @return a boolean indicating whether the element's word is the same as the search token
- */
-static bool token_searchfn(void *elementp, const void *key);
+ * @param qr the index and page directory to query
+ * @param query the raw query; it is modified by tokenizing
+ * @param out the stream to print results to
+*/
+static void process_query(querier_t *qr, char *query, FILE *out);
 
 /**
- * searches for doc in the queue of documents
+ * evaluates a validated token sequence and writes the ranked documents to out
+ * 
+ * The plan is walked by a tree of cursors: every word is a cursor over its 
+ * documents, and AND and OR cursors line up their children as the root 
+ * moves from one match to the next, so no intermediate result is built; 
+ * AND cursors gallop through long lists, so a conjunction costs about its 
+ * rarest word. In each AND-group the bitmaps of dense words (roaring.h) are 
+ * intersected a machine word of documents at a time, and the two shortest 
+ * lists up front by the vector kernels of intersect.h (see and_cursor). 
  * 
- * @related token_searchfn
+ * Intersections are cached (-i <megabytes>) by the set of words intersected: 
+ * whole groups, and the two rarest words of longer groups, so queries 
+ * sharing a conjunction or a pair of words reuse it; the cache keeps what 
+ * saves the most merging per byte. With -k <results> the OR of the groups is 
+ * walked by a Block-Max WAND cursor, which skips the documents whose largest 
+ * possible rank cannot beat the k-th best found so far. 
+ * 
+ * @related process_query
 */
-static bool doc_searchfn(void *elementp, const void *id);
+static void evaluate_query(querier_t *qr, char **tokenized_query, int num_tokens, FILE *out);
 
-static int comparator(const void *a, const void *b);
+/**
+ * reloads the index, and empties the result cache, if the index files
+ * have changed since they were loaded; checks at most once a second
+ * 
+ * @param qr the querier whose index to refresh
+*/
+static void refresh_index(querier_t *qr);
+
+/**
+ * computes a stamp that changes whenever the index or its manifest is rewritten
+ * 
+ * @param index_file the index file
+ * @return the stamp
+*/
+static long long index_stamp(char *index_file);
 
-static void sort_queue(queue_t **qp);
+/**
+ * serves queries on a Unix-domain socket until SIGINT or SIGTERM; the index 
+ * is loaded once and shared by a pool of worker threads. Each request is one 
+ * query line; each response is the result text preceded by its length in 
+ * bytes on a line of its own
+ * 
+ * @param qr the index and page directory to query
+ * @param sockpath the path of the socket to listen on
+ * @param nthreads the number of query worker threads
+ * @return 0 if successful, -1 if the socket could not be set up
+*/
+static int serve(querier_t *qr, char *sockpath, int nthreads);
+
+/**
+ * evaluates every query of a file concurrently and prints the results
+ * to stdout in input order, each after a "> <query>" line
+ * 
+ * @param qr the index and page directory to query
+ * @param queryfile the file with one query per line
+ * @param nthreads the number of query worker threads
+ * @return 0 if successful, -1 if the file could not be read
+*/
+static int run_batch(querier_t *qr, char *queryfile, int nthreads);
+
+static int comparator(const void *a, const void *b);
 
 static void free_doc(rankedDoc_t *dp);
 
-static void free_queue(queue_t *qp);
+static void free_queue(ranked_t *qp);
 
 /**
  * sets the ranked page url, title and description
@@ -118,148 +293,666 @@ static void free_queue(queue_t *qp);
  * @param ranked_docs the queue of ranked docs
  * @param pagedir the directory containing crawled pages
 */
-static void get_metadata(queue_t *ranked_docs, char *pagedir);
+static void get_metadata(ranked_t *ranked_docs, char *pagedir);
+
+/**
+ * builds the plan of a validated query: an OR of AND-groups, each AND-group 
+ * ordered by ascending document frequency; AND-groups with a word that is 
+ * not in the index match nothing and are left out, and intersections stop 
+ * as soon as they come up empty
+ * 
+ * @param qr the querier
+ * @param tokenized_query the tokens of the query
+ * @param num_tokens the number of tokens
+ * @return the plan, to be freed with free_plan
+*/
+static plan_t* plan_query(querier_t *qr, char **tokenized_query, int num_tokens);
+
+/**
+ * @brief finds the documents of a quoted phrase by positional intersection: 
+ * the documents of its words are intersected, rarest first, then in each 
+ * common document the positions of the words, offset by their place in the 
+ * phrase; the result then takes part in the plan like the list of a word
+ * 
+ * @param qr the querier, whose index has positions
+ * @param phrase a phrase token of two or more words
+ * @return postings ranked by the occurrences of the phrase, which the 
+ * caller frees with free_postings; NULL if no document holds the phrase
+*/
+static postings_t* phrase_postings(querier_t *qr, char *phrase);
 
 /**
- * finds the intersection between two ranked queues
+ * @brief finds the documents of the words starting with a prefix: a range 
+ * of the sorted term table of the index, found by binary search, whose 
+ * lists are merged into one ranked the way an OR of the words would rank
  * 
- * @param qp1 the ranked queue
- * @param qp2 the queue of docs containing a token
- * @return a pointer to a queue containing the intersetion
+ * @param qr the querier
+ * @param token the prefix followed by *
+ * @param owned set if the postings are new, to be freed with free_postings; 
+ * a prefix of a single word gives that word's postings
+ * @return postings ranked by the summed counts of the words; NULL if no 
+ * word starts with the prefix
 */
-static queue_t* get_intersection(queue_t *qp1, queue_t *qp2);
+static postings_t* prefix_postings(querier_t *qr, char *token, bool *owned);
+
+static void free_postings(postings_t *pp);
+
+static void free_plan(plan_t *plan);
 
 /**
- * finds the union between two ranked queues in place
- * ie. the result is concatenated into qp1, qp2 is restored to original state
+ * opens the cursor of an AND node of a plan, reading the intersection of 
+ * its words from the intersection cache if it is there
  * 
- * @param qp1 the ranked queue
- * @param qp2 the queue of docs containing a token
- * @return a pointer to a queue containing the union
+ * @param qr the querier
+ * @param plan the AND node
+ * @param state filled with what cache_and needs once the cursor is exhausted
+ * @return the cursor
 */
-static queue_t* get_union(queue_t *qp1, queue_t *qp2);
+static cursor_t* and_cursor(querier_t *qr, plan_t *plan, and_state_t *state);
+
+/**
+ * walks a cursor, keeping the k best ranked documents; ties go to the 
+ * smaller id, as in the printed order
+ * 
+ * @param root the cursor; its threshold follows the k-th best rank
+ * @param k the number of documents to keep
+ * @param ranked_docs the queue to put the ranked documents in
+*/
+static void get_top(cursor_t *root, int k, ranked_t *ranked_docs);
+
+/**
+ * caches the documents matched by an exhausted AND cursor
+ * 
+ * @param qr the querier
+ * @param plan the AND node
+ * @param state as filled by and_cursor
+*/
+static void cache_and(querier_t *qr, plan_t *plan, and_state_t *state);
 
 /*************************** MAIN ******************************/
 int main(int argc, char *argv[]){
     /* use case: query ../pages index < good-queries.txt > output */
     char *pagedir, *index_file;
-    if(parse_args(argc, argv, &pagedir, &index_file) != 0){
+    options_t opts;
+    if(parse_args(argc, argv, &pagedir, &index_file, &opts) != 0){
         exit(EXIT_FAILURE);
     }
-    const char *and = "and", *or = "or";
-    hashtable_t *index = indexload(index_file);
+    querier_t qr;
+    qr.pagedir = pagedir;
+    qr.index_file = index_file;
+    qr.stamp = index_stamp(index_file);
+    qr.checked = time(NULL);
+    qr.reloading = false;
+    qr.index = qindexload(index_file);
+    if(!qr.index){
+        fprintf(stderr, "Error: failed to load index '%s'\n", index_file);
+        exit(EXIT_FAILURE);
+    }
+    qr.cache = opts.cache_mb > 0 ? lruopen((size_t)opts.cache_mb << 20) : NULL;
+    qr.and_cache = opts.and_cache_mb > 0 ? gdopen((size_t)opts.and_cache_mb << 20) : NULL;
+    qr.top_k = opts.top_k;
+    pthread_rwlock_init(&qr.lock, NULL);
+    pthread_mutex_init(&qr.stamp_mutex, NULL);
 
     char query[MAX_QUERY_LEN];
-    char **tokenized_query, *token, *curr_operator;
-    int num_tokens, top;
-    entry_t *ep;
-    rankedDoc_t *doc;
-    queue_t *ranked_docs, **stack=NULL, *tmp, *qp1, *qp2;
+    int status = 0;
+    if(opts.socket){
+        status = serve(&qr, opts.socket, opts.threads);
+    }
+    else if(opts.batch){
+        status = run_batch(&qr, opts.batch, opts.threads);
+    }
+    else {
+        /* get input from stdin */
+        while(get_input(query, opts.quiet) == 0){
+            process_query(&qr, query, stdout);
+        }
+    }
 
-    while(1){
-		num_tokens = 0;
-        top = -1;
-        curr_operator = "";
+    if(qr.cache && (opts.socket || opts.batch)){
+        uint64_t hits, misses;
+        size_t bytes;
+        lrustats(qr.cache, &hits, &misses, &bytes);
+        fprintf(stderr, "result cache: %llu hits, %llu misses, %zu bytes\n",
+                (unsigned long long)hits, (unsigned long long)misses, bytes);
+    }
+    if(qr.and_cache && (opts.socket || opts.batch)){
+        uint64_t hits, misses;
+        size_t bytes;
+        gdstats(qr.and_cache, &hits, &misses, &bytes);
+        fprintf(stderr, "intersection cache: %llu hits, %llu misses, %zu bytes\n",
+                (unsigned long long)hits, (unsigned long long)misses, bytes);
+    }
 
-        /* get input from stdin */
-        if(get_input(query) != 0){
-            break;
+    /* free memory */
+    lruclose(qr.cache);
+    gdclose(qr.and_cache);
+    pthread_rwlock_destroy(&qr.lock);
+    pthread_mutex_destroy(&qr.stamp_mutex);
+    qindexclose(qr.index);
+    free(pagedir); free(index_file);
+    exit(status == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+/****************************************************************************/
+
+/******************************** QUERIES ***********************************/
+static void process_query(querier_t *qr, char *query, FILE *out){
+    char **tokenized_query;
+    int num_tokens = 0;
+
+    /* no query is entered */
+    if(!query[0]){
+        return;
+    }
+
+    /* get array of tokens from query */
+    tokenized_query = tokenize_query(query, &num_tokens);
+
+    /* validate query */
+    if(!tokenized_query || !validate_query(tokenized_query,num_tokens)){
+        for(int i = 0; i < num_tokens; i++){
+            free(tokenized_query[i]);
         }
+        free(tokenized_query);
+        fprintf(out, "[invalid query]\n");
+        return;
+    }
 
-        /* no query is entered */
-        if(!query[0]){
-            continue;
+    refresh_index(qr);
+    pthread_rwlock_rdlock(&qr->lock);
+
+    /* the normalized token sequence is the cache key */
+    size_t key_len = 0;
+    for(int i = 0; i < num_tokens; i++){
+        key_len += strlen(tokenized_query[i]) + 1;
+    }
+    char *key = malloc(key_len), *result;
+    size_t result_len;
+    key[0] = '\0';
+    for(int i = 0; i < num_tokens; i++){
+        strcat(key, tokenized_query[i]);
+        if(i < num_tokens - 1)
+            strcat(key, " ");
+    }
+
+    result = lruget(qr->cache, key, &result_len);
+    if(!result && qr->cache){
+        FILE *mem = open_memstream(&result, &result_len);
+        if(mem){
+            evaluate_query(qr, tokenized_query, num_tokens, mem);
+            fclose(mem);
+            lruput(qr->cache, key, result, result_len);
         }
+    }
+    if(result)
+        fwrite(result, 1, result_len, out);
+    else
+        evaluate_query(qr, tokenized_query, num_tokens, out);
+    pthread_rwlock_unlock(&qr->lock);
 
-        /* get array of tokens from query */
-        tokenized_query = tokenize_query(query, &num_tokens);
+    /* free memory */
+    for(int i = 0; i < num_tokens; i++){
+        free(tokenized_query[i]);
+    }
+    free(tokenized_query);
+    free(key);
+    free(result);
+}
 
-        /* validate query */
-        if(!tokenized_query || !validate_query(tokenized_query,num_tokens)){
-            for(int i = 0; i < num_tokens; i++){
-                free(tokenized_query[i]);
-            }
-            free(tokenized_query);
-            printf("[invalid query]\n");
-            query[0] = '\0';
-            continue;
+static void evaluate_query(querier_t *qr, char **tokenized_query, int num_tokens, FILE *out){
+    for(int i = 0; i < num_tokens; i++){
+        if(tokenized_query[i][0] == '"' && strchr(tokenized_query[i], ' ') &&
+            !qindexhaspositions(qr->index)){
+            fprintf(out, "[phrase queries need an index built with indexer -p]\n");
+            return;
         }
+    }
 
-        /* process tokens in Backus-Naur Form */
-        for(int i = 0; i < num_tokens; i++){
-            token = tokenized_query[i];
+    plan_t *plan = plan_query(qr, tokenized_query, num_tokens);
+    int num_groups = plan->num_children;
+    and_state_t *states = calloc(num_groups + 1, sizeof(and_state_t));
+    cursor_t **groups = malloc((num_groups + 1) * sizeof(cursor_t*));
+    rankedDoc_t *doc;
+
+    /* OR together the AND-groups; the root cursor visits each match once */
+    for(int i = 0; i < num_groups; i++){
+        groups[i] = and_cursor(qr, plan->children[i], &states[i]);
+    }
+    cursor_t *root = qr->top_k > 0 ? cursorwand(groups, num_groups) : cursoror(groups, num_groups);
+    free(groups);
+
+    ranked_t ranked_docs = { NULL, 0, 0, 0 };
+    if(qr->top_k > 0){
+        get_top(root, qr->top_k, &ranked_docs);
+    }
+    else {
+        for(int id = cursordoc(root); id != CURSOR_END; id = cursornext(root)){
+            if((doc = init_doc(id, cursorscore(root))))
+                ranked_put(&ranked_docs, doc);
+        }
+    }
+
+    for(int i = 0; i < num_groups; i++){
+        cache_and(qr, plan->children[i], &states[i]);
+        free(states[i].hit);
+        free(states[i].dense);
+        free(states[i].dense_ranks);
+        free(states[i].pair);
+        free(states[i].pair_ranks);
+        free(states[i].pair_hit);
+    }
+    cursorclose(root);
+    free(states);
+    free_plan(plan);
 
-            /* if token is an operator, update current operator and continue */
-            if(strcmp(token, and)==0 || strcmp(token, or)==0){
-                curr_operator = token;
+    /* set metadata -> url, title, content */
+    get_metadata(&ranked_docs, qr->pagedir);
+
+    /* sort ranked docs */
+    ranked_sort(&ranked_docs, comparator);
+
+    /* print docs' rank & url */
+    while(ranked_get(&ranked_docs, &doc)){
+        fprintf(out, "title: %s\nrank:%d doc:%d : %s\n",doc->title, doc->word_count,doc->id,doc->url);
+        fprintf(out, "%s...\n\n",doc->content);
+        free_doc(doc);
+    }
+
+    free_queue(&ranked_docs);
+}
+
+static long long index_stamp(char *index_file){
+    char manifest[1024];
+    struct stat st;
+    long long stamp = 0;
+    if(stat(index_file, &st) == 0)
+        stamp = (long long)st.st_mtime * 1000003 + st.st_size;
+    snprintf(manifest, sizeof(manifest), "%s.manifest", index_file);
+    if(stat(manifest, &st) == 0)
+        stamp = stamp * 31 + (long long)st.st_mtime * 1000003 + st.st_size;
+    return stamp;
+}
+
+static void refresh_index(querier_t *qr){
+    time_t now = time(NULL);
+    long long stamp = 0;
+    bool changed = false;
+
+    pthread_mutex_lock(&qr->stamp_mutex);
+    if(now != qr->checked && !qr->reloading){
+        qr->checked = now;
+        stamp = index_stamp(qr->index_file);
+        changed = qr->reloading = stamp != qr->stamp;
+    }
+    pthread_mutex_unlock(&qr->stamp_mutex);
+    if(!changed)
+        return;
+
+    /* the stamp is kept only once the index has loaded, so a failed load
+     * (e.g. of files still being written) is retried at the next check */
+    qindex_t *index = qindexload(qr->index_file);
+    pthread_mutex_lock(&qr->stamp_mutex);
+    if(index)
+        qr->stamp = stamp;
+    qr->reloading = false;
+    pthread_mutex_unlock(&qr->stamp_mutex);
+    if(!index)
+        return;
+    pthread_rwlock_wrlock(&qr->lock);
+    qindex_t *old = qr->index;
+    qr->index = index;
+    lruclear(qr->cache);
+    gdclear(qr->and_cache);
+    pthread_rwlock_unlock(&qr->lock);
+    qindexclose(old);
+}
+
+/****************************************************************************/
+
+/******************************** SERVER ************************************/
+static volatile sig_atomic_t stopping = 0;
+
+/* work shared by the server's worker threads */
+typedef struct server {
+    querier_t *qr;
+    lqueue_t *connections;  // accepted sockets waiting for a worker
+    sem_t pending;          // counts the connections in the queue
+    pthread_mutex_t mutex;  // protects clients and closing
+    int *clients;           // the socket each worker serves, -1 if none
+    bool closing;           // no more connections are served
+} server_t;
+
+/* a worker thread and its slot in clients */
+typedef struct worker {
+    server_t *sv;
+    int slot;
+} worker_t;
+
+static void stop_handler(int sig){
+    stopping = 1;
+}
+
+/* writes all len bytes of buf to fd */
+static int write_all(int fd, const char *buf, size_t len){
+    while(len > 0){
+        ssize_t n = write(fd, buf, len);
+        if(n < 0){
+            if(errno == EINTR)
                 continue;
-            }
+            return -1;
+        }
+        buf += n;
+        len -= n;
+    }
+    return 0;
+}
 
-            ep = hsearch(index, token_searchfn, token, strlen(token));
-            tmp = qopen();
-            if(ep){ // if token is present in index push its queue
-                tmp = get_union(tmp, ep->documents);
-            }
-            stack = (queue_t**) realloc(stack, sizeof(queue_t*) * (top + 2));
-            stack[++top] = tmp;
-            
-            /* if last operator is and, get intersect of prev two queues in stack */
-            if(strcmp(curr_operator, and)==0){
-                qp1 = stack[top--];
-                qp2 = stack[top--];
-                stack[++top] = get_intersection(qp1, qp2);
-            }
+/* answers every query line of one client connection */
+static void handle_client(querier_t *qr, int fd){
+    FILE *in = fdopen(fd, "r");
+    if(!in){
+        close(fd);
+        return;
+    }
+    char *line = NULL, *result;
+    size_t line_size = 0, result_len;
+    char header[32];
+
+    while(getline(&line, &line_size, in) > 0){
+        line[strcspn(line, "\r\n")] = '\0';
+        FILE *out = open_memstream(&result, &result_len);
+        if(!out)
+            break;
+        process_query(qr, line, out);
+        fclose(out);
+
+        int header_len = snprintf(header, sizeof(header), "%zu\n", result_len);
+        int status = write_all(fd, header, header_len);
+        if(status == 0)
+            status = write_all(fd, result, result_len);
+        free(result);
+        if(status != 0)
+            break;
+    }
+    free(line);
+    fclose(in);
+}
+
+static void *worker_start(void *arg){
+    worker_t *wk = (worker_t*)arg;
+    server_t *sv = wk->sv;
+    int *fdp;
+    while(1){
+        while(sem_wait(&sv->pending) != 0 && errno == EINTR)
+            ;
+        fdp = lqget(sv->connections);
+        if(!fdp || *fdp < 0){   // shutdown
+            free(fdp);
+            return NULL;
         }
 
-        /* union everything left in the stack */
-        while(top>0){
-            qp1 = stack[top--];
-            qp2 = stack[top--];
-            stack[++top] = get_union(qp1, qp2);
-            free_queue(qp2);
+        /* once closing, connections still queued are dropped unserved */
+        pthread_mutex_lock(&sv->mutex);
+        bool closing = sv->closing;
+        if(!closing)
+            sv->clients[wk->slot] = *fdp;
+        pthread_mutex_unlock(&sv->mutex);
+        if(closing){
+            close(*fdp);
+        } else {
+            handle_client(sv->qr, *fdp);
+            pthread_mutex_lock(&sv->mutex);
+            sv->clients[wk->slot] = -1;
+            pthread_mutex_unlock(&sv->mutex);
         }
-        ranked_docs = stack[top];
-    
+        free(fdp);
+    }
+}
+
+static int serve(querier_t *qr, char *sockpath, int nthreads){
+    struct sockaddr_un addr;
+    if(strlen(sockpath) >= sizeof(addr.sun_path)){
+        fprintf(stderr, "Error: socket path '%s' is too long\n", sockpath);
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, sockpath);
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(sockpath);
+    if(listen_fd < 0 || bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        listen(listen_fd, 128) != 0){
+        perror("Error: failed to listen on socket");
+        if(listen_fd >= 0)
+            close(listen_fd);
+        return -1;
+    }
 
-        /* set metadata -> url, title, content */
-        get_metadata(ranked_docs, pagedir);
+    /* stop accepting on SIGINT/SIGTERM; accept() is not restarted */
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = stop_handler;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
 
-        /* sort ranked docs */
-        sort_queue(ranked_docs);
-    
-        /* print docs' rank & url */
-        while((doc=qget(ranked_docs))){
-            printf("title: %s\nrank:%d doc:%d : %s\n",doc->title, doc->word_count,doc->id,doc->url);
-            printf("%s...\n\n",doc->content);
-            free_doc(doc);
+    server_t sv;
+    sv.qr = qr;
+    sv.connections = lqopen();
+    sem_init(&sv.pending, 0, 0);
+    pthread_mutex_init(&sv.mutex, NULL);
+    sv.clients = malloc(nthreads * sizeof(int));
+    sv.closing = false;
+    pthread_t threads[nthreads];
+    worker_t workers[nthreads];
+
+    /* the workers block the stop signals, so that they interrupt accept() */
+    sigset_t stop_signals, old_mask;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, &old_mask);
+    for(int i = 0; i < nthreads; i++){
+        sv.clients[i] = -1;
+        workers[i] = (worker_t){ &sv, i };
+        if(pthread_create(&threads[i], NULL, worker_start, &workers[i]) != 0){
+            fprintf(stderr, "Error creating thread %d\n", i);
+            exit(EXIT_FAILURE);
         }
+    }
+    pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+    fprintf(stderr, "serving queries on %s with %d threads\n", sockpath, nthreads);
 
-        /* free memory */
-        for(int i = 0; i < num_tokens; i++){
-            free(tokenized_query[i]);
+    while(!stopping){
+        int fd = accept(listen_fd, NULL, NULL);
+        if(fd < 0){
+            if(errno == EINTR)
+                continue;
+            perror("accept");
+            break;
         }
-        free(tokenized_query);
-        free_queue(ranked_docs);
+        int *fdp = malloc(sizeof(int));
+        *fdp = fd;
+        lqput(sv.connections, fdp);
+        sem_post(&sv.pending);
     }
 
-    /* free memory */
-    free(stack);
-    free_entries(index);
-    hclose(index);
-    free(pagedir); free(index_file);
-    exit(EXIT_SUCCESS);
+    /* end the reads of the clients being served, which finish their
+     * current query, then one shutdown marker per worker */
+    pthread_mutex_lock(&sv.mutex);
+    sv.closing = true;
+    for(int i = 0; i < nthreads; i++){
+        if(sv.clients[i] >= 0)
+            shutdown(sv.clients[i], SHUT_RD);
+    }
+    pthread_mutex_unlock(&sv.mutex);
+    for(int i = 0; i < nthreads; i++){
+        int *fdp = malloc(sizeof(int));
+        *fdp = -1;
+        lqput(sv.connections, fdp);
+        sem_post(&sv.pending);
+    }
+    for(int i = 0; i < nthreads; i++){
+        pthread_join(threads[i], NULL);
+    }
+    lqclose(sv.connections);
+    sem_destroy(&sv.pending);
+    pthread_mutex_destroy(&sv.mutex);
+    free(sv.clients);
+    close(listen_fd);
+    unlink(sockpath);
+    return 0;
+}
+
+/****************************************************************************/
+
+/******************************** BATCH *************************************/
+/* a query file being evaluated by a pool of threads. The file is read
+ * as the results are printed, so at most BATCH_WINDOW queries per thread
+ * are held at once; query i lives in slot i % window */
+#define BATCH_WINDOW 16
+
+typedef struct batch {
+    querier_t *qr;
+    char **queries;
+    char **results;         // NULL until the query has been evaluated
+    size_t *lengths;
+    int window;             // number of slots
+    int num_read;           // queries read from the file so far
+    int next;               // next query to hand to a worker
+    bool eof;               // every query has been read
+    pthread_mutex_t mutex;
+    pthread_cond_t ready;   // signalled whenever a query is read, and at eof
+    pthread_cond_t done;    // signalled whenever a result is stored
+} batch_t;
+
+static void *batch_start(void *arg){
+    batch_t *bt = (batch_t*)arg;
+    char *result, *query;
+    size_t result_len;
+    int i;
+    while(1){
+        pthread_mutex_lock(&bt->mutex);
+        while(bt->next == bt->num_read && !bt->eof)
+            pthread_cond_wait(&bt->ready, &bt->mutex);
+        if(bt->next == bt->num_read){
+            pthread_mutex_unlock(&bt->mutex);
+            return NULL;
+        }
+        i = bt->next++ % bt->window;
+        pthread_mutex_unlock(&bt->mutex);
+
+        /* tokenizing modifies the query, keep the original for printing */
+        FILE *out = open_memstream(&result, &result_len);
+        if((query = strdup(bt->queries[i])) && out)
+            process_query(bt->qr, query, out);
+        free(query);
+        if(out)
+            fclose(out);
+        else
+            result = NULL, result_len = 0;
+
+        pthread_mutex_lock(&bt->mutex);
+        bt->results[i] = result ? result : calloc(1, 1);
+        bt->lengths[i] = result_len;
+        pthread_cond_broadcast(&bt->done);
+        pthread_mutex_unlock(&bt->mutex);
+    }
+}
+
+static int run_batch(querier_t *qr, char *queryfile, int nthreads){
+    FILE *file = fopen(queryfile, "r");
+    if(!file){
+        fprintf(stderr, "Error: cannot read query file '%s'\n", queryfile);
+        return -1;
+    }
+    batch_t bt;
+    char *line = NULL;
+    size_t line_size = 0;
+    memset(&bt, 0, sizeof(bt));
+    bt.qr = qr;
+    bt.window = BATCH_WINDOW * (nthreads > 0 ? nthreads : 1);
+    bt.queries = calloc(bt.window, sizeof(char*));
+    bt.results = calloc(bt.window, sizeof(char*));
+    bt.lengths = calloc(bt.window, sizeof(size_t));
+    pthread_mutex_init(&bt.mutex, NULL);
+    pthread_cond_init(&bt.ready, NULL);
+    pthread_cond_init(&bt.done, NULL);
+
+    pthread_t threads[nthreads];
+    int started = 0;
+    for(; started < nthreads; started++){
+        if(pthread_create(&threads[started], NULL, batch_start, &bt) != 0)
+            break;
+    }
+
+    /* keep the window full of queries, printing each result as soon as
+     * every earlier one has been printed */
+    for(int printed = 0; ; printed++){
+        while(!bt.eof && bt.num_read - printed < bt.window){
+            bool more = getline(&line, &line_size, file) > 0;
+            if(more){
+                line[strcspn(line, "\r\n")] = '\0';
+                bt.queries[bt.num_read % bt.window] = strdup(line);
+            }
+            pthread_mutex_lock(&bt.mutex);
+            if(more)
+                bt.num_read++;
+            else
+                bt.eof = true;
+            pthread_cond_broadcast(&bt.ready);
+            pthread_mutex_unlock(&bt.mutex);
+        }
+        if(printed == bt.num_read)
+            break;
+        int i = printed % bt.window;
+        if(started == 0 && !bt.results[i]){
+            /* no workers: evaluate the window here */
+            bool eof = bt.eof;
+            bt.eof = true;
+            batch_start(&bt);
+            bt.eof = eof;
+        }
+        pthread_mutex_lock(&bt.mutex);
+        while(!bt.results[i])
+            pthread_cond_wait(&bt.done, &bt.mutex);
+        pthread_mutex_unlock(&bt.mutex);
+        printf("> %s\n", bt.queries[i]);
+        fwrite(bt.results[i], 1, bt.lengths[i], stdout);
+        free(bt.results[i]);
+        free(bt.queries[i]);
+        bt.results[i] = NULL;
+        bt.queries[i] = NULL;
+    }
+    free(line);
+    fclose(file);
+
+    for(int i = 0; i < started; i++){
+        pthread_join(threads[i], NULL);
+    }
+    pthread_mutex_destroy(&bt.mutex);
+    pthread_cond_destroy(&bt.ready);
+    pthread_cond_destroy(&bt.done);
+    free(bt.queries);
+    free(bt.results);
+    free(bt.lengths);
+    return 0;
 }
 
 /****************************************************************************/
 
 /******************************** FUNCTIONS *********************************/
-static int get_input(char *buffer){
+static int get_input(char *buffer, bool quiet){
     if(!buffer)
         return 1;
     buffer[0] = '\0';
-    printf("> ");
-    if(scanf("%[^\n]", buffer) == EOF){
-        printf("\n");
+    if(!quiet)
+        printf("> ");
+    if(scanf("%511[^\n]", buffer) == EOF){
+        if(!quiet)
+            printf("\n");
         return -1;
     }
     getchar(); // strip newline character
@@ -267,11 +960,22 @@ static int get_input(char *buffer){
 }
 
 static char** tokenize_query(char *query, int *num_tokens){
-    char **tokenized_query = NULL, *prev_token = NULL;
-    char* token = strtok(query, " \t");
+    char **tokenized_query = NULL, *prev_token = NULL, *saveptr;
+    char* token = strtok_r(query, " \t", &saveptr);
     int count = 0;
+    char *phrase = NULL;
     while(token){
-        if(!NormalizeWord(token)){
+        free(phrase);
+        phrase = NULL;
+        size_t len = strlen(token);
+        bool wildcard = token[0] != '"' && len > 1 && token[len - 1] == '*';
+        if(token[0] == '"'){
+            phrase = read_phrase(token, &saveptr);
+        }
+        if(wildcard){
+            token[len - 1] = '\0';
+        }
+        if(token[0] == '"' ? !phrase : !NormalizeWord(token)){
             /* free memory */
             for(int i = 0; i < count; i++){
                 free(tokenized_query[i]);
@@ -279,9 +983,21 @@ static char** tokenize_query(char *query, int *num_tokens){
             free(tokenized_query);
             return NULL;
         }
+        if(phrase){
+            /* a phrase of one word is the word, unless the word is an operator */
+            size_t phrase_len = strlen(phrase);
+            if(phrase_len > 0 && !strchr(phrase, ' ') && strcmp(phrase, "\"and\"") != 0){
+                memmove(phrase, phrase + 1, phrase_len - 2);
+                phrase[phrase_len - 2] = '\0';
+            }
+            token = phrase;
+        }
+        if(wildcard){
+            token[len - 1] = '*';
+        }
 
-        if(strlen(token) < 3 && strcmp(token,"or")!=0){
-            token = strtok(NULL, " \t");
+        if(phrase ? !phrase[0] : !wildcard && len < 3 && strcmp(token,"or")!=0){
+            token = strtok_r(NULL, " \t", &saveptr);
             continue;
         }
         if (prev_token && strcmp(prev_token, "and") != 0 && strcmp(prev_token, "or") != 0) {
@@ -297,15 +1013,58 @@ static char** tokenize_query(char *query, int *num_tokens){
         tokenized_query = realloc(tokenized_query, (count+1) * sizeof(char*));
         tokenized_query[count] = malloc(strlen(token) + 1);
         strcpy(tokenized_query[count], token);
-        prev_token = token;
-        token = strtok(NULL, " \t");
+        prev_token = tokenized_query[count];
+        token = strtok_r(NULL, " \t", &saveptr);
         count++;
     }
+    free(phrase);
 
     *num_tokens = count;
     return tokenized_query;
 }
 
+static char* read_phrase(char *first, char **saveptr){
+    char *phrase = malloc(strlen(first) + 3), *token = first + 1;
+    size_t len = 1, size = strlen(first) + 3;
+    bool closed = false;
+    phrase[0] = '"';
+    while(!closed){
+        if(!token){
+            free(phrase);
+            return NULL;
+        }
+        size_t word_len = strlen(token);
+        if(word_len > 0 && token[word_len - 1] == '"'){
+            token[--word_len] = '\0';
+            closed = true;
+        }
+        if(!NormalizeWord(token)){
+            free(phrase);
+            return NULL;
+        }
+        if(word_len >= 3){
+            if(len + word_len + 3 > size){
+                size = 2 * (len + word_len + 3);
+                phrase = realloc(phrase, size);
+            }
+            if(len > 1)
+                phrase[len++] = ' ';
+            memcpy(phrase + len, token, word_len);
+            len += word_len;
+        }
+        if(!closed)
+            token = strtok_r(NULL, " \t", saveptr);
+    }
+    if(len == 1){
+        phrase[0] = '\0';
+    }
+    else {
+        phrase[len++] = '"';
+        phrase[len] = '\0';
+    }
+    return phrase;
+}
+
 static rankedDoc_t* init_doc(int id, int rank){
     rankedDoc_t *doc;
     if (!(doc=(rankedDoc_t*)malloc(sizeof(rankedDoc_t)))) {
@@ -353,58 +1112,527 @@ static bool validate_query(char **query, int num_tokens){
     return true;
 }
 
-static queue_t* get_intersection(queue_t *qp1, queue_t *qp2){
-    queue_t *intersect = qopen();
-    if(!qp1 || !qp2 || !intersect)
-        return NULL;
-    //document_t *doc;
-    rankedDoc_t *dp, *doc;
-    int word_count, rank;
-    while((doc = qget(qp1))){
-        if ((dp=qsearch(qp2, doc_searchfn, &(doc->id)))) {
-            word_count = dp->word_count;
-            rank = doc->word_count;
-            doc->word_count = word_count < rank ? word_count : rank;
-            qput(intersect, doc);
-        } else free_doc(doc);
-    }
-    qclose(qp1);
-    free_queue(qp2);
-    //qclose(qp2);
-    return intersect;
-}
-
-static queue_t* get_union(queue_t *qp1, queue_t *qp2){
-    queue_t *tmp = qopen();
-    if(!qp1 ||!qp2 || !tmp)
+static int plan_comparator(const void *a, const void *b){
+    const plan_t *pa = *(plan_t* const*)a, *pb = *(plan_t* const*)b;
+    if(pa->cost != pb->cost)
+        return pa->cost < pb->cost ? -1 : 1;
+    return strcmp(pa->word, pb->word);
+}
+
+static plan_t *new_plan(plan_type_t type, int max_children){
+    plan_t *plan = calloc(1, sizeof(plan_t));
+    plan->type = type;
+    if(max_children > 0)
+        plan->children = malloc(max_children * sizeof(plan_t*));
+    return plan;
+}
+
+static void free_plan(plan_t *plan){
+    for(int i = 0; i < plan->num_children; i++){
+        free_plan(plan->children[i]);
+    }
+    if(plan->type == PLAN_PHRASE || plan->type == PLAN_PREFIX)
+        free_postings(plan->term);
+    free(plan->children);
+    free(plan);
+}
+
+static plan_t* plan_query(querier_t *qr, char **tokenized_query, int num_tokens){
+    plan_t *or_plan = new_plan(PLAN_OR, num_tokens), *and_plan = NULL;
+    bool empty = false;
+
+    /* AND has precedence over OR: split the tokens into AND-groups */
+    for(int i = 0; i <= num_tokens; i++){
+        if(i < num_tokens && strcmp(tokenized_query[i], "or") != 0){
+            if(strcmp(tokenized_query[i], "and") == 0 || empty)
+                continue;
+            if(!and_plan)
+                and_plan = new_plan(PLAN_AND, num_tokens);
+            char *token = tokenized_query[i];
+            bool phrase = token[0] == '"' && strchr(token, ' '), prefix = false;
+            postings_t *term;
+            if(phrase){
+                term = phrase_postings(qr, token);
+            }
+            else if(token[strlen(token) - 1] == '*'){
+                term = prefix_postings(qr, token, &prefix);
+            }
+            else if(token[0] == '"'){
+                /* a quoted operator is the word */
+                char word[strlen(token)];
+                memcpy(word, token + 1, strlen(token) - 2);
+                word[strlen(token) - 2] = '\0';
+                term = qindexfind(qr->index, word);
+            }
+            else {
+                term = qindexfind(qr->index, token);
+            }
+            if(!term){
+                empty = true;   // the whole group matches nothing
+                continue;
+            }
+            bool repeated = false;  // a AND a is a
+            for(int j = 0; j < and_plan->num_children; j++){
+                repeated = repeated || and_plan->children[j]->term == term;
+            }
+            if(phrase || prefix){
+                plan_t *owned_plan = new_plan(phrase ? PLAN_PHRASE : PLAN_PREFIX, 0);
+                owned_plan->word = token;
+                owned_plan->term = term;
+                owned_plan->cost = term->df;
+                and_plan->children[and_plan->num_children++] = owned_plan;
+            }
+            else if(!repeated){
+                plan_t *term_plan = new_plan(PLAN_TERM, 0);
+                term_plan->word = token;
+                term_plan->term = term;
+                term_plan->cost = term->df;
+                and_plan->children[and_plan->num_children++] = term_plan;
+            }
+            continue;
+        }
+
+        /* end of a group: order it by ascending document frequency */
+        if(and_plan && !empty && and_plan->num_children > 0){
+            qsort(and_plan->children, and_plan->num_children, sizeof(plan_t*), plan_comparator);
+            and_plan->cost = and_plan->children[0]->cost;
+            or_plan->cost += and_plan->cost;
+            or_plan->children[or_plan->num_children++] = and_plan;
+        }
+        else if(and_plan){
+            free_plan(and_plan);
+        }
+        and_plan = NULL;
+        empty = false;
+    }
+    return or_plan;
+}
+
+/* postings built for a query, which take over ids and counts */
+static postings_t* new_postings(int *ids, int *counts, int df){
+    postings_t *pp = calloc(1, sizeof(postings_t));
+    pp->df = df;
+    pp->ids = ids;
+    pp->counts = counts;
+    for(int i = 0; i < df; i++){
+        if(counts[i] > pp->max_count)
+            pp->max_count = counts[i];
+    }
+    return pp;
+}
+
+static int df_comparator(const void *a, const void *b){
+    const postings_t *pa = *(postings_t* const*)a, *pb = *(postings_t* const*)b;
+    return (pa->df > pb->df) - (pa->df < pb->df);
+}
+
+static postings_t* phrase_postings(querier_t *qr, char *phrase){
+    char words[strlen(phrase) + 1], *saveptr;
+    int num_words = 1;
+    strcpy(words, phrase + 1);
+    words[strlen(words) - 1] = '\0';
+    for(char *c = words; *c; c++){
+        num_words += *c == ' ';
+    }
+
+    /* each word of the phrase, and the words from rarest to commonest */
+    postings_t *terms[num_words], *order[num_words];
+    int at[num_words];          // document of each word being looked at
+    int here[num_words];        // the word's count in that document
+    int max_count = 1, k = 0;
+    for(char *word = strtok_r(words, " ", &saveptr); word; word = strtok_r(NULL, " ", &saveptr), k++){
+        if(!(terms[k] = order[k] = qindexfind(qr->index, word)))
+            return NULL;
+        if(terms[k]->max_count > max_count)
+            max_count = terms[k]->max_count;
+        at[k] = 0;
+    }
+    qsort(order, num_words, sizeof(postings_t*), df_comparator);
+
+    /* the documents holding every word */
+    int *ids = malloc((order[0]->df + 1) * sizeof(int));
+    int *next = malloc((order[0]->df + 1) * sizeof(int)), *swap;
+    int count = intersect(order[0]->ids, order[0]->df, order[1]->ids, order[1]->df, ids);
+    for(int i = 2; i < num_words && count > 0; i++){
+        count = intersect(ids, count, order[i]->ids, order[i]->df, next);
+        swap = ids; ids = next; next = swap;
+    }
+
+    /* keep the documents where the words follow each other: a start of the 
+     * phrase is a position of its first word, and of its k-th word minus k */
+    int *starts = malloc(max_count * sizeof(int)), *positions = malloc(max_count * sizeof(int));
+    int *counts = next, num_docs = 0;
+    for(int i = 0; i < count; i++){
+        int num_starts;
+        for(k = 0; k < num_words; k++){
+            at[k] = intersect_seek(terms[k]->ids, terms[k]->df, at[k], ids[i], NULL);
+            here[k] = terms[k]->counts[at[k]];
+        }
+        /* start from the word with the fewest positions here */
+        int first = 0;
+        for(k = 1; k < num_words; k++){
+            if(here[k] < here[first])
+                first = k;
+        }
+        num_starts = qindexpositions(terms[first], at[first], starts);
+        for(int j = 0; j < num_starts; j++){
+            starts[j] -= first;
+        }
+        for(k = 0; k < num_words && num_starts > 0; k++){
+            if(k == first)
+                continue;
+            int num_positions = qindexpositions(terms[k], at[k], positions), kept = 0;
+            for(int a = 0, b = 0; a < num_starts && b < num_positions;){
+                if(starts[a] < positions[b] - k)
+                    a++;
+                else if(starts[a] > positions[b] - k)
+                    b++;
+                else {
+                    starts[kept++] = starts[a];
+                    a++;
+                    b++;
+                }
+            }
+            num_starts = kept;
+        }
+        if(num_starts > 0){
+            ids[num_docs] = ids[i];
+            counts[num_docs++] = num_starts;
+        }
+    }
+    free(starts);
+    free(positions);
+    if(num_docs == 0){
+        free(ids);
+        free(counts);
         return NULL;
-    document_t *dp;
-    rankedDoc_t *doc;
-    int word_count, rank;
-    while((dp = qget(qp2))){
-        word_count = dp->word_count;
-        if ((doc=qsearch(qp1, doc_searchfn, &(dp->id)))) {
-            rank = doc->word_count;
-            doc->word_count = rank + word_count;
-        } else{
-            doc = init_doc(dp->id,word_count);
-            qput(qp1, doc);
+    }
+
+    return new_postings(ids, counts, num_docs);
+}
+
+/* moves term i of a heap of terms down to its place by current document */
+static void sift_down(postings_t *terms, int *at, int *heap, int size, int i){
+    while(true){
+        int smallest = i;
+        for(int child = 2*i + 1; child <= 2*i + 2 && child < size; child++){
+            if(terms[heap[child]].ids[at[heap[child]]] < terms[heap[smallest]].ids[at[heap[smallest]]])
+                smallest = child;
+        }
+        if(smallest == i)
+            return;
+        int tmp = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = tmp;
+        i = smallest;
+    }
+}
+
+static postings_t* prefix_postings(querier_t *qr, char *token, bool *owned){
+    char prefix[strlen(token)];
+    memcpy(prefix, token, strlen(token) - 1);
+    prefix[strlen(token) - 1] = '\0';
+    postings_t *terms;
+    int num_terms = qindexprefix(qr->index, prefix, &terms);
+    *owned = num_terms > 1;
+    if(num_terms <= 1)
+        return num_terms == 1 ? terms : NULL;
+
+    /* merge the lists through a heap of the words by current document */
+    size_t total = 0;
+    for(int i = 0; i < num_terms; i++){
+        total += terms[i].df;
+    }
+    int *ids = malloc((total + 1) * sizeof(int)), *counts = malloc((total + 1) * sizeof(int));
+    int *heap = malloc(num_terms * sizeof(int)), *at = calloc(num_terms, sizeof(int));
+    int size = 0, num_docs = 0;
+    for(int i = 0; i < num_terms; i++){
+        if(terms[i].df > 0)
+            heap[size++] = i;
+    }
+    for(int i = size / 2 - 1; i >= 0; i--){
+        sift_down(terms, at, heap, size, i);
+    }
+    while(size > 0){
+        int t = heap[0], id = terms[t].ids[at[t]];
+        if(num_docs > 0 && ids[num_docs - 1] == id){
+            counts[num_docs - 1] += terms[t].counts[at[t]];
+        }
+        else {
+            ids[num_docs] = id;
+            counts[num_docs++] = terms[t].counts[at[t]];
+        }
+        if(++at[t] == terms[t].df)
+            heap[0] = heap[--size];
+        sift_down(terms, at, heap, size, 0);
+    }
+    free(heap);
+    free(at);
+    return new_postings(ids, counts, num_docs);
+}
+
+static void free_postings(postings_t *pp){
+    free(pp->ids);
+    free(pp->counts);
+    free(pp);
+}
+
+static int term_comparator(const void *a, const void *b){
+    return strcmp(*(const char* const*)a, *(const char* const*)b);
+}
+
+/* builds the intersection cache key of a set of words: the words sorted 
+ * and space separated */
+static char *words_key(const char **words, int num_terms){
+    const char *sorted[num_terms];
+    size_t len = 1;
+    for(int i = 0; i < num_terms; i++){
+        sorted[i] = words[i];
+        len += strlen(sorted[i]) + 1;
+    }
+    qsort(sorted, num_terms, sizeof(char*), term_comparator);
+    char *key = malloc(len);
+    key[0] = '\0';
+    for(int i = 0; i < num_terms; i++){
+        strcat(key, sorted[i]);
+        if(i < num_terms - 1)
+            strcat(key, " ");
+    }
+    return key;
+}
+
+/* the intersection cache key of the words of an AND plan */
+static char *and_key(plan_t *plan){
+    const char *words[plan->num_children];
+    for(int i = 0; i < plan->num_children; i++)
+        words[i] = plan->children[i]->word;
+    return words_key(words, plan->num_children);
+}
+
+/* caches the count documents of an intersection, ids then ranks, under 
+ * key; cost is what computing it took */
+static void put_and(querier_t *qr, char *key, const int *ids, const int *counts, int count, double cost){
+    size_t len = sizeof(cached_and_t) + 2 * count * sizeof(int);
+    cached_and_t *value = malloc(len);
+    if(!value)
+        return;
+    value->cost = cost;
+    value->count = count;
+    if(count > 0){
+        memcpy(value->data, ids, count * sizeof(int));
+        memcpy(value->data + count, counts, count * sizeof(int));
+    }
+    gdput(qr->and_cache, key, value, len, cost);
+    free(value);
+}
+
+/* a posting list: ids, increasing, and the rank of each */
+typedef struct list {
+    const int *ids;
+    const int *counts;
+    int df;
+    const int *block_max;   // may be NULL
+    const uint16_t *by_id;  // counts by id, may be NULL (see qindex.h)
+    const char *word;       // the word listed, NULL for an intersection
+} list_t;
+
+/* ranks the ids found in every one of the lists by their smallest count
+ * there; the result lives in *buffer, which the caller frees */
+static list_t rank_list(int *ids, int count, list_t *lists, int num_lists, int **buffer){
+    int *ranks = malloc((count + 1) * sizeof(int));
+    for(int i = 0; i < count; i++){
+        ranks[i] = INT_MAX;
+    }
+    for(int j = 0; j < num_lists; j++){
+        if(lists[j].by_id){
+            for(int i = 0; i < count; i++){
+                if(lists[j].by_id[ids[i]] < ranks[i])
+                    ranks[i] = lists[j].by_id[ids[i]];
+            }
+            continue;
+        }
+        cursor_t *word = cursorterm(lists[j].ids, lists[j].counts, lists[j].df, lists[j].block_max);
+        for(int i = 0; i < count; i++){
+            cursoradvance(word, ids[i]);
+            if(cursorscore(word) < ranks[i])
+                ranks[i] = cursorscore(word);
+        }
+        cursorclose(word);
+    }
+    *buffer = ranks;
+    return (list_t){ ids, ranks, count, NULL, NULL, NULL };
+}
+
+static cursor_t* and_cursor(querier_t *qr, plan_t *plan, and_state_t *state){
+    int num_terms = plan->num_children, n = 0, num_dense = 0;
+    list_t lists[num_terms], dense[num_terms], tmp;
+    cursor_t *children[num_terms];
+    roaring_t *bitmaps[num_terms];
+    postings_t *term;
+
+    /* the whole plan is cached once its cursor is exhausted (cache_and) */
+    if(qr->and_cache && num_terms > 1){
+        char *key = and_key(plan);
+        state->hit = gdget(qr->and_cache, key, NULL);
+        free(key);
+        if(state->hit){
+            cached_and_t *hit = state->hit;
+            state->base_cost = hit->cost;
+            return cursorterm(hit->data, hit->data + hit->count, hit->count, NULL);
+        }
+    }
+    for(int k = 0; k < num_terms; k++){
+        term = plan->children[k]->term;
+        tmp = (list_t){ term->ids, term->counts, term->df, term->block_max, term->dense_counts,
+                        plan->children[k]->word };
+        if(term->bitmap){
+            bitmaps[num_dense] = term->bitmap;
+            dense[num_dense++] = tmp;
+        }
+        else
+            lists[n++] = tmp;
+    }
+
+    /* intersect the bitmaps of the dense words, rarest first */
+    if(num_dense == 1){
+        lists[n++] = dense[0];
+    }
+    else if(num_dense > 1){
+        roaring_t *set = roaringandall(bitmaps, num_dense);
+        int *ids = malloc((roaringcount(set) + 1) * sizeof(int));
+        int count = roaringtoarray(set, ids);
+        roaringclose(set);
+        lists[n++] = rank_list(ids, count, dense, num_dense, &state->dense_ranks);
+        state->dense = ids;
+    }
+
+    /* the cursors are walked in order: shortest list first */
+    for(int i = 1; i < n; i++){
+        tmp = lists[i];
+        int j = i;
+        for(; j > 0 && lists[j-1].df > tmp.df; j--)
+            lists[j] = lists[j-1];
+        lists[j] = tmp;
+    }
+
+    /* the two shortest lists are intersected by the vector kernels; when 
+     * they are two words of a longer plan the pair is cached on its own, 
+     * so that conjunctions sharing the two words reuse it */
+    if(n >= 2){
+        char *key = NULL;
+        if(qr->and_cache && num_terms > 2 && lists[0].word && lists[1].word){
+            const char *pair[2] = { lists[0].word, lists[1].word };
+            key = words_key(pair, 2);
+            state->pair_hit = gdget(qr->and_cache, key, NULL);
         }
-        qput(tmp, dp);
+        if(state->pair_hit){
+            cached_and_t *hit = state->pair_hit;
+            state->base_cost += hit->cost;
+            lists[1] = (list_t){ hit->data, hit->data + hit->count, hit->count, NULL, NULL, NULL };
+        }
+        else {
+            int *ids = malloc((lists[0].df + 1) * sizeof(int));
+            int count = intersect(lists[0].ids, lists[0].df, lists[1].ids, lists[1].df, ids);
+            double cost = lists[0].df + lists[1].df;
+            state->base_cost += cost;
+            lists[1] = rank_list(ids, count, lists, 2, &state->pair_ranks);
+            state->pair = ids;
+            if(key)
+                put_and(qr, key, ids, state->pair_ranks, count, cost);
+        }
+        free(key);
+        for(int i = 0; i < n - 1; i++)
+            lists[i] = lists[i+1];
+        n--;
+    }
+
+    for(int i = 0; i < n; i++){
+        children[i] = cursorterm(lists[i].ids, lists[i].counts, lists[i].df, lists[i].block_max);
     }
+    cursor_t *cursor = n == 1 ? children[0] : cursorand(children, n);
+    if(qr->and_cache && num_terms > 1)
+        cursor = state->record = cursorrecord(cursor);
+    return cursor;
+}
+
+/* a document kept by get_top */
+typedef struct top {
+    int id;
+    int rank;
+} top_t;
+
+/* whether a ranks below b in the printed order */
+static bool top_worse(top_t *a, top_t *b){
+    return a->rank < b->rank || (a->rank == b->rank && a->id > b->id);
+}
 
-    // restore qp2
-    while((dp = qget(tmp)))
-        qput(qp2, dp);
-    qclose(tmp);
-    return qp1;
+static void get_top(cursor_t *root, int k, ranked_t *ranked_docs){
+    top_t *heap = malloc(k * sizeof(top_t)), tmp;     // the worst on top
+    int count = 0;
+
+    for(int id = cursordoc(root); id != CURSOR_END; id = cursornext(root)){
+        top_t doc = { id, cursorscore(root) };
+        int i = 0;
+        if(count < k){
+            /* sift up */
+            heap[i = count++] = doc;
+            while(i > 0 && top_worse(&heap[i], &heap[(i-1)/2])){
+                tmp = heap[i], heap[i] = heap[(i-1)/2], heap[(i-1)/2] = tmp;
+                i = (i-1)/2;
+            }
+        }
+        else if(top_worse(&heap[0], &doc)){
+            /* sift down */
+            heap[0] = doc;
+            while(true){
+                int l = 2*i + 1, r = l + 1, worst = i;
+                if(l < count && top_worse(&heap[l], &heap[worst])) worst = l;
+                if(r < count && top_worse(&heap[r], &heap[worst])) worst = r;
+                if(worst == i)
+                    break;
+                tmp = heap[i], heap[i] = heap[worst], heap[worst] = tmp;
+                i = worst;
+            }
+        }
+        else {
+            continue;
+        }
+        /* later documents have larger ids, so they must rank strictly higher */
+        if(count == k)
+            cursorthreshold(root, heap[0].rank);
+    }
+
+    rankedDoc_t **docs = malloc((count ? count : 1) * sizeof(rankedDoc_t*));
+    int n = 0;
+    for(int i = 0; docs && i < count; i++){
+        if((docs[n] = init_doc(heap[i].id, heap[i].rank)))
+            n++;
+    }
+    if(docs)
+        ranked_append(ranked_docs, docs, n);
+    free(docs);
+    free(heap);
 }
 
-static void get_metadata(queue_t *ranked_docs, char *pagedir){
+static void cache_and(querier_t *qr, plan_t *plan, and_state_t *state){
+    int *ids, *counts;
+    /* only a list walked to its end is the whole intersection */
+    if(cursordoc(state->record) != CURSOR_END)
+        return;
+    int count = cursorrecorded(state->record, &ids, &counts);
+    if(count < 0)
+        return;
+
+    char *key = and_key(plan);
+    put_and(qr, key, ids, counts, count, state->base_cost + cursorcost(state->record));
+    free(key);
+}
+
+static void get_metadata(ranked_t *ranked_docs, char *pagedir){
     rankedDoc_t *dp;
-    queue_t *tmp = qopen();
     int id, len; webpage_t *page; char *url, *html, *start, *end, *content;
-    while((dp = qget(ranked_docs))){
+    for(int i = 0; i < ranked_size(ranked_docs); i++){
+        dp = *ranked_at(ranked_docs, i);
         id = dp->id;
         if((page = pageload(id, pagedir))){
             url = webpage_getURL(page);
@@ -444,23 +1672,42 @@ static void get_metadata(queue_t *ranked_docs, char *pagedir){
             }
 
         }
-        qput(tmp, dp);
         webpage_delete(page);
     }
-
-    while((dp = qget(tmp)))
-        qput(ranked_docs, dp);
-    qclose(tmp);
 }
 
-static int parse_args(int argc, char *argv[], char **pagedir, char **indexfile){
-    if (argc < 3 || argc > 4) {
-        fprintf(stderr, "usage: query <pageDirectory> <indexFile> [-q]\n");
+static int parse_args(int argc, char *argv[], char **pagedir, char **indexfile, options_t *opts){
+    const char *usage = "usage: query <pageDirectory> <indexFile> [-q] [-s <socket> | -b <queryfile>] [-t <threads>] [-c <megabytes>] [-i <megabytes>] [-k <results>]\n";
+    opts->quiet = false;
+    opts->socket = NULL;
+    opts->batch = NULL;
+    opts->threads = DEFAULT_THREADS;
+    opts->cache_mb = DEFAULT_CACHE_MB;
+    opts->and_cache_mb = DEFAULT_CACHE_MB;
+    opts->top_k = 0;
+    if (argc < 3) {
+        fprintf(stderr, "%s", usage);
         return -1;
     }
-    if (argc == 4 && strcmp(argv[3], "-q") != 0) {
-        fprintf(stderr, "usage: query <pageDirectory> <indexFile> [-q]\n");
-        return -1;
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "-q") == 0) {
+            opts->quiet = true;
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            opts->socket = argv[++i];
+        } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            opts->batch = argv[++i];
+        } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc && atoi(argv[i+1]) >= 0) {
+            opts->cache_mb = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc && atoi(argv[i+1]) >= 0) {
+            opts->and_cache_mb = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-k") == 0 && i + 1 < argc && atoi(argv[i+1]) >= 0) {
+            opts->top_k = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc && atoi(argv[i+1]) > 0) {
+            opts->threads = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "%s", usage);
+            return -1;
+        }
     }
     if(!(*pagedir=malloc(strlen(argv[1])+1))){
         fprintf(stderr, "error: failed to allocate memory for page directory\n");
@@ -481,17 +1728,19 @@ static int parse_args(int argc, char *argv[], char **pagedir, char **indexfile){
         return -1;
     }
 
-    // Verify indexfile exists and is a readable file
-    if (stat(argv[2], &file_stat) != 0) {
+    // Verify indexfile, or its manifest once compacted, exists and is a readable file
+    char manifest[1024], *checked = argv[2];
+    snprintf(manifest, sizeof(manifest), "%s.manifest", argv[2]);
+    if (stat(checked, &file_stat) != 0 && stat(checked = manifest, &file_stat) != 0) {
         fprintf(stderr, "Error: indexfile '%s' does not exist or cannot be accessed.\n", argv[2]);
         return -1;
     }
     if (!S_ISREG(file_stat.st_mode)) {
-        fprintf(stderr, "Error: '%s' is not a regular file.\n", argv[2]);
+        fprintf(stderr, "Error: '%s' is not a regular file.\n", checked);
         return -1;
     }
-    if (access(argv[2], R_OK) != 0) {
-        fprintf(stderr, "Error: '%s' cannot be read.\n", argv[2]);
+    if (access(checked, R_OK) != 0) {
+        fprintf(stderr, "Error: '%s' cannot be read.\n", checked);
         return -1;
     }
     strcpy(*pagedir, argv[1]);
@@ -499,16 +1748,6 @@ static int parse_args(int argc, char *argv[], char **pagedir, char **indexfile){
     return 0;
 }
 
-static bool token_searchfn(void *elementp, const void *key){
-    entry_t *ep = (entry_t*)elementp;
-    return strcmp(ep->word,(char*)key)==0;
-}
-
-static bool doc_searchfn(void *elementp, const void *id){
-    rankedDoc_t *dp = (rankedDoc_t*)elementp;
-    return dp->id == *((int*)id);
-}
-
 static int comparator(const void *a, const void *b) {
     const rankedDoc_t *doc_a = *(const rankedDoc_t**)a;
     const rankedDoc_t  *doc_b = *(const rankedDoc_t**)b;
@@ -517,34 +1756,8 @@ static int comparator(const void *a, const void *b) {
     } else if (doc_a->word_count > doc_b->word_count) {
         return -1;
     } else {
-        return 0;
-    }
-}
-
-static void sort_queue(queue_t **qp){
-    queue_t **tmp = NULL;
-    int count = 0;
-
-    // loop through the queue, adding each document to the array
-    rankedDoc_t *doc;
-    while ((doc = (rankedDoc_t*)qget(qp)) != NULL) {
-        // resize the array to hold another element
-        count++;
-        tmp = realloc(tmp, count * sizeof(rankedDoc_t*));
-
-        // add the document to the end of the array
-        tmp[count - 1] = doc;
+        return (doc_a->id > doc_b->id) - (doc_a->id < doc_b->id);
     }
-
-    // sort the array based on the rank
-    qsort(tmp, count, sizeof(rankedDoc_t*), comparator);
-
-    // add the sorted documents back to the queue
-    for (int i = 0; i < count; i++) {
-        qput(qp, tmp[i]);
-    }
-
-    free(tmp);
 }
 
 static void free_doc(rankedDoc_t *dp){
@@ -554,9 +1767,9 @@ static void free_doc(rankedDoc_t *dp){
     if(dp) free(dp);
 }
 
-static void free_queue(queue_t *qp){
+static void free_queue(ranked_t *qp){
     rankedDoc_t *dp;
-    while((dp=qget(qp)))
+    while(ranked_get(qp, &dp))
         free_doc(dp);
-    qclose(qp);
+    ranked_free(qp);
 }
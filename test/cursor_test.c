@@ -0,0 +1,177 @@
+/* 
+ * cursor_test.c -- tests the cursor module
+ *
+ * Author: Ian Kamweru, Abdibaset, Nathaniel Mensah
+ * Version: 1.0
+ * 
+ * Description: builds random posting lists and checks that AND and
+ * OR cursors, walked with next and advance, match the documents and
+ * ranks computed directly from the lists, and that records are only
+ * complete when their cursor was walked to its end
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "cursor.h"
+
+#define NLISTS 4
+#define MAXDOC 2000
+
+static int ids[NLISTS][MAXDOC], counts[NLISTS][MAXDOC], df[NLISTS];
+static int rank[NLISTS][MAXDOC+1];     // count of list i in a document, 0 if absent
+
+/* fills list i with documents drawn with probability 1/every */
+static void fill(int i, int every){
+    df[i] = 0;
+    for (int doc = 1; doc <= MAXDOC; doc++){
+        rank[i][doc] = 0;
+        if (rand() % every == 0){
+            ids[i][df[i]] = doc;
+            counts[i][df[i]++] = rank[i][doc] = 1 + rand() % 9;
+        }
+    }
+}
+
+/* expected rank of doc under the AND (or OR) of the lists; 0 if unmatched */
+static int expected(int doc, int and){
+    int r = and ? rank[0][doc] : 0;
+    for (int i = 0; i < NLISTS; i++){
+        if (and && (rank[i][doc] == 0 || rank[i][doc] < r))
+            r = rank[i][doc];
+        if (!and)
+            r += rank[i][doc];
+    }
+    return r;
+}
+
+static cursor_t *open_lists(int and){
+    cursor_t *children[NLISTS];
+    for (int i = 0; i < NLISTS; i++)
+        children[i] = cursorterm(ids[i], counts[i], df[i], NULL);
+    return and ? cursorand(children, NLISTS) : cursoror(children, NLISTS);
+}
+
+/* walks a WAND cursor raising its threshold to the k-th best rank seen,
+ * as a top-k query would; the k best ranks must match the OR's */
+static int check_top(int k){
+    cursor_t *children[NLISTS];
+    int best[MAXDOC+1] = { 0 }, found[MAXDOC+1] = { 0 }, count = 0;
+
+    for (int doc = 1; doc <= MAXDOC; doc++)
+        best[expected(doc, 0)]++;
+    for (int i = 0; i < NLISTS; i++)
+        children[i] = cursorterm(ids[i], counts[i], df[i], NULL);
+    cursor_t *cp = cursorwand(children, NLISTS);
+
+    for (int doc = cursordoc(cp); doc != CURSOR_END; doc = cursornext(cp)){
+        if (cursorscore(cp) != expected(doc, 0))
+            return 1;
+        found[cursorscore(cp)]++;
+        /* the k-th best rank found so far */
+        int seen = 0, r = MAXDOC;
+        for (; r > 0 && seen + found[r] < k; r--)
+            seen += found[r];
+        if (r > 0)
+            cursorthreshold(cp, r);
+    }
+    cursorclose(cp);
+
+    /* the counts of the k best ranks must agree */
+    for (int r = MAXDOC; r > 0 && count < k; r--){
+        int take = best[r] < k - count ? best[r] : k - count;
+        if (found[r] < take)
+            return 1;
+        count += take;
+    }
+    return 0;
+}
+
+/* walks a cursor with next, or with advance to random targets; every
+ * document not skipped must be matched exactly when it should be */
+static int check(int and, bool skip){
+    cursor_t *cp = open_lists(and);
+    int from = 1, errors = 0;
+
+    for (int doc = cursordoc(cp); doc != CURSOR_END; doc = cursordoc(cp)){
+        for (; from < doc; from++){
+            if (expected(from, and) != 0)
+                errors++;
+        }
+        if (cursorscore(cp) != expected(doc, and))
+            errors++;
+        from = doc + 1;
+        if (skip && rand() % 2){
+            from = doc + 1 + rand() % 50;
+            cursoradvance(cp, from);
+        }
+        else {
+            cursornext(cp);
+        }
+    }
+    for (; from <= MAXDOC; from++){
+        if (expected(from, and) != 0)
+            errors++;
+    }
+    cursorclose(cp);
+    return errors;
+}
+
+int main(void){
+    srand(50);
+    fill(0, 10);    // rare
+    fill(1, 2);
+    fill(2, 2);
+    fill(3, 3);
+
+    int errors = 0;
+    for (int and = 0; and <= 1; and++){
+        errors += check(and, false) + check(and, true);
+    }
+    for (int k = 1; k <= 100; k *= 10){
+        errors += check_top(k);
+    }
+    if (errors != 0){
+        printf("%d cursor mismatches\n", errors);
+        exit(EXIT_FAILURE);
+    }
+
+    /* the record of a fully walked cursor holds every match */
+    cursor_t *cp = cursorrecord(open_lists(1));
+    int matches = 0;
+    for (int doc = 1; doc <= MAXDOC; doc++)
+        matches += expected(doc, 1) != 0;
+    while (cursornext(cp) != CURSOR_END)
+        ;
+    if (cursorrecorded(cp, NULL, NULL) != matches){
+        printf("Record holds %d documents, expected %d\n", cursorrecorded(cp, NULL, NULL), matches);
+        exit(EXIT_FAILURE);
+    }
+    cursorclose(cp);
+
+    /* skipping leaves the record incomplete */
+    cp = cursorrecord(open_lists(0));
+    cursoradvance(cp, MAXDOC / 2);
+    if (cursorrecorded(cp, NULL, NULL) >= 0){
+        printf("Record should be incomplete after skipping\n");
+        exit(EXIT_FAILURE);
+    }
+    cursorclose(cp);
+
+    /* a pruned top-k OR over an AND group leaves the group's record
+     * incomplete: once the threshold is out of reach the walk stops
+     * before the group's end */
+    cursor_t *group[2] = { cursorterm(ids[1], counts[1], df[1], NULL),
+                           cursorterm(ids[2], counts[2], df[2], NULL) };
+    cursor_t *record = cursorrecord(cursorand(group, 2));
+    cursor_t *groups[2] = { record, cursorterm(ids[3], counts[3], df[3], NULL) };
+    cp = cursorwand(groups, 2);
+    cursorthreshold(cp, cursormax(record) + cursormax(groups[1]));
+    if (cursornext(cp) != CURSOR_END || cursorrecorded(record, NULL, NULL) >= 0){
+        printf("Record should be incomplete after a pruned top-k walk\n");
+        exit(EXIT_FAILURE);
+    }
+    cursorclose(cp);
+    printf("Cursors matched successfully: %d AND matches\n", matches);
+    exit(EXIT_SUCCESS);
+}
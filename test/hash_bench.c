@@ -0,0 +1,178 @@
+/*
+ * hash_bench.c -- compares the hash functions of the hash table
+ *
+ * Author: Ian Kamweru, Abdibaset, Nathaniel Mensah
+ * Version: 1.0
+ *
+ * Description: takes the words of an index and the urls of a
+ * directory of crawled pages as key sets, then for every hash function
+ * times hashing the keys, measures how evenly they fall into as many
+ * buckets as a table holding them has, and times putting them in a
+ * table and finding them again, checking that every key is found
+ *
+ * usage: hash_bench [<indexfile> [<pagedir>]]
+ */
+
+#define _POSIX_C_SOURCE 200809L    // clock_gettime, strdup
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "hash.h"
+#include "indexio.h"
+#include "pageio.h"
+#include "webpage.h"
+
+#define ROUNDS 20
+#define SEED 0x5eed
+
+typedef struct keys {
+    char **key;
+    int count;
+    long bytes;
+} keys_t;
+
+static void add_key(keys_t *keys, char *key){
+    keys->key = realloc(keys->key, (keys->count + 1) * sizeof(char*));
+    keys->key[keys->count++] = key;
+}
+
+static void entry_fn(void *elementp, void *arg){
+    add_key((keys_t*)arg, strdup(((entry_t*)elementp)->word));
+}
+
+static int str_cmp(const void *a, const void *b){
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+/* sorts the keys, dropping repeats */
+static void unique(keys_t *keys){
+    int n = 0;
+    qsort(keys->key, keys->count, sizeof(char*), str_cmp);
+    keys->bytes = 0;
+    for (int i = 0; i < keys->count; i++){
+        if (n > 0 && strcmp(keys->key[i], keys->key[n - 1]) == 0){
+            free(keys->key[i]);
+            continue;
+        }
+        keys->key[n++] = keys->key[i];
+        keys->bytes += strlen(keys->key[i]);
+    }
+    keys->count = n;
+}
+
+static bool str_eq(void *elementp, const void *keyp){
+    return strcmp((char*)elementp, (const char*)keyp) == 0;
+}
+
+static double now(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* returns the number of keys not found again */
+static int bench(const char *name, hashfn_t fn, keys_t *keys){
+    int n = keys->count, *lens = malloc(n * sizeof(int));
+    for (int i = 0; i < n; i++)
+        lens[i] = strlen(keys->key[i]);
+
+    /* hashing alone */
+    volatile uint64_t sink = 0;
+    double start = now();
+    for (int r = 0; r < ROUNDS; r++){
+        for (int i = 0; i < n; i++)
+            sink += fn(keys->key[i], lens[i], SEED);
+    }
+    double hashing = (now() - start) / ((double)ROUNDS * n);
+
+    /* bucket loads where a table would have them: the fewest buckets,
+     * a power of two, not fewer than the keys. The ratio is that of the
+     * probes to find every key to those of uniformly random hashes,
+     * so 1.0 is ideal and higher is worse */
+    uint32_t size = 1;
+    while (size < (uint32_t)n)
+        size <<= 1;
+    int *loads = calloc(size, sizeof(int)), longest = 0;
+    for (int i = 0; i < n; i++){
+        int *lp = &loads[fn(keys->key[i], lens[i], SEED) & (size - 1)];
+        if (++*lp > longest)
+            longest = *lp;
+    }
+    double probes = 0;
+    for (uint32_t b = 0; b < size; b++)
+        probes += loads[b] * (loads[b] + 1.0) / 2;
+    double ratio = probes / ((n / (2.0 * size)) * (n + 2.0 * size - 1));
+
+    /* through the table, grown from one bucket */
+    int missing = 0;
+    start = now();
+    hashtable_t *ht = hopen_with(1, fn, SEED);
+    for (int i = 0; i < n; i++)
+        hput(ht, strdup(keys->key[i]), keys->key[i], lens[i]);
+    for (int i = 0; i < n; i++){
+        if (hsearch(ht, str_eq, keys->key[i], lens[i]) == NULL)
+            missing++;
+    }
+    hclose(ht);
+    double table = (now() - start) / n;
+
+    printf("  %-10s %7.1f ns/key %8.1f MB/s   ratio %5.3f  longest %2d   put+search %7.1f ns/key\n",
+           name, hashing * 1e9, keys->bytes / (double)n / hashing / 1e6, ratio, longest, table * 1e9);
+    free(loads);
+    free(lens);
+    return missing;
+}
+
+int main(int argc, char *argv[]){
+    char *indexnm = argc > 1 ? argv[1] : "test_index";
+    char *pagedir = argc > 2 ? argv[2] : ".";
+    keys_t words = { NULL, 0, 0 }, urls = { NULL, 0, 0 };
+
+    hashtable_t *index = indexload(indexnm);
+    if (!index){
+        printf("usage: hash_bench [<indexfile> [<pagedir>]]\n");
+        exit(EXIT_FAILURE);
+    }
+    happly_arg(index, entry_fn, &words);
+    free_entries(index);
+    hclose(index);
+
+    webpage_t *page;
+    for (int id = 1; (page = pageload(id, pagedir)) != NULL; id++){
+        char *url;
+        add_key(&urls, strdup(webpage_getURL(page)));
+        for (int pos = 0; (pos = webpage_getNextURL(page, pos, &url)) > 0; )
+            add_key(&urls, url);
+        webpage_delete(page);
+    }
+    unique(&words);
+    unique(&urls);
+    if (words.count == 0 || urls.count == 0){
+        printf("No words in %s or no urls in %s\n", indexnm, pagedir);
+        exit(EXIT_FAILURE);
+    }
+
+    struct { const char *name; hashfn_t fn; } hashes[] = {
+        { "wyhash", hash_wy },
+        { "fnv1a", hash_fnv1a },
+        { "superfast", hash_superfast },
+    };
+    keys_t *sets[] = { &words, &urls };
+    int missing = 0;
+    for (int s = 0; s < 2; s++){
+        printf("%d %s, %.1f bytes on average\n", sets[s]->count, s == 0 ? "words" : "urls",
+               sets[s]->bytes / (double)sets[s]->count);
+        for (int h = 0; h < 3; h++)
+            missing += bench(hashes[h].name, hashes[h].fn, sets[s]);
+        for (int i = 0; i < sets[s]->count; i++)
+            free(sets[s]->key[i]);
+        free(sets[s]->key);
+    }
+    if (missing != 0){
+        printf("%d keys not found in the table\n", missing);
+        exit(EXIT_FAILURE);
+    }
+    exit(EXIT_SUCCESS);
+}
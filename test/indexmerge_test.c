@@ -0,0 +1,73 @@
+/* 
+ * indexmerge_test.c -- tests the indexmerge module
+ *
+ * Author: Ian Kamweru, Abdibaset, Nathaniel Mensah
+ * Version: 1.0
+ * 
+ * Description: merges a saved index with itself, with and without
+ * remapping document ids, and checks the merged document lists
+ */
+
+#include <stdio.h>
+#include "indexio.h"
+#include "indexmerge.h"
+
+static int ndocs;
+
+static void count_fn(void *ep){
+    ndocs++;
+}
+
+static void sum_fn(void *ep){
+    qapply(((entry_t*)ep)->documents, count_fn);
+}
+
+/* number of (word, document) pairs in index file indexnm */
+static int count_postings(char *indexnm){
+    hashtable_t *index = indexload(indexnm);
+    if (!index)
+        return -1;
+    ndocs = 0;
+    happly(index, sum_fn);
+    free_entries(index);
+    hclose(index);
+    return ndocs;
+}
+
+int main(void){
+    char *sorted = "test_index_sorted";
+    char *merged = "test_index_merged";
+
+    /* indexsave writes the sorted layout indexmerge needs */
+    hashtable_t *index = indexload("test_index");
+    if (!index || indexsave(index, sorted) != 0)
+        exit(EXIT_FAILURE);
+    free_entries(index);
+    hclose(index);
+    int expected = count_postings(sorted);
+
+    char *inputs[] = { sorted, sorted };
+    if (indexmerge(inputs, 2, NULL, merged) != 0 || count_postings(merged) != expected){
+        printf("Merge without remapping failed\n");
+        exit(EXIT_FAILURE);
+    }
+    printf("Merged duplicate documents successfully: %d postings\n", expected);
+
+    int offsets[] = { 0, index_maxid(sorted) };
+    if (indexmerge(inputs, 2, offsets, merged) != 0 || count_postings(merged) != 2*expected){
+        printf("Merge with remapping failed\n");
+        exit(EXIT_FAILURE);
+    }
+    printf("Merged remapped documents successfully: %d postings\n", 2*expected);
+
+    /* unsorted input is rejected */
+    inputs[1] = "test_index";
+    if (indexmerge(inputs, 2, NULL, merged) == 0){
+        printf("Merge of unsorted index should fail\n");
+        exit(EXIT_FAILURE);
+    }
+
+    remove(sorted);
+    remove(merged);
+    exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,138 @@
+/* 
+ * intersect_bench.c -- compares the intersection kernels
+ *
+ * Author: Ian Kamweru, Abdibaset, Nathaniel Mensah
+ * Version: 1.0
+ * 
+ * Description: draws pairs of words from an index and builds random
+ * posting lists with the same share of the documents, over a corpus
+ * scale times larger, then times every intersection kernel on them
+ * against the scalar merge and checks that they all agree
+ * 
+ * usage: intersect_bench [<indexfile> [<scale>]]
+ */
+
+#define _POSIX_C_SOURCE 200809L    // clock_gettime
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "indexio.h"
+#include "intersect.h"
+
+#define NPAIRS 200
+#define ROUNDS 5
+
+typedef struct dfs {
+    int *df;
+    int count;
+    int maxid;
+} dfs_t;
+
+static void doc_fn(void *elementp, void *arg){
+    document_t *dp = (document_t*)elementp;
+    dfs_t *dfs = (dfs_t*)arg;
+    dfs->df[dfs->count]++;
+    if (dp->id > dfs->maxid)
+        dfs->maxid = dp->id;
+}
+
+static void entry_fn(void *elementp, void *arg){
+    dfs_t *dfs = (dfs_t*)arg;
+    dfs->df = realloc(dfs->df, (dfs->count + 1) * sizeof(int));
+    dfs->df[dfs->count] = 0;
+    qapply_arg(((entry_t*)elementp)->documents, doc_fn, dfs);
+    dfs->count++;
+}
+
+/* n distinct increasing ids drawn from [1, universe] */
+static int *random_list(int n, int universe){
+    int *ids = malloc((n ? n : 1) * sizeof(int)), k = 0;
+    for (int id = 1; id <= universe && k < n; id++){
+        if (rand() % (universe - id + 1) < n - k)
+            ids[k++] = id;
+    }
+    return ids;
+}
+
+static double now(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[]){
+    char *indexnm = argc > 1 ? argv[1] : "test_index";
+    int scale = argc > 2 ? atoi(argv[2]) : 10000;
+    dfs_t dfs = { NULL, 0, 0 };
+
+    hashtable_t *index = indexload(indexnm);
+    if (!index || scale <= 0){
+        printf("usage: intersect_bench [<indexfile> [<scale>]]\n");
+        exit(EXIT_FAILURE);
+    }
+    happly_arg(index, entry_fn, &dfs);
+    free_entries(index);
+    hclose(index);
+    if (dfs.count == 0 || dfs.maxid == 0){
+        printf("Index %s is empty\n", indexnm);
+        exit(EXIT_FAILURE);
+    }
+
+    /* pairs of lists with the document shares of pairs of words */
+    srand(39);
+    int universe = dfs.maxid * scale, *a[NPAIRS], *b[NPAIRS], na[NPAIRS], nb[NPAIRS];
+    long postings = 0;
+    for (int p = 0; p < NPAIRS; p++){
+        na[p] = (int)((long)dfs.df[rand() % dfs.count] * scale);
+        nb[p] = (int)((long)dfs.df[rand() % dfs.count] * scale);
+        a[p] = random_list(na[p], universe);
+        b[p] = random_list(nb[p], universe);
+        postings += na[p] + nb[p];
+    }
+    printf("%d pairs from %d words of %s, %d documents, %.0f postings per pair\n",
+           NPAIRS, dfs.count, indexnm, universe, (double)postings / NPAIRS);
+
+    /* the scalar merge gives the reference results */
+    int *expected[NPAIRS], nexpected[NPAIRS], *out = malloc(universe * sizeof(int));
+    for (int p = 0; p < NPAIRS; p++){
+        expected[p] = malloc((na[p] < nb[p] ? na[p] : nb[p]) * sizeof(int) + 1);
+        nexpected[p] = intersect_with(INTERSECT_SCALAR, a[p], na[p], b[p], nb[p], expected[p]);
+    }
+
+    intersect_kind_t kinds[] = { INTERSECT_SCALAR, INTERSECT_GALLOP, INTERSECT_SSE2, INTERSECT_AVX2, INTERSECT_AUTO };
+    double base = 0;
+    int errors = 0;
+    for (int k = 0; k < 5; k++){
+        if (intersect_with(kinds[k], a[0], na[0], b[0], nb[0], out) < 0){
+            printf("%-14s not supported by this processor\n", intersect_name(kinds[k]));
+            continue;
+        }
+        double start = now();
+        for (int r = 0; r < ROUNDS; r++){
+            for (int p = 0; p < NPAIRS; p++){
+                int n = intersect_with(kinds[k], a[p], na[p], b[p], nb[p], out);
+                if (r == 0 && (n != nexpected[p] || memcmp(out, expected[p], n * sizeof(int)) != 0))
+                    errors++;
+            }
+        }
+        double elapsed = (now() - start) / (ROUNDS * NPAIRS);
+        if (kinds[k] == INTERSECT_SCALAR)
+            base = elapsed;
+        printf("%-14s %10.1f us per pair  %5.2fx\n", intersect_name(kinds[k]), elapsed * 1e6, base / elapsed);
+    }
+
+    for (int p = 0; p < NPAIRS; p++){
+        free(a[p]);
+        free(b[p]);
+        free(expected[p]);
+    }
+    free(out);
+    free(dfs.df);
+    if (errors != 0){
+        printf("%d kernel results differ from the scalar merge\n", errors);
+        exit(EXIT_FAILURE);
+    }
+    exit(EXIT_SUCCESS);
+}
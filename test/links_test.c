@@ -0,0 +1,131 @@
+/*
+ * links_test.c -- tests webpage_getURLs and webpage_getNextURL
+ *
+ * Author: Ian Kamweru, Abdibaset, Nathaniel Mensah
+ * Version: 1.0
+ *
+ * Description: extracts the links of a page of awkward anchors, of a
+ * page of many anchors and of the pages given, in batches of several
+ * sizes and one at a time, checking that they agree, that the first
+ * page gives the links expected and that no html is modified
+ *
+ * usage: links_test [<pagedir>]
+ */
+
+#define _POSIX_C_SOURCE 200809L    // strdup
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "webpage.h"
+#include "pageio.h"
+
+#define BASE "http://example.com/dir/page.html"
+#define MANY 20000
+
+static const char *awkward =
+    "<html><body>\n"
+    "<a href=\"a.html\">relative</a>\n"
+    "<A HREF = 'b.html#part' >spaced, with a fragment</A>\n"
+    "<a title=\"x > y\" href=/c.html>a '>' in a quoted value</a>\n"
+    "<!-- <a href=\"commented.html\"> -->\n"
+    "<a href=\"#top\">internal</a> <a href=\"mailto:me@example.com\">mail</a>\n"
+    "<a href=\"http://other.org/e.html\">absolute</a>\n"
+    "<abbr href=\"abbr.html\">not a link</abbr>\n"
+    "<a data-href=\"data.html\" href=\"h.html\">the real href</a>\n"
+    "x < y <a href=i.html>after a bare '<'</a>\n"
+    "<a href=\"j.html\" href=\"k.html\">the first href</a>\n"
+    "<a\nhref=\"\n l.html \">whitespace around</a>\n"
+    "</body></html>\n";
+
+static const char *expected[] = {
+    "http://example.com/dir/a.html",
+    "http://example.com/dir/b.html",
+    "http://example.com/c.html",
+    "http://other.org/e.html",
+    "http://example.com/dir/h.html",
+    "http://example.com/dir/i.html",
+    "http://example.com/dir/j.html",
+    "http://example.com/dir/l.html",
+};
+
+/* the links of html, checked batch by batch against one at a time;
+ * returns the number of errors, with the links in *links */
+static int extract(char *html, char ***links, int *nlinks){
+    webpage_t *page = webpage_new(BASE, 0, html);
+    char *copy = strdup(html), *url;
+    int errors = 0, n, pos = 0, count = 0;
+
+    *links = NULL;
+    while ((pos = webpage_getNextURL(page, pos, &url)) > 0){
+        *links = realloc(*links, (count + 1) * sizeof(char*));
+        (*links)[count++] = url;
+    }
+    *nlinks = count;
+
+    for (int batch = 1; batch <= 64; batch *= 4){
+        char *urls[64];
+        int got = 0;
+        pos = 0;
+        while ((n = webpage_getURLs(page, &pos, urls, batch)) > 0){
+            for (int i = 0; i < n; i++, got++){
+                if (got >= count || strcmp(urls[i], (*links)[got]) != 0)
+                    errors++;
+                free(urls[i]);
+            }
+        }
+        if (got != count)
+            errors++;
+    }
+    if (strcmp(html, copy) != 0)
+        errors++;
+    free(copy);
+    webpage_delete(page);
+    return errors;
+}
+
+static void free_links(char **links, int n){
+    for (int i = 0; i < n; i++)
+        free(links[i]);
+    free(links);
+}
+
+int main(int argc, char *argv[]){
+    char *pagedir = argc > 1 ? argv[1] : ".";
+    int errors = 0, n, pages = 0, nexpected = sizeof(expected) / sizeof(expected[0]);
+    char **links;
+
+    errors += extract(strdup(awkward), &links, &n);
+    for (int i = 0; i < n || i < nexpected; i++){
+        if (i >= n || i >= nexpected || strcmp(links[i], expected[i]) != 0){
+            printf("link %d: got %s, expected %s\n", i,
+                   i < n ? links[i] : "nothing", i < nexpected ? expected[i] : "nothing");
+            errors++;
+        }
+    }
+    free_links(links, n);
+
+    /* many anchors without an href, then one with */
+    char *many = malloc(MANY * 12 + 32);
+    for (int i = 0; i < MANY; i++)
+        memcpy(many + i * 12, "<a name=x>y ", 12);
+    strcpy(many + MANY * 12, "<a href=last.html>");
+    errors += extract(many, &links, &n);
+    if (n != 1 || strcmp(links[0], "http://example.com/dir/last.html") != 0)
+        errors++;
+    free_links(links, n);
+
+    webpage_t *page;
+    for (int id = 1; (page = pageload(id, pagedir)) != NULL; id++, pages++){
+        errors += extract(strdup(webpage_getHTML(page)), &links, &n);
+        free_links(links, n);
+        webpage_delete(page);
+    }
+
+    if (errors > 0){
+        printf("%d link checks failed\n", errors);
+        exit(EXIT_FAILURE);
+    }
+    printf("Links matched successfully: %d pages\n", pages + 2);
+    exit(EXIT_SUCCESS);
+}
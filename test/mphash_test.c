@@ -0,0 +1,84 @@
+/*
+ * mphash_test.c -- tests the mphash module
+ *
+ * Author: Ian Kamweru, Abdibaset, Nathaniel Mensah
+ * Version: 1.0
+ *
+ * Description: builds functions over sets of random words of several
+ * sizes and checks that every word is found at its own position and
+ * that words outside the set are never taken for the wrong one
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mphash.h"
+
+#define MAXLEN 12
+
+/* fills word with 3 to MAXLEN random lowercase letters */
+static void random_word(char *word){
+    int len = 3 + rand() % (MAXLEN - 2);
+    for (int i = 0; i < len; i++)
+        word[i] = 'a' + rand() % 26;
+    word[len] = '\0';
+}
+
+static int word_cmp(const void *a, const void *b){
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+/* checks a function over n distinct random words */
+static int check(int n){
+    char **keys = malloc(n * sizeof(char*)), other[MAXLEN + 1];
+    int errors = 0, count = 0;
+    for (int i = 0; i < n; i++){
+        keys[i] = malloc(MAXLEN + 1);
+        random_word(keys[i]);
+    }
+    qsort(keys, n, sizeof(char*), word_cmp);
+    for (int i = 0; i < n; i++){
+        if (count == 0 || strcmp(keys[i], keys[count-1]) != 0)
+            keys[count++] = keys[i];
+        else
+            free(keys[i]);
+    }
+    n = count;
+
+    mphash_t *mp = mphbuild(keys, n);
+    if (!mp){
+        printf("Build failed for %d keys\n", n);
+        return 1;
+    }
+    for (int i = 0; i < n; i++){
+        if (mphlookup(mp, keys[i]) != i)
+            errors++;
+    }
+    for (int i = 0; i < n; i++){
+        random_word(other);
+        int pos = mphlookup(mp, other);
+        if (pos < -1 || pos >= n)
+            errors++;
+        else if (pos >= 0 && strcmp(keys[pos], other) != 0 && bsearch(&(char*){other}, keys, n, sizeof(char*), word_cmp))
+            errors++;
+    }
+    printf("%d keys in %zu bytes, %zu of them positions: %d errors\n", n,
+           mphbytes(mp), n * sizeof(int), errors);
+
+    mphclose(mp);
+    for (int i = 0; i < n; i++)
+        free(keys[i]);
+    free(keys);
+    return errors;
+}
+
+int main(void){
+    int errors = 0;
+    int sizes[] = { 0, 1, 2, 100, 10000, 200000 };
+    for (int i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++)
+        errors += check(sizes[i]);
+    if (errors > 0)
+        exit(EXIT_FAILURE);
+    printf("Perfect hash lookups matched successfully\n");
+    exit(EXIT_SUCCESS);
+}
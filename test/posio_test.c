@@ -0,0 +1,114 @@
+/*
+ * posio_test.c -- tests the posio module
+ *
+ * Author: Ian Kamweru, Abdibaset, Nathaniel Mensah
+ * Version: 1.0
+ *
+ * Description: saves an index of random words with their positions,
+ * loads it back as a query index and checks every decoded position
+ * list; then checks that a position file of another index is ignored
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "indexio.h"
+#include "posio.h"
+#include "qindex.h"
+
+#define NWORDS 50
+#define NDOCS 40
+#define DOCLEN 2000
+
+static int text[NDOCS][DOCLEN];    // the word at each position of each doc
+
+static bool entry_searchfn(void *elementp, const void *keyp){
+    return strcmp(((entry_t*)elementp)->word, (const char*)keyp) == 0;
+}
+
+static bool doc_searchfn(void *elementp, const void *keyp){
+    return ((document_t*)elementp)->id == *(const int*)keyp;
+}
+
+/* builds an index of the random documents, with positions */
+static hashtable_t *build(void){
+    hashtable_t *index = hopen(100);
+    char word[16];
+    for (int id = 1; id <= NDOCS; id++){
+        for (int pos = 0; pos < DOCLEN; pos++){
+            /* skewed, so that some words are frequent and others rare */
+            int w = rand() % NWORDS;
+            w = w * w / NWORDS;
+            text[id-1][pos] = w;
+            snprintf(word, sizeof(word), "word%c%c", 'a' + w / 26, 'a' + w % 26);
+            entry_t *ep = hsearch(index, entry_searchfn, word, strlen(word));
+            if (!ep){
+                ep = new_entry(word);
+                hput(index, ep, word, strlen(word));
+            }
+            document_t *dp = qsearch(ep->documents, doc_searchfn, &id);
+            if (!dp){
+                dp = new_doc(id, 0);
+                dp->positions = malloc(DOCLEN * sizeof(int));
+                qput(ep->documents, dp);
+            }
+            dp->positions[dp->word_count++] = pos;
+        }
+    }
+    return index;
+}
+
+int main(void){
+    char *indexnm = "test_posindex", posnm[64];
+    int positions[DOCLEN], errors = 0, checked = 0;
+    char word[16];
+
+    pos_path(indexnm, posnm, sizeof(posnm));
+    hashtable_t *index = build();
+    if (indexsave(index, indexnm) != 0 || possave(index, posnm) != 0)
+        exit(EXIT_FAILURE);
+    free_entries(index);
+    hclose(index);
+
+    qindex_t *qi = qindexload(indexnm);
+    if (!qi || !qindexhaspositions(qi)){
+        printf("Positions were not loaded\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int w = 0; w < NWORDS; w++){
+        snprintf(word, sizeof(word), "word%c%c", 'a' + w / 26, 'a' + w % 26);
+        postings_t *pp = qindexfind(qi, word);
+        for (int i = 0; pp && i < pp->df; i++){
+            int n = qindexpositions(pp, i, positions), k = 0;
+            for (int pos = 0; pos < DOCLEN; pos++){
+                if (text[pp->ids[i]-1][pos] == w && (k >= n || positions[k++] != pos))
+                    errors++;
+            }
+            if (k != n)
+                errors++;
+            checked++;
+        }
+    }
+    qindexclose(qi);
+    if (errors > 0){
+        printf("%d position lists of %d differ\n", errors, checked);
+        exit(EXIT_FAILURE);
+    }
+    printf("Positions matched successfully: %d lists\n", checked);
+
+    /* positions saved for other documents are not used */
+    index = build();
+    indexsave(index, indexnm);
+    free_entries(index);
+    hclose(index);
+    qi = qindexload(indexnm);
+    if (!qi || qindexhaspositions(qi)){
+        printf("Stale positions were loaded\n");
+        exit(EXIT_FAILURE);
+    }
+    qindexclose(qi);
+
+    remove(indexnm);
+    remove(posnm);
+    exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,107 @@
+/*
+ * queue_test.c -- tests the queue module
+ *
+ * Author: Ian Kamweru, Abdibaset, Nathaniel Mensah
+ * Version: 1.0
+ *
+ * Description: runs random puts, gets and removes on queues whose
+ * nodes are reused from their slabs, concatenating them now and then,
+ * and checks the order of what comes out against a plain array
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "queue.h"
+
+#define STEPS 100000
+#define NQUEUES 4
+
+/* what a queue should hold, front first */
+typedef struct expected {
+    int *items;
+    int count;
+} expected_t;
+
+static bool int_searchfn(void *elementp, const void *keyp){
+    return *(int*)elementp == *(const int*)keyp;
+}
+
+static int *new_int(int value){
+    int *ip = malloc(sizeof(int));
+    *ip = value;
+    return ip;
+}
+
+int main(void){
+    queue_t *queues[NQUEUES];
+    expected_t expected[NQUEUES];
+    int errors = 0;
+
+    for (int i = 0; i < NQUEUES; i++){
+        queues[i] = qopen();
+        expected[i] = (expected_t){ malloc(STEPS * sizeof(int)), 0 };
+    }
+    for (int step = 0; step < STEPS; step++){
+        int i = rand() % NQUEUES, op = rand() % 100;
+        queue_t *qp = queues[i];
+        expected_t *ep = &expected[i];
+
+        if (op < 55){
+            qput(qp, new_int(step));
+            ep->items[ep->count++] = step;
+        }
+        else if (op < 85){
+            int *ip = qget(qp);
+            if ((ip == NULL) != (ep->count == 0) || (ip && *ip != ep->items[0]))
+                errors++;
+            if (ip){
+                ep->count--;
+                for (int j = 0; j < ep->count; j++)
+                    ep->items[j] = ep->items[j+1];
+                free(ip);
+            }
+        }
+        else if (op < 98){
+            if (ep->count == 0)
+                continue;
+            int at = rand() % ep->count, key = ep->items[at];
+            int *ip = qremove(qp, int_searchfn, &key);
+            if (ip == NULL || *ip != key)
+                errors++;
+            free(ip);
+            ep->count--;
+            for (int j = at; j < ep->count; j++)
+                ep->items[j] = ep->items[j+1];
+        }
+        else {
+            /* the queue takes over another one, nodes, slabs and all */
+            int other = (i + 1 + rand() % (NQUEUES - 1)) % NQUEUES;
+            qconcat(qp, queues[other]);
+            queues[other] = qopen();
+            for (int j = 0; j < expected[other].count; j++)
+                ep->items[ep->count++] = expected[other].items[j];
+            expected[other].count = 0;
+        }
+    }
+
+    for (int i = 0; i < NQUEUES; i++){
+        int *ip, at = 0;
+        while ((ip = qget(queues[i]))){
+            if (at >= expected[i].count || *ip != expected[i].items[at++])
+                errors++;
+            free(ip);
+        }
+        if (at != expected[i].count)
+            errors++;
+        qput(queues[i], new_int(i));    // freed by qclose
+        qclose(queues[i]);
+        free(expected[i].items);
+    }
+
+    if (errors > 0){
+        printf("%d queue checks failed\n", errors);
+        exit(EXIT_FAILURE);
+    }
+    printf("Queue operations matched successfully\n");
+    exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,85 @@
+/* 
+ * roaring_test.c -- tests the roaring module
+ *
+ * Author: Ian Kamweru, Abdibaset, Nathaniel Mensah
+ * Version: 1.0
+ * 
+ * Description: builds sparse, dense and clustered sets spanning
+ * several chunks, before and after converting them to runs, and checks
+ * their intersections, unions and differences against plain arrays,
+ * and the intersection of several sets at once
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "roaring.h"
+
+#define MAXID 200000
+
+static bool in_a[MAXID], in_b[MAXID];
+
+/* fills set with ids drawn with probability 1/every, plus a run */
+static int fill(bool *set, int *ids, int every, int run_start, int run_len){
+    int n = 0;
+    for (int id = 0; id < MAXID; id++){
+        set[id] = rand() % every == 0 || (id >= run_start && id < run_start + run_len);
+        if (set[id])
+            ids[n++] = id;
+    }
+    return n;
+}
+
+/* checks that r holds exactly the ids where a op b */
+static int check(roaring_t *r, char op){
+    static int ids[MAXID];
+    int n = roaringtoarray(r, ids), k = 0, errors = 0;
+    if (n != roaringcount(r))
+        errors++;
+    for (int id = 0; id < MAXID; id++){
+        bool want = op == '&' ? in_a[id] && in_b[id] : op == '|' ? in_a[id] || in_b[id] : in_a[id] && !in_b[id];
+        if (want && (k >= n || ids[k++] != id))
+            errors++;
+        if (want != roaringcontains(r, id))
+            errors++;
+    }
+    if (k != n)
+        errors++;
+    roaringclose(r);
+    return errors;
+}
+
+int main(void){
+    static int a_ids[MAXID], b_ids[MAXID];
+    int densities[][2] = { { 2, 3 }, { 2, 100 }, { 100, 300 }, { 1000000, 3 } };
+    int errors = 0;
+
+    srand(38);
+    for (int t = 0; t < 4; t++){
+        int na = fill(in_a, a_ids, densities[t][0], 70000, 30000);
+        int nb = fill(in_b, b_ids, densities[t][1], 90000, 5000);
+        roaring_t *a = roaringfrom(a_ids, na), *b = roaringfrom(b_ids, nb);
+        for (int optimized = 0; optimized <= 1; optimized++){
+            if (optimized){
+                size_t before = roaringbytes(a);
+                roaringoptimize(a);
+                roaringoptimize(b);
+                if (roaringbytes(a) > before)
+                    errors++;
+            }
+            errors += check(roaringand(a, b), '&');
+            errors += check(roaringor(a, b), '|');
+            errors += check(roaringandnot(a, b), '-');
+            roaring_t *sets[] = { a, b, a };
+            errors += check(roaringandall(sets, 3), '&');
+        }
+        roaringclose(a);
+        roaringclose(b);
+    }
+    if (errors != 0){
+        printf("%d roaring mismatches\n", errors);
+        exit(EXIT_FAILURE);
+    }
+    printf("Roaring set operations matched successfully\n");
+    exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,93 @@
+/*
+ * termdict_test.c -- tests the termdict module
+ *
+ * Author: Ian Kamweru, Abdibaset, Nathaniel Mensah
+ * Version: 1.0
+ *
+ * Description: builds a dictionary of the words of test_index and
+ * checks lookups of every word and of words it lacks, prefix ranges
+ * against a scan of the sorted words, and decoding every word back
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "indexio.h"
+#include "termdict.h"
+
+static char **words;
+static int nwords;
+
+static void collect_fn(void *ep){
+    words[nwords++] = ((entry_t*)ep)->word;
+}
+
+static void count_fn(void *ep){
+    nwords++;
+}
+
+static int word_cmp(const void *a, const void *b){
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+int main(void){
+    hashtable_t *index = indexload("test_index");
+    if (!index)
+        exit(EXIT_FAILURE);
+    happly(index, count_fn);
+    words = malloc(nwords * sizeof(char*));
+    nwords = 0;
+    happly(index, collect_fn);
+    qsort(words, nwords, sizeof(char*), word_cmp);
+
+    termdict_t *td = termdictbuild(words, nwords);
+    int errors = 0, first, count;
+    size_t raw = 0;
+    char buf[256], missing[256];
+
+    for (int i = 0; i < nwords; i++){
+        raw += strlen(words[i]) + 1 + sizeof(char*);
+        if (termdictfind(td, words[i]) != i)
+            errors++;
+        if (termdictword(td, i, buf, sizeof(buf)) != (int)strlen(words[i]) || strcmp(buf, words[i]) != 0)
+            errors++;
+
+        /* a word with a letter too many, and one cut short, between neighbours */
+        snprintf(missing, sizeof(missing), "%s{", words[i]);
+        if (termdictfind(td, missing) != -1)
+            errors++;
+        strcpy(missing, words[i]);
+        missing[strlen(missing) - 1] = '\0';
+        int found = termdictfind(td, missing);
+        if (found != -1 && (found >= i || strcmp(words[found], missing) != 0))
+            errors++;
+
+        /* every prefix of the word */
+        for (size_t len = 1; len <= strlen(words[i]); len++){
+            strncpy(missing, words[i], len);
+            missing[len] = '\0';
+            count = termdictprefix(td, missing, &first);
+            int lo = i, hi = i;
+            while (lo > 0 && strncmp(words[lo-1], missing, len) == 0)
+                lo--;
+            while (hi < nwords && strncmp(words[hi], missing, len) == 0)
+                hi++;
+            if (first != lo || count != hi - lo)
+                errors++;
+        }
+    }
+    if (termdictprefix(td, "{", &first) != 0 || termdictfind(td, "") != -1)
+        errors++;
+
+    if (errors > 0){
+        printf("%d dictionary lookups failed\n", errors);
+        exit(EXIT_FAILURE);
+    }
+    printf("Dictionary matched successfully: %d words in %zu bytes (%zu as strings)\n",
+           nwords, termdictbytes(td), raw);
+
+    termdictclose(td);
+    free(words);
+    free_entries(index);
+    hclose(index);
+    exit(EXIT_SUCCESS);
+}
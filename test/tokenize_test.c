@@ -0,0 +1,128 @@
+/*
+ * tokenize_test.c -- tests webpage_getWords and webpage_getNextWord
+ *
+ * Author: Ian Kamweru, Abdibaset, Nathaniel Mensah
+ * Version: 1.0
+ *
+ * Description: tokenizes random tag soup of every length up to a few
+ * blocks, and the pages given, in batches of several sizes, and checks
+ * the slices, the lowercased words and webpage_getNextWord against
+ * the byte at a time loop webpage_getNextWord used to be
+ *
+ * usage: tokenize_test [<pagedir>]
+ */
+
+#define _POSIX_C_SOURCE 200809L    // strdup
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "webpage.h"
+#include "pageio.h"
+
+#define TRIALS 3000
+#define MAX_LEN 200
+
+/* the words of html, as the old loop found them */
+static int reference(const char *html, wordslice_t *words){
+    int pos = 0, n = 0;
+    while (html[pos] != '\0'){
+        if (isalpha((unsigned char)html[pos])){
+            int start = pos;
+            while (isalpha((unsigned char)html[pos]))
+                pos++;
+            words[n].offset = start;
+            words[n++].len = pos - start;
+        }
+        else if (html[pos] == '<'){
+            const char *end = strchr(&html[pos], '>');
+            if (end == NULL)
+                break;
+            pos = end - html + 1;
+        }
+        else
+            pos++;
+    }
+    return n;
+}
+
+static int check(char *html, const char *what){
+    int len = strlen(html), errors = 0, n, got;
+    wordslice_t *expected = malloc((len + 1) * sizeof(wordslice_t));
+    wordslice_t *slices = malloc((len + 1) * sizeof(wordslice_t));
+    char *lower = malloc(len + 1);
+    webpage_t *page = webpage_new("http://example.com/", 0, html);
+    int nexpected = reference(html, expected);
+
+    for (int batch = 1; batch <= 33; batch += 8){
+        int pos = 0;
+        got = 0;
+        while ((n = webpage_getWords(page, &pos, slices + got, batch, lower)) > 0){
+            for (int i = got; i < got + n; i++){
+                const char *word = lower + slices[i].offset;
+                if ((int)strlen(word) != slices[i].len)
+                    errors++;
+                for (int k = 0; k < slices[i].len; k++)
+                    if (word[k] != tolower((unsigned char)html[slices[i].offset + k]))
+                        errors++;
+            }
+            got += n;
+            if (got > nexpected)
+                break;
+        }
+        if (got != nexpected || memcmp(slices, expected, got * sizeof(wordslice_t)) != 0)
+            errors++;
+    }
+
+    /* one word at a time, without lowering */
+    char *word;
+    int pos = 0;
+    got = 0;
+    while ((pos = webpage_getNextWord(page, pos, &word)) > 0){
+        if (got >= nexpected || strlen(word) != (size_t)expected[got].len ||
+            strncmp(word, html + expected[got].offset, expected[got].len) != 0)
+            errors++;
+        got++;
+        free(word);
+    }
+    if (got != nexpected)
+        errors++;
+
+    if (errors > 0)
+        printf("%s: %d errors\n", what, errors);
+    webpage_delete(page);
+    free(expected);
+    free(slices);
+    free(lower);
+    return errors;
+}
+
+int main(int argc, char *argv[]){
+    char *pagedir = argc > 1 ? argv[1] : ".";
+    const char alphabet[] = "aZq<>< > x!\n\t9\xe9-";
+    int errors = 0, pages = 0;
+
+    srand(49);
+    for (int t = 0; t < TRIALS; t++){
+        int len = rand() % MAX_LEN;
+        char *html = malloc(len + 1);
+        for (int i = 0; i < len; i++)
+            html[i] = alphabet[rand() % (sizeof(alphabet) - 1)];
+        html[len] = '\0';
+        errors += check(html, "random html");
+    }
+
+    webpage_t *page;
+    for (int id = 1; (page = pageload(id, pagedir)) != NULL; id++, pages++){
+        errors += check(strdup(webpage_getHTML(page)), "page");
+        webpage_delete(page);
+    }
+
+    if (errors > 0){
+        printf("%d tokenizer checks failed\n", errors);
+        exit(EXIT_FAILURE);
+    }
+    printf("Words matched successfully: %d random documents, %d pages\n", TRIALS, pages);
+    exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,171 @@
+/*
+ * typed_test.c -- tests the typed containers
+ *
+ * Author: Ian Kamweru, Abdibaset, Nathaniel Mensah
+ * Version: 1.0
+ *
+ * Description: runs random puts, gets, bulk appends and sorts on a
+ * queue, walking it in place as it wraps around and grows, and random
+ * inserts, finds and removes on a map of ints and a map of strings,
+ * checking each against a plain array holding what they should
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "typed.h"
+
+#define NKEYS 5000
+#define STEPS 200000
+#define MAX_APPEND 40
+
+TYPED_VECTOR(ints, int)
+TYPED_QUEUE(fifo, int)
+TYPED_MAP(counts, int, int, typed_inthash, typed_inteq)
+TYPED_MAP(names, const char*, int, typed_strhash, typed_streq)
+
+/* larger values first, like the querier's ranks */
+static int int_cmp(const void *a, const void *b){
+    int x = *(const int*)a, y = *(const int*)b;
+    return (x < y) - (x > y);
+}
+
+static int check_queue(void){
+    fifo_t q = { NULL, 0, 0, 0 };
+    ints_t expected = { NULL, 0, 0 };
+    int errors = 0, front = 0, item, batch[MAX_APPEND];
+
+    for (int i = 0; i < STEPS; i++){
+        int op = rand() % 100;
+        if (op < 25){
+            fifo_put(&q, i);
+            ints_push(&expected, i);
+        }
+        else if (op < 27){
+            int n = rand() % MAX_APPEND;
+            for (int k = 0; k < n; k++){
+                batch[k] = rand() % 1000;
+                ints_push(&expected, batch[k]);
+            }
+            fifo_append(&q, batch, n);
+        }
+        else if (op < 99){
+            if (fifo_get(&q, &item)){
+                if (front == expected.count || item != expected.items[front++])
+                    errors++;
+            }
+            else if (front != expected.count){
+                errors++;
+            }
+        }
+        else {
+            fifo_sort(&q, int_cmp);
+            qsort(expected.items + front, expected.count - front, sizeof(int), int_cmp);
+        }
+        if (fifo_size(&q) != expected.count - front)
+            errors++;
+
+        /* walk it in place */
+        for (int k = 0; k < fifo_size(&q); k++){
+            if (*fifo_at(&q, k) != expected.items[front + k])
+                errors++;
+        }
+        if (fifo_at(&q, fifo_size(&q)) != NULL || fifo_at(&q, -1) != NULL)
+            errors++;
+    }
+    while (fifo_get(&q, &item)){
+        if (item != expected.items[front++])
+            errors++;
+    }
+    if (front != expected.count)
+        errors++;
+    fifo_free(&q);
+    ints_free(&expected);
+    return errors;
+}
+
+/* small keys, so that inserts and removes hit the same keys often */
+static int check_counts(void){
+    counts_t m = { NULL, 0, 0 };
+    int present[NKEYS] = { 0 }, values[NKEYS], npresent = 0, errors = 0;
+
+    for (int i = 0; i < STEPS; i++){
+        int key = rand() % NKEYS, op = rand() % 3, value;
+        bool found;
+        if (op == 0){
+            int *vp = counts_insert(&m, key, &found);
+            if (found != present[key] || (found && *vp != values[key]))
+                errors++;
+            *vp = values[key] = i;
+            npresent += !present[key];
+            present[key] = 1;
+        }
+        else if (op == 1){
+            found = counts_remove(&m, key, NULL, &value);
+            if (found != present[key] || (found && value != values[key]))
+                errors++;
+            npresent -= present[key];
+            present[key] = 0;
+        }
+        else {
+            int *vp = counts_find(&m, key);
+            if ((vp != NULL) != present[key] || (vp && *vp != values[key]))
+                errors++;
+        }
+        if (m.count != npresent)
+            errors++;
+    }
+
+    /* walking the map meets every key present once */
+    int seen = 0, i = 0;
+    for (counts_slot_t *s; (s = counts_next(&m, &i)); seen++){
+        if (!present[s->key] || s->value != values[s->key])
+            errors++;
+    }
+    if (seen != npresent)
+        errors++;
+    counts_clear(&m);
+    if (m.count != 0 || counts_find(&m, 0) != NULL)
+        errors++;
+    counts_free(&m);
+    return errors;
+}
+
+/* string keys, looked up through copies of the keys inserted */
+static int check_names(void){
+    names_t m = { NULL, 0, 0 };
+    static char keys[NKEYS][16];
+    char copy[16];
+    int errors = 0;
+
+    for (int i = 0; i < NKEYS; i++){
+        snprintf(keys[i], sizeof(keys[i]), "word%d", i * 7919);
+        *names_insert(&m, keys[i], NULL) = i;
+    }
+    for (int i = 0; i < NKEYS; i++){
+        strcpy(copy, keys[i]);
+        int *vp = names_find(&m, copy);
+        if (vp == NULL || *vp != i)
+            errors++;
+        if (i % 2 == 0 && !names_remove(&m, copy, NULL, NULL))
+            errors++;
+    }
+    for (int i = 0; i < NKEYS; i++){
+        if ((names_find(&m, keys[i]) != NULL) != (i % 2 == 1))
+            errors++;
+    }
+    if (names_find(&m, "missing") != NULL || m.count != NKEYS / 2)
+        errors++;
+    names_free(&m);
+    return errors;
+}
+
+int main(void){
+    int errors = check_queue() + check_counts() + check_names();
+    if (errors > 0){
+        printf("%d typed container checks failed\n", errors);
+        exit(EXIT_FAILURE);
+    }
+    printf("Typed containers matched successfully\n");
+    exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,159 @@
+/*
+ * arena.c -- a region allocator
+ *
+ * Author: Ian Kamweru, Abdibaset Bare, Nathaniel Mensah
+ * Version: 1.0
+ *
+ * Description: blocks are ARENA_BLOCK bytes, so closing an arena is
+ * one free per block rather than one per allocation, and blocks that
+ * size are usually mapped by malloc straight from the system and
+ * unmapped when freed. An allocation too large to leave a block
+ * mostly used gets a block of its own, linked in behind the one being
+ * bumped so that the rest of that block is not lost.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "arena.h"
+
+#define ARENA_BLOCK (256 << 10)
+#define ALIGN _Alignof(max_align_t)
+
+typedef struct block {
+	struct block *next;
+	size_t size;         // bytes of data
+	size_t used;
+	_Alignas(max_align_t) char data[];
+} block_t;
+
+typedef struct arena {
+	block_t *blocks;     // the block being bumped first
+	size_t bytes;
+	void *last;          // the latest allocation from the first block
+} arenarep_t;
+
+static inline size_t round_up(size_t size){
+	return (size + ALIGN - 1) & ~(size_t)(ALIGN - 1);
+}
+
+static block_t *new_block(size_t size){
+	block_t *bp = malloc(sizeof(block_t) + size);
+	if (bp == NULL)
+		return NULL;
+	bp->next = NULL;
+	bp->size = size;
+	bp->used = 0;
+	return bp;
+}
+
+arena_t *arenaopen(void){
+	arenarep_t *ap = malloc(sizeof(arenarep_t));
+	if (ap == NULL)
+		return NULL;
+	ap->blocks = NULL;
+	ap->bytes = sizeof(arenarep_t);
+	ap->last = NULL;
+	return (arena_t*)ap;
+}
+
+void arenaclose(arena_t *app){
+	if (app == NULL)
+		return;
+	arenarep_t *ap = (arenarep_t*)app;
+	block_t *bp = ap->blocks, *next;
+	while (bp != NULL){
+		next = bp->next;
+		free(bp);
+		bp = next;
+	}
+	free(ap);
+}
+
+void *arenaalloc(arena_t *app, size_t size){
+	arenarep_t *ap = (arenarep_t*)app;
+	if (ap == NULL)
+		return NULL;
+	size = round_up(size ? size : 1);
+	block_t *bp = ap->blocks;
+
+	/* a large allocation: a block of its own, behind the first */
+	if (size > ARENA_BLOCK / 4){
+		block_t *big = new_block(size);
+		if (big == NULL)
+			return NULL;
+		big->used = size;
+		if (bp == NULL){
+			ap->blocks = big;
+			ap->last = NULL;
+		}
+		else {
+			big->next = bp->next;
+			bp->next = big;
+		}
+		ap->bytes += sizeof(block_t) + size;
+		return big->data;
+	}
+
+	if (bp == NULL || bp->size - bp->used < size){
+		if ((bp = new_block(ARENA_BLOCK)) == NULL)
+			return NULL;
+		bp->next = ap->blocks;
+		ap->blocks = bp;
+		ap->bytes += sizeof(block_t) + ARENA_BLOCK;
+	}
+	void *p = bp->data + bp->used;
+	bp->used += size;
+	ap->last = p;
+	return p;
+}
+
+void *arenagrow(arena_t *app, void *p, size_t oldsize, size_t newsize){
+	arenarep_t *ap = (arenarep_t*)app;
+	if (ap == NULL)
+		return NULL;
+	if (p == NULL)
+		return arenaalloc(app, newsize);
+
+	/* the latest allocation of the first block can extend in place */
+	block_t *bp = ap->blocks;
+	if (p == ap->last){
+		size_t start = (char*)p - bp->data;
+		if (start + round_up(newsize) <= bp->size){
+			bp->used = start + round_up(newsize);
+			return p;
+		}
+	}
+	void *q = arenaalloc(app, newsize);
+	if (q != NULL)
+		memcpy(q, p, oldsize < newsize ? oldsize : newsize);
+	return q;
+}
+
+void arenaadopt(arena_t *app, arena_t *otherp){
+	arenarep_t *ap = (arenarep_t*)app, *other = (arenarep_t*)otherp;
+	if (ap == NULL || other == NULL)
+		return;
+	if (other->blocks != NULL){
+		/* behind the first block of ap, which keeps being bumped */
+		block_t *last = other->blocks;
+		while (last->next != NULL)
+			last = last->next;
+		if (ap->blocks == NULL){
+			ap->blocks = other->blocks;
+			ap->last = NULL;
+		}
+		else {
+			last->next = ap->blocks->next;
+			ap->blocks->next = other->blocks;
+		}
+		ap->bytes += other->bytes - sizeof(arenarep_t);
+		other->blocks = NULL;
+	}
+	arenaclose(otherp);
+}
+
+size_t arenabytes(arena_t *app){
+	arenarep_t *ap = (arenarep_t*)app;
+	return ap ? ap->bytes : 0;
+}
@@ -0,0 +1,45 @@
+#pragma once
+/*
+ * arena.h -- public interface to a region allocator
+ *
+ * Author: Ian Kamweru, Abdibaset Bare, Nathaniel Mensah
+ * Version: 1.0
+ *
+ * Description: an arena hands out memory by bumping a pointer through
+ * large blocks and frees nothing until it is closed, when all of its
+ * blocks are released at once. It suits structures that are built up
+ * and then thrown away whole, like an index being constructed. An
+ * arena is not safe to use from several threads at once.
+ */
+#include <stddef.h>
+
+/* the arena representation is hidden from users of the module */
+typedef void arena_t;
+
+/* arenaopen -- opens an empty arena
+ * returns: non-NULL for success; NULL otherwise
+ */
+arena_t *arenaopen(void);
+
+/* arenaclose -- frees every allocation of the arena, and the arena */
+void arenaclose(arena_t *ap);
+
+/* arenaalloc -- size bytes, aligned for any type, living as long as
+ * the arena
+ * returns: NULL if out of memory
+ */
+void *arenaalloc(arena_t *ap, size_t size);
+
+/* arenagrow -- resizes p, an allocation of oldsize bytes from the
+ * arena (or NULL), to newsize bytes. The last allocation of the arena
+ * grows in place when it can; any other is copied to a new one.
+ * returns: the allocation, or NULL if out of memory (p is unchanged)
+ */
+void *arenagrow(arena_t *ap, void *p, size_t oldsize, size_t newsize);
+
+/* arenaadopt -- moves every allocation of other into ap, which frees
+ * them when it is closed; other is closed */
+void arenaadopt(arena_t *ap, arena_t *other);
+
+/* arenabytes -- the heap bytes held by the arena */
+size_t arenabytes(arena_t *ap);
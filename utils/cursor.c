@@ -0,0 +1,472 @@
+/* 
+ * cursor.c -- lazy cursors over posting lists
+ *
+ * Author: Ian Kamweru, Abdibaset Bare, Nathaniel Mensah
+ * Version: 1.0
+ * 
+ * Description: word cursors skip by galloping, so advancing over a
+ * long list costs the log of the distance skipped. An AND cursor
+ * leapfrogs: it advances each child to the largest document seen so
+ * far until all of them agree. An OR cursor sits on the smallest
+ * document of its children.
+ *
+ * A WAND cursor keeps its children sorted by current document. Its
+ * pivot is the first child at which the summed maximum ranks exceed
+ * the threshold: no document before the pivot's can qualify, so the
+ * children behind it skip straight there. Before the pivot document is
+ * scored, the block bounds of the children on it are summed; if even
+ * those cannot exceed the threshold, the range they cover is skipped.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "cursor.h"
+#include "intersect.h"
+
+typedef enum { CURSOR_TERM, CURSOR_AND, CURSOR_OR, CURSOR_WAND, CURSOR_RECORD } kind_t;
+
+typedef struct cur {
+	kind_t kind;
+	int doc;                  // current document
+	int score;                // its rank
+	int max;                  // bound on every rank
+	long cost;                // postings examined (word cursors)
+	/* CURSOR_TERM */
+	const int *ids;
+	const int *counts;
+	int df;
+	int pos;
+	const int *block_max;
+	int *own_block_max;       // block_max, if computed by the cursor
+	/* CURSOR_AND, CURSOR_OR, CURSOR_WAND, CURSOR_RECORD (one child) */
+	struct cur **children;
+	int n;
+	/* CURSOR_WAND */
+	int threshold;
+	/* CURSOR_RECORD */
+	int *rec_ids;
+	int *rec_counts;
+	int rec_count;
+	int rec_size;
+	bool complete;
+} cur_t;
+
+static void step(cur_t *c, bool next, int target);
+
+/* moves a word cursor to position pos */
+static void term_seek(cur_t *c, int pos){
+	c->pos = pos;
+	if (pos < c->df){
+		c->doc = c->ids[pos];
+		c->score = c->counts[pos];
+	}
+	else {
+		c->doc = CURSOR_END;
+		c->score = 0;
+	}
+}
+
+/* lines up the children of an AND cursor on their next common document */
+static void and_align(cur_t *c){
+	int target = c->children[0]->doc;
+	bool agreed = false;
+
+	while (!agreed && target != CURSOR_END){
+		agreed = true;
+		for (int i = 0; i < c->n; i++){
+			cur_t *child = c->children[i];
+			if (child->doc < target)
+				step(child, false, target);
+			if (child->doc > target){
+				target = child->doc;
+				agreed = false;
+				break;
+			}
+		}
+	}
+	c->doc = target;
+	c->score = 0;
+	if (target == CURSOR_END)
+		return;
+	c->score = c->children[0]->score;
+	for (int i = 1; i < c->n; i++){
+		if (c->children[i]->score < c->score)
+			c->score = c->children[i]->score;
+	}
+}
+
+/* sets an OR cursor on the smallest document of its children */
+static void or_align(cur_t *c){
+	c->doc = CURSOR_END;
+	c->score = 0;
+	for (int i = 0; i < c->n; i++){
+		if (c->children[i]->doc < c->doc)
+			c->doc = c->children[i]->doc;
+	}
+	if (c->doc == CURSOR_END)
+		return;
+	for (int i = 0; i < c->n; i++){
+		if (c->children[i]->doc == c->doc)
+			c->score += c->children[i]->score;
+	}
+}
+
+/* sorts the children of a WAND cursor by current document */
+static void wand_sort(cur_t *c){
+	for (int i = 1; i < c->n; i++){
+		cur_t *child = c->children[i];
+		int j = i;
+		for (; j > 0 && c->children[j-1]->doc > child->doc; j--)
+			c->children[j] = c->children[j-1];
+		c->children[j] = child;
+	}
+}
+
+static int bound(cur_t *c, int target, int *upto);
+
+/* marks the record cursors under c that were left before their end as
+ * incomplete: what they recorded is not their child's whole result */
+static void abandon(cur_t *c){
+	if (c->doc == CURSOR_END)
+		return;
+	if (c->kind == CURSOR_RECORD)
+		c->complete = false;
+	for (int i = 0; i < c->n; i++)
+		abandon(c->children[i]);
+}
+
+/* sets a WAND cursor on its next document that may rank above the threshold */
+static void wand_align(cur_t *c){
+	while (true){
+		wand_sort(c);
+
+		/* the pivot: the first child at which the maximum ranks add up */
+		int sum = 0, pivot = -1;
+		for (int i = 0; i < c->n && c->children[i]->doc != CURSOR_END; i++){
+			sum += c->children[i]->max;
+			if (sum > c->threshold){
+				pivot = i;
+				break;
+			}
+		}
+		if (pivot < 0){
+			/* nothing left can rank above the threshold: the children
+			 * still short of their end are left there */
+			for (int i = 0; i < c->n; i++)
+				abandon(c->children[i]);
+			c->doc = CURSOR_END;
+			c->score = 0;
+			return;
+		}
+		int doc = c->children[pivot]->doc;
+		while (pivot + 1 < c->n && c->children[pivot+1]->doc == doc)
+			pivot++;
+
+		/* skip the blocks around doc if they cannot rank above the threshold */
+		int block_sum = 0, upto = CURSOR_END, child_upto;
+		for (int i = 0; i <= pivot; i++){
+			block_sum += bound(c->children[i], doc, &child_upto);
+			if (child_upto < upto)
+				upto = child_upto;
+		}
+		if (block_sum <= c->threshold){
+			int target = upto == CURSOR_END ? CURSOR_END : upto + 1;
+			if (pivot + 1 < c->n && c->children[pivot+1]->doc < target)
+				target = c->children[pivot+1]->doc;
+			if (target <= doc)
+				target = doc + 1;
+			for (int i = 0; i <= pivot; i++)
+				step(c->children[i], false, target);
+			continue;
+		}
+
+		if (c->children[0]->doc == doc){
+			c->doc = doc;
+			c->score = 0;
+			for (int i = 0; i <= pivot; i++)
+				c->score += c->children[i]->score;
+			return;
+		}
+		for (int i = 0; i < pivot && c->children[i]->doc < doc; i++)
+			step(c->children[i], false, doc);
+	}
+}
+
+static void record(cur_t *c){
+	cur_t *child = c->children[0];
+	c->doc = child->doc;
+	c->score = child->score;
+	if (c->doc == CURSOR_END || !c->complete)
+		return;
+	if (c->rec_count == c->rec_size){
+		c->rec_size = c->rec_size ? 2*c->rec_size : 64;
+		c->rec_ids = realloc(c->rec_ids, c->rec_size * sizeof(int));
+		c->rec_counts = realloc(c->rec_counts, c->rec_size * sizeof(int));
+	}
+	c->rec_ids[c->rec_count] = c->doc;
+	c->rec_counts[c->rec_count++] = c->score;
+}
+
+/* moves a cursor to its first document after the current one (next)
+ * or at or after target (!next) */
+static void step(cur_t *c, bool next, int target){
+	if (c->doc == CURSOR_END || (!next && c->doc >= target))
+		return;
+
+	switch (c->kind){
+	case CURSOR_TERM:
+		c->cost++;
+		if (next || c->pos + 1 == c->df || c->ids[c->pos + 1] >= target)
+			term_seek(c, c->pos + 1);
+		else
+			term_seek(c, intersect_seek(c->ids, c->df, c->pos + 1, target, &c->cost));
+		break;
+	case CURSOR_AND:
+		step(c->children[0], next, target);
+		and_align(c);
+		break;
+	case CURSOR_OR:
+	case CURSOR_WAND: {
+		int doc = c->doc;
+		for (int i = 0; i < c->n; i++){
+			if (next ? c->children[i]->doc == doc : c->children[i]->doc < target)
+				step(c->children[i], next, target);
+		}
+		if (c->kind == CURSOR_OR)
+			or_align(c);
+		else
+			wand_align(c);
+		break;
+	}
+	case CURSOR_RECORD:
+		/* skipping past the next document may leave some unrecorded */
+		if (!next && target > c->doc + 1)
+			c->complete = false;
+		step(c->children[0], next, target);
+		record(c);
+		break;
+	}
+}
+
+/* bound on the ranks from target to *upto; see cursorbound */
+static int bound(cur_t *c, int target, int *upto){
+	int b, last = CURSOR_END, result = 0, child_upto;
+
+	*upto = CURSOR_END;
+	if (c->doc == CURSOR_END)
+		return 0;
+	switch (c->kind){
+	case CURSOR_TERM:
+		/* the first block from the current one that reaches target */
+		for (b = c->pos / CURSOR_BLOCK; b * CURSOR_BLOCK < c->df; b++){
+			int end = (b + 1) * CURSOR_BLOCK < c->df ? (b + 1) * CURSOR_BLOCK : c->df;
+			last = c->ids[end - 1];
+			if (last >= target)
+				break;
+		}
+		if (b * CURSOR_BLOCK >= c->df)
+			return 0;
+		*upto = last;
+		return c->block_max[b];
+	case CURSOR_AND:
+		result = c->max;
+		for (int i = 0; i < c->n; i++){
+			int r = bound(c->children[i], target, &child_upto);
+			if (r < result)
+				result = r;
+			if (child_upto < *upto)
+				*upto = child_upto;
+		}
+		return result;
+	case CURSOR_OR:
+	case CURSOR_WAND:
+		for (int i = 0; i < c->n; i++){
+			result += bound(c->children[i], target, &child_upto);
+			if (child_upto < *upto)
+				*upto = child_upto;
+		}
+		return result;
+	case CURSOR_RECORD:
+		return bound(c->children[0], target, upto);
+	}
+	return c->max;
+}
+
+static cur_t *new_cursor(kind_t kind, cursor_t **children, int n){
+	cur_t *c = calloc(1, sizeof(cur_t));
+	if (c == NULL)
+		return NULL;
+	c->kind = kind;
+	if (n > 0){
+		c->children = malloc(n * sizeof(cur_t*));
+		if (c->children == NULL){
+			free(c);
+			return NULL;
+		}
+		memcpy(c->children, children, n * sizeof(cur_t*));
+		c->n = n;
+	}
+	return c;
+}
+
+cursor_t *cursorterm(const int *ids, const int *counts, int df, const int *block_max){
+	cur_t *c = new_cursor(CURSOR_TERM, NULL, 0);
+	if (c == NULL)
+		return NULL;
+	int nblocks = (df + CURSOR_BLOCK - 1) / CURSOR_BLOCK;
+	if (block_max == NULL){
+		c->own_block_max = calloc(nblocks + 1, sizeof(int));
+		if (c->own_block_max == NULL){
+			free(c);
+			return NULL;
+		}
+		for (int i = 0; i < df; i++){
+			if (counts[i] > c->own_block_max[i / CURSOR_BLOCK])
+				c->own_block_max[i / CURSOR_BLOCK] = counts[i];
+		}
+		block_max = c->own_block_max;
+	}
+	c->ids = ids;
+	c->counts = counts;
+	c->df = df;
+	c->block_max = block_max;
+	for (int b = 0; b < nblocks; b++){
+		if (block_max[b] > c->max)
+			c->max = block_max[b];
+	}
+	term_seek(c, 0);
+	return (cursor_t*)c;
+}
+
+cursor_t *cursorand(cursor_t **children, int n){
+	if (children == NULL || n < 1)
+		return NULL;
+	cur_t *c = new_cursor(CURSOR_AND, children, n);
+	if (c == NULL)
+		return NULL;
+	c->max = c->children[0]->max;
+	for (int i = 1; i < n; i++){
+		if (c->children[i]->max < c->max)
+			c->max = c->children[i]->max;
+	}
+	and_align(c);
+	return (cursor_t*)c;
+}
+
+static cur_t *open_union(kind_t kind, cursor_t **children, int n){
+	if (n < 0 || (children == NULL && n > 0))
+		return NULL;
+	cur_t *c = new_cursor(kind, children, n);
+	if (c == NULL)
+		return NULL;
+	for (int i = 0; i < n; i++)
+		c->max += c->children[i]->max;
+	return c;
+}
+
+cursor_t *cursoror(cursor_t **children, int n){
+	cur_t *c = open_union(CURSOR_OR, children, n);
+	if (c != NULL)
+		or_align(c);
+	return (cursor_t*)c;
+}
+
+cursor_t *cursorwand(cursor_t **children, int n){
+	cur_t *c = open_union(CURSOR_WAND, children, n);
+	if (c != NULL){
+		c->threshold = -1;
+		wand_align(c);
+	}
+	return (cursor_t*)c;
+}
+
+void cursorthreshold(cursor_t *cp, int threshold){
+	cur_t *c = (cur_t*)cp;
+	if (c != NULL && c->kind == CURSOR_WAND)
+		c->threshold = threshold;
+}
+
+cursor_t *cursorrecord(cursor_t *child){
+	if (child == NULL)
+		return NULL;
+	cur_t *c = new_cursor(CURSOR_RECORD, &child, 1);
+	if (c == NULL)
+		return NULL;
+	c->complete = true;
+	c->max = c->children[0]->max;
+	record(c);
+	return (cursor_t*)c;
+}
+
+void cursorclose(cursor_t *cp){
+	cur_t *c = (cur_t*)cp;
+	if (c == NULL)
+		return;
+	for (int i = 0; i < c->n; i++)
+		cursorclose(c->children[i]);
+	free(c->children);
+	free(c->own_block_max);
+	free(c->rec_ids);
+	free(c->rec_counts);
+	free(c);
+}
+
+int cursordoc(cursor_t *cp){
+	return cp ? ((cur_t*)cp)->doc : CURSOR_END;
+}
+
+int cursorscore(cursor_t *cp){
+	return cp ? ((cur_t*)cp)->score : 0;
+}
+
+int cursornext(cursor_t *cp){
+	if (cp == NULL)
+		return CURSOR_END;
+	step((cur_t*)cp, true, 0);
+	return ((cur_t*)cp)->doc;
+}
+
+int cursoradvance(cursor_t *cp, int target){
+	if (cp == NULL)
+		return CURSOR_END;
+	step((cur_t*)cp, false, target);
+	return ((cur_t*)cp)->doc;
+}
+
+int cursormax(cursor_t *cp){
+	return cp ? ((cur_t*)cp)->max : 0;
+}
+
+int cursorbound(cursor_t *cp, int target, int *upto){
+	int end;
+	if (cp == NULL){
+		if (upto)
+			*upto = CURSOR_END;
+		return 0;
+	}
+	int result = bound((cur_t*)cp, target, &end);
+	if (upto)
+		*upto = end;
+	return result;
+}
+
+long cursorcost(cursor_t *cp){
+	cur_t *c = (cur_t*)cp;
+	if (c == NULL)
+		return 0;
+	long cost = c->cost;
+	for (int i = 0; i < c->n; i++)
+		cost += cursorcost(c->children[i]);
+	return cost;
+}
+
+int cursorrecorded(cursor_t *cp, int **ids, int **counts){
+	cur_t *c = (cur_t*)cp;
+	if (c == NULL || c->kind != CURSOR_RECORD || !c->complete)
+		return -1;
+	if (ids)
+		*ids = c->rec_ids;
+	if (counts)
+		*counts = c->rec_counts;
+	return c->rec_count;
+}
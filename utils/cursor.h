@@ -0,0 +1,108 @@
+#pragma once
+/* 
+ * cursor.h -- public interface to lazy cursors over posting lists
+ * 
+ * Author: Ian Kamweru, Abdibaset Bare, Nathaniel Mensah
+ * Version: 1.0
+ * 
+ * Description: a cursor walks the documents matched by a word or by
+ * an AND or OR of other cursors, one document at a time and in
+ * increasing id order. A cursor always sits on its current document
+ * (CURSOR_END once exhausted); cursornext moves to the next one and
+ * cursoradvance skips to the first one at or after a target id.
+ * Composite cursors line up their children as they move, so no
+ * intermediate result is ever built.
+ *
+ * The rank of a document under a word is the word's count in it,
+ * under an AND the smallest rank of its children and under an OR the
+ * sum of the ranks of the children on that document.
+ *
+ * Every cursor also knows an upper bound on the ranks it can produce,
+ * overall (cursormax) and over a range of documents (cursorbound).
+ * Word lists are split into blocks of CURSOR_BLOCK postings, each with
+ * the largest count in it. A WAND cursor uses these bounds to skip the
+ * documents of an OR that cannot rank above a threshold, such as the
+ * rank of the k-th best document found so far (Block-Max WAND).
+ */
+#include <limits.h>
+#include <stdbool.h>
+
+#define CURSOR_END INT_MAX
+#define CURSOR_BLOCK 64       // postings per block of a word's list
+
+/* the cursor representation is hidden from users of the module */
+typedef void cursor_t;
+
+/* cursorterm -- opens a cursor over df documents with increasing ids
+ * and the given counts; block_max holds the largest count of each
+ * block of CURSOR_BLOCK postings, or is NULL to have the cursor
+ * compute it; the arrays must outlive the cursor
+ */
+cursor_t *cursorterm(const int *ids, const int *counts, int df, const int *block_max);
+
+/* cursorand -- opens a cursor over the documents matched by every one
+ * of the n (>= 1) children, which it then owns; children are visited
+ * in order, so the rarest should come first
+ */
+cursor_t *cursorand(cursor_t **children, int n);
+
+/* cursoror -- opens a cursor over the documents matched by any of the
+ * n children, which it then owns
+ */
+cursor_t *cursoror(cursor_t **children, int n);
+
+/* cursorwand -- opens a cursor over the documents matched by any of
+ * the n children, which it then owns, skipping documents whose rank
+ * cannot exceed the threshold (see cursorthreshold); documents it
+ * stops on carry their full rank, which may still not exceed it
+ */
+cursor_t *cursorwand(cursor_t **children, int n);
+
+/* cursorthreshold -- from now on, lets a WAND cursor skip documents
+ * ranked at most threshold; no effect on other cursors
+ */
+void cursorthreshold(cursor_t *cp, int threshold);
+
+/* cursorrecord -- opens a cursor that passes on the documents of child,
+ * which it then owns, keeping a copy of each (see cursorrecorded)
+ */
+cursor_t *cursorrecord(cursor_t *child);
+
+/* cursorclose -- closes a cursor and its children */
+void cursorclose(cursor_t *cp);
+
+/* cursordoc -- the current document; CURSOR_END if exhausted */
+int cursordoc(cursor_t *cp);
+
+/* cursorscore -- the rank of the current document */
+int cursorscore(cursor_t *cp);
+
+/* cursornext -- moves to the next document and returns it */
+int cursornext(cursor_t *cp);
+
+/* cursoradvance -- moves to the first document at or after target
+ * (staying put if already there) and returns it
+ */
+int cursoradvance(cursor_t *cp, int target);
+
+/* cursormax -- an upper bound on the rank of any document of the cursor */
+int cursormax(cursor_t *cp);
+
+/* cursorbound -- an upper bound on the rank of the documents of the
+ * cursor from target to *upto (>= target) inclusive; *upto is
+ * CURSOR_END if the bound holds to the end
+ */
+int cursorbound(cursor_t *cp, int target, int *upto);
+
+/* cursorcost -- the number of postings examined so far by the cursor
+ * and its children
+ */
+long cursorcost(cursor_t *cp);
+
+/* cursorrecorded -- the documents a record cursor has passed on
+ * returns: their number, with the ids and ranks in *ids and *counts
+ * (owned by the cursor); -1 if documents were skipped by an advance
+ * or the cursor was left before its end by a WAND cursor that stopped
+ * early, so the record is not the child's complete result
+ */
+int cursorrecorded(cursor_t *cp, int **ids, int **counts);
@@ -0,0 +1,230 @@
+/* 
+ * gdcache.c -- cost-aware (GreedyDual-Size) cache
+ *
+ * Author: Ian Kamweru, Abdibaset Bare, Nathaniel Mensah
+ * Version: 1.0
+ * 
+ * Description: entries are found through a typed hash map (see
+ * typed.h) and kept in a binary min-heap ordered by priority; the
+ * root is the next victim. Each entry remembers its heap slot so a
+ * hit can re-sift it.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "gdcache.h"
+#include "typed.h"
+
+#define NODE_OVERHEAD 64    // bookkeeping bytes charged per entry
+
+typedef struct gdnode {
+	char *key;
+	void *value;
+	size_t len;
+	double cost;
+	double priority;
+	int slot;                // index in the heap
+} gdnode_t;
+
+/* key -> gdnode_t, keyed by the key of the node */
+TYPED_MAP(nodes, const char*, gdnode_t*, typed_strhash, typed_streq)
+
+typedef struct gd {
+	pthread_mutex_t mutex;
+	nodes_t table;
+	gdnode_t **heap;         // min-heap on priority
+	int count;
+	int size;
+	double inflation;        // L: priority of the last victim
+	size_t bytes;
+	size_t maxbytes;
+	uint64_t hits;
+	uint64_t misses;
+} gd_t;
+
+static size_t node_bytes(gdnode_t *np){
+	return strlen(np->key) + 1 + np->len + NODE_OVERHEAD;
+}
+
+static void heap_swap(gd_t *gd, int i, int j){
+	gdnode_t *tmp = gd->heap[i];
+	gd->heap[i] = gd->heap[j];
+	gd->heap[j] = tmp;
+	gd->heap[i]->slot = i;
+	gd->heap[j]->slot = j;
+}
+
+static void sift_up(gd_t *gd, int i){
+	while (i > 0 && gd->heap[(i-1)/2]->priority > gd->heap[i]->priority){
+		heap_swap(gd, i, (i-1)/2);
+		i = (i-1)/2;
+	}
+}
+
+static void sift_down(gd_t *gd, int i){
+	while (true){
+		int l = 2*i + 1, r = l + 1, min = i;
+		if (l < gd->count && gd->heap[l]->priority < gd->heap[min]->priority) min = l;
+		if (r < gd->count && gd->heap[r]->priority < gd->heap[min]->priority) min = r;
+		if (min == i)
+			return;
+		heap_swap(gd, i, min);
+		i = min;
+	}
+}
+
+static double priority(gd_t *gd, gdnode_t *np){
+	return gd->inflation + np->cost / (double)node_bytes(np);
+}
+
+/* removes an entry from the table and the heap and frees it */
+static void evict(gd_t *gd, gdnode_t *np){
+	int slot = np->slot;
+	heap_swap(gd, slot, --gd->count);
+	if (slot < gd->count){
+		sift_down(gd, slot);
+		sift_up(gd, slot);
+	}
+	nodes_remove(&gd->table, np->key, NULL, NULL);
+	gd->bytes -= node_bytes(np);
+	free(np->key);
+	free(np->value);
+	free(np);
+}
+
+/* frees every entry and empties the table */
+static void free_nodes(gd_t *gd){
+	for (int i = 0; i < gd->count; i++){
+		free(gd->heap[i]->key);
+		free(gd->heap[i]->value);
+		free(gd->heap[i]);
+	}
+	nodes_clear(&gd->table);
+	gd->count = 0;
+	gd->bytes = 0;
+	gd->inflation = 0;
+}
+
+gdcache_t *gdopen(size_t maxbytes){
+	gd_t *gd = malloc(sizeof(gd_t));
+	if (gd == NULL)
+		return NULL;
+	gd->table = (nodes_t){ NULL, 0, 0 };
+	pthread_mutex_init(&gd->mutex, NULL);
+	gd->heap = NULL;
+	gd->count = gd->size = 0;
+	gd->inflation = 0;
+	gd->bytes = 0;
+	gd->maxbytes = maxbytes;
+	gd->hits = gd->misses = 0;
+	return (gdcache_t*)gd;
+}
+
+void gdclose(gdcache_t *cp){
+	if (cp == NULL)
+		return;
+	gd_t *gd = (gd_t*)cp;
+	free_nodes(gd);
+	nodes_free(&gd->table);
+	free(gd->heap);
+	pthread_mutex_destroy(&gd->mutex);
+	free(gd);
+}
+
+void *gdget(gdcache_t *cp, const char *key, size_t *len){
+	if (cp == NULL || key == NULL)
+		return NULL;
+	gd_t *gd = (gd_t*)cp;
+	void *copy = NULL;
+
+	pthread_mutex_lock(&gd->mutex);
+	gdnode_t **npp = nodes_find(&gd->table, key);
+	gdnode_t *np = npp ? *npp : NULL;
+	if (np == NULL){
+		gd->misses++;
+	}
+	else if ((copy = malloc(np->len ? np->len : 1)) != NULL){
+		gd->hits++;
+		memcpy(copy, np->value, np->len);
+		if (len)
+			*len = np->len;
+		np->priority = priority(gd, np);
+		sift_down(gd, np->slot);
+	}
+	pthread_mutex_unlock(&gd->mutex);
+	return copy;
+}
+
+int32_t gdput(gdcache_t *cp, const char *key, const void *value, size_t len, double cost){
+	if (cp == NULL || key == NULL || (value == NULL && len > 0))
+		return -1;
+	gd_t *gd = (gd_t*)cp;
+	if (strlen(key) + 1 + len + NODE_OVERHEAD > gd->maxbytes)
+		return -1;
+
+	gdnode_t *np = malloc(sizeof(gdnode_t));
+	if (np == NULL)
+		return -1;
+	np->key = malloc(strlen(key) + 1);
+	np->value = malloc(len ? len : 1);
+	np->len = len;
+	np->cost = cost;
+	if (np->key == NULL || np->value == NULL){
+		free(np->key);
+		free(np->value);
+		free(np);
+		return -1;
+	}
+	strcpy(np->key, key);
+	memcpy(np->value, value, len);
+
+	pthread_mutex_lock(&gd->mutex);
+	gdnode_t **old = nodes_find(&gd->table, key);
+	if (old)
+		evict(gd, *old);
+	while (gd->count > 0 && gd->bytes + node_bytes(np) > gd->maxbytes){
+		gd->inflation = gd->heap[0]->priority;
+		evict(gd, gd->heap[0]);
+	}
+	gdnode_t **slot = nodes_insert(&gd->table, np->key, NULL);
+	if (slot == NULL){
+		pthread_mutex_unlock(&gd->mutex);
+		free(np->key);
+		free(np->value);
+		free(np);
+		return -1;
+	}
+	*slot = np;
+	if (gd->count == gd->size){
+		gd->size = gd->size ? 2*gd->size : 64;
+		gd->heap = realloc(gd->heap, gd->size * sizeof(gdnode_t*));
+	}
+	np->priority = priority(gd, np);
+	np->slot = gd->count;
+	gd->heap[gd->count++] = np;
+	sift_up(gd, np->slot);
+	gd->bytes += node_bytes(np);
+	pthread_mutex_unlock(&gd->mutex);
+	return 0;
+}
+
+void gdclear(gdcache_t *cp){
+	if (cp == NULL)
+		return;
+	gd_t *gd = (gd_t*)cp;
+	pthread_mutex_lock(&gd->mutex);
+	free_nodes(gd);
+	pthread_mutex_unlock(&gd->mutex);
+}
+
+void gdstats(gdcache_t *cp, uint64_t *hits, uint64_t *misses, size_t *bytes){
+	if (cp == NULL)
+		return;
+	gd_t *gd = (gd_t*)cp;
+	pthread_mutex_lock(&gd->mutex);
+	if (hits) *hits = gd->hits;
+	if (misses) *misses = gd->misses;
+	if (bytes) *bytes = gd->bytes;
+	pthread_mutex_unlock(&gd->mutex);
+}
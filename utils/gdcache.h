@@ -0,0 +1,48 @@
+#pragma once
+/* 
+ * gdcache.h -- public interface to a cost-aware (GreedyDual-Size) cache
+ * 
+ * Author: Ian Kamweru, Abdibaset Bare, Nathaniel Mensah
+ * Version: 1.0
+ * 
+ * Description: maps string keys to byte strings like lrucache.h, but
+ * every entry carries the cost of recomputing it. When the cache is
+ * over budget it evicts the entry with the lowest cost per byte, aged
+ * so that entries which stop being used eventually leave: an entry's
+ * priority is L + cost/size, refreshed on every hit, and L rises to
+ * the priority of each evicted entry. Every operation takes the
+ * cache's own lock, so a cache may be shared by many threads.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* the cache representation is hidden from users of the module */
+typedef void gdcache_t;
+
+/* gdopen -- opens an empty cache holding at most maxbytes */
+gdcache_t *gdopen(size_t maxbytes);
+
+/* gdclose -- closes a cache, freeing every entry */
+void gdclose(gdcache_t *cp);
+
+/* gdget -- looks up key and refreshes its priority
+ * returns a malloc'd copy of the value (its length in *len), which the
+ * caller must free, or NULL if the key is not cached
+ */
+void *gdget(gdcache_t *cp, const char *key, size_t *len);
+
+/* gdput -- caches a copy of the len bytes of value under key, whose
+ * recomputation costs cost (in any unit, used consistently)
+ * returns 0 for success; nonzero if the entry is larger than the cache
+ * or memory is exhausted
+ */
+int32_t gdput(gdcache_t *cp, const char *key, const void *value, size_t len, double cost);
+
+/* gdclear -- removes every entry, e.g. when the data cached is stale */
+void gdclear(gdcache_t *cp);
+
+/* gdstats -- reports the number of lookups that hit and missed and
+ * the bytes in use; any of the pointers may be NULL
+ */
+void gdstats(gdcache_t *cp, uint64_t *hits, uint64_t *misses, size_t *bytes);
@@ -1,35 +1,65 @@
-/* 
- * hash.c -- implements a generic hash table as an indexed set of queues.
+/*
+ * hash.c -- implements a generic hash table as an indexed set of chains.
  *
  * Author: Ian Kamweru, Abdibaset, Nathaniel Mensah
  * Version: 1.0
- * 
- * Description: implementation of Hashtable ADT
+ *
+ * Description: implementation of Hashtable ADT. Every entry sits on
+ * the chain of its bucket in a node that also keeps the full 64-bit
+ * hash of its key: searches call the search function only on entries
+ * whose hash matches, and when the table doubles, which it does once
+ * it holds more entries than buckets, the nodes move by their stored
+ * hashes without a key being hashed again. The nodes of a table from
+ * hopen_arena are cut from its arena (see arena.h) and those removed
+ * are reused; other tables malloc their nodes, so a small table costs
+ * no arena block.
  */
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
 #include "hash.h"
-#include "queue.h"
+#include "arena.h"
+
+#ifdef __linux__
+#include <sys/random.h>
+#endif
 
-#define get16bits(d) (*((const uint16_t *) (d)))
+typedef struct hnode {
+	struct hnode *next;
+	uint64_t hash;
+	void *element;
+} hnode_t;
 
 typedef struct table {
-    uint32_t tablesize;
-    queue_t **hash_table;
+	uint32_t tablesize;      // buckets, a power of two
+	uint32_t count;          // entries
+	hnode_t **hash_table;
+	hashfn_t fn;
+	uint64_t seed;
+	arena_t *arena;          // with hopen_arena, the nodes and entries;
+	                         // NULL otherwise
+	hnode_t *free;           // arena nodes given back by hremove
 } table_t;
 
-/* 
- * SuperFastHash() -- produces a number between 0 and the tablesize-1.
- * 
- * The following (rather complicated) code, has been taken from Paul
- * Hsieh's website under the terms of the BSD license. It's a hash
- * function used all over the place nowadays, including Google Sparse
- * Hash.
+/*
+ * hash_superfast -- Paul Hsieh's SuperFastHash, which this table used
+ * to hardwire, taken from his website under the terms of the BSD
+ * license. The seed is folded into the initial value, and the 16-bit
+ * reads go through memcpy as data need not be aligned.
  */
-static uint32_t SuperFastHash (const char *data,int len,uint32_t tablesize) {
-    uint32_t hash = len, tmp;
+static inline uint32_t get16bits(const char *d){
+	uint16_t v;
+	memcpy(&v, d, sizeof(v));
+	return v;
+}
+
+uint64_t hash_superfast(const char *data, int len, uint64_t seed){
+    uint32_t hash = len ^ (uint32_t)seed, tmp;
     int rem;
-    
+
     if (len <= 0 || data == NULL)
       return 0;
     rem = len & 3;
@@ -46,14 +76,14 @@ static uint32_t SuperFastHash (const char *data,int len,uint32_t tablesize) {
     switch (rem) {
     case 3: hash += get16bits (data);
       hash ^= hash << 16;
-      hash ^= data[sizeof (uint16_t)] << 18;
+      hash ^= (unsigned char)data[sizeof (uint16_t)] << 18;
       hash += hash >> 11;
       break;
     case 2: hash += get16bits (data);
       hash ^= hash << 11;
       hash += hash >> 17;
       break;
-    case 1: hash += *data;
+    case 1: hash += (unsigned char)*data;
       hash ^= hash << 10;
       hash += hash >> 1;
     }
@@ -64,52 +94,276 @@ static uint32_t SuperFastHash (const char *data,int len,uint32_t tablesize) {
     hash += hash >> 17;
     hash ^= hash << 25;
     hash += hash >> 6;
-    return hash % tablesize;
+    return hash;
 }
 
-/* hopen -- opens a hash table with initial size hsize */
-hashtable_t *hopen(uint32_t hsize){
-    if(hsize<=0)
+uint64_t hash_fnv1a(const char *key, int keylen, uint64_t seed){
+	uint64_t h = 0xcbf29ce484222325ULL ^ seed;
+	for (int i = 0; i < keylen; i++){
+		h ^= (unsigned char)key[i];
+		h *= 0x100000001b3ULL;
+	}
+	return h;
+}
+
+/*
+ * hash_wy -- wyhash, final version 4, by Wang Yi, released into the
+ * public domain. Keys of up to 16 bytes, most words and many URLs,
+ * take two or four overlapping loads and two 64x64->128-bit
+ * multiplies; longer keys go 16 or 48 bytes a step. Loads assume a
+ * little-endian machine.
+ */
+static const uint64_t wyp[4] = { 0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL,
+                                 0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL };
+
+static inline void wymum(uint64_t *a, uint64_t *b){
+	__uint128_t r = (__uint128_t)*a * *b;
+	*a = (uint64_t)r;
+	*b = (uint64_t)(r >> 64);
+}
+
+static inline uint64_t wymix(uint64_t a, uint64_t b){
+	wymum(&a, &b);
+	return a ^ b;
+}
+
+static inline uint64_t wyr8(const uint8_t *p){
+	uint64_t v;
+	memcpy(&v, p, 8);
+	return v;
+}
+
+static inline uint64_t wyr4(const uint8_t *p){
+	uint32_t v;
+	memcpy(&v, p, 4);
+	return v;
+}
+
+static inline uint64_t wyr3(const uint8_t *p, size_t k){
+	return ((uint64_t)p[0] << 16) | ((uint64_t)p[k >> 1] << 8) | p[k - 1];
+}
+
+uint64_t hash_wy(const char *key, int keylen, uint64_t seed){
+	const uint8_t *p = (const uint8_t*)key;
+	size_t len = keylen > 0 ? (size_t)keylen : 0;
+	uint64_t a, b;
+
+	seed ^= wymix(seed ^ wyp[0], wyp[1]);
+	if (len <= 16){
+		if (len >= 4){
+			a = (wyr4(p) << 32) | wyr4(p + ((len >> 3) << 2));
+			b = (wyr4(p + len - 4) << 32) | wyr4(p + len - 4 - ((len >> 3) << 2));
+		}
+		else if (len > 0){
+			a = wyr3(p, len);
+			b = 0;
+		}
+		else {
+			a = b = 0;
+		}
+	}
+	else {
+		size_t i = len;
+		if (i >= 48){
+			uint64_t see1 = seed, see2 = seed;
+			do {
+				seed = wymix(wyr8(p) ^ wyp[1], wyr8(p + 8) ^ seed);
+				see1 = wymix(wyr8(p + 16) ^ wyp[2], wyr8(p + 24) ^ see1);
+				see2 = wymix(wyr8(p + 32) ^ wyp[3], wyr8(p + 40) ^ see2);
+				p += 48;
+				i -= 48;
+			} while (i >= 48);
+			seed ^= see1 ^ see2;
+		}
+		while (i > 16){
+			seed = wymix(wyr8(p) ^ wyp[1], wyr8(p + 8) ^ seed);
+			i -= 16;
+			p += 16;
+		}
+		a = wyr8(p + i - 16);
+		b = wyr8(p + i - 8);
+	}
+	a ^= wyp[1];
+	b ^= seed;
+	wymum(&a, &b);
+	return wymix(a ^ wyp[0] ^ len, b ^ wyp[1]);
+}
+
+static uint64_t splitmix64(uint64_t z){
+	z += 0x9e3779b97f4a7c15ULL;
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+static uint64_t process_seed;
+static pthread_once_t process_seed_once = PTHREAD_ONCE_INIT;
+
+/* 64 bits from the kernel's random source, read once per process:
+ * getrandom, else /dev/urandom, else the time as a last resort */
+static void read_process_seed(void){
+#ifdef __linux__
+	if(getrandom(&process_seed, sizeof(process_seed), GRND_NONBLOCK) == sizeof(process_seed))
+		return;
+#endif
+	FILE *file = fopen("/dev/urandom", "rb");
+	if(file!=NULL){
+		size_t n = fread(&process_seed, 1, sizeof(process_seed), file);
+		fclose(file);
+		if(n == sizeof(process_seed))
+			return;
+	}
+	process_seed = (uint64_t)time(NULL) ^ ((uint64_t)clock() << 32);
+}
+
+uint64_t hash_process_seed(void){
+	pthread_once(&process_seed_once, read_process_seed);
+	return process_seed;
+}
+
+/* a seed no one outside can predict: the process seed mixed with the
+ * address of the table, so that tables differ */
+static uint64_t random_seed(void *table){
+	return splitmix64(hash_process_seed() ^ (uint64_t)(uintptr_t)table);
+}
+
+static table_t *open_table(uint32_t hsize, hashfn_t fn, uint64_t seed){
+	if(hsize<=0 || fn==NULL)
 		return NULL;
 	table_t *table = malloc(sizeof(table_t));
 	if(table==NULL)
 		return NULL;
-	
-	table->tablesize = hsize;
-	table->hash_table = malloc(hsize * sizeof(queue_t*));
 
-	if(table->hash_table==NULL)
+	uint32_t size = 1;
+	while(size < hsize && size < (1u << 31))
+		size <<= 1;
+	table->tablesize = size;
+	table->count = 0;
+	table->fn = fn;
+	table->seed = seed;
+	table->arena = NULL;
+	table->free = NULL;
+	table->hash_table = calloc(size, sizeof(hnode_t*));
+	if(table->hash_table==NULL){
+		free(table);
 		return NULL;
-	
-	for(int i=0; i<hsize; i++){
-		table->hash_table[i] = qopen();
 	}
+	return table;
+}
+
+/* hopen -- opens a hash table with initial size hsize */
+hashtable_t *hopen(uint32_t hsize){
+	table_t *table = open_table(hsize, hash_wy, 0);
+	if(table!=NULL)
+		table->seed = random_seed(table);
 	return (hashtable_t*)table;
 }
 
+/* hopen_with -- opens a hash table with initial size hsize that hashes
+ * keys with fn under seed */
+hashtable_t *hopen_with(uint32_t hsize, hashfn_t fn, uint64_t seed){
+	return (hashtable_t*)open_table(hsize, fn, seed);
+}
+
+/* hopen_arena -- opens a hash table with initial size hsize that owns
+ * an arena, in which its nodes live */
+hashtable_t *hopen_arena(uint32_t hsize){
+	table_t *table = open_table(hsize, hash_wy, 0);
+	if(table==NULL)
+		return NULL;
+	table->seed = random_seed(table);
+	if((table->arena = arenaopen())==NULL){
+		free(table->hash_table);
+		free(table);
+		return NULL;
+	}
+	return (hashtable_t*)table;
+}
+
+/* harena -- the arena of a hash table, NULL unless from hopen_arena */
+arena_t *harena(hashtable_t *htp){
+	if(htp==NULL)
+		return NULL;
+	return ((table_t*)htp)->arena;
+}
+
 /* hclose -- closes a hash table */
 void hclose(hashtable_t *htp){
 	if(htp==NULL)
 		return;
 
 	table_t *table = (table_t*)htp;
-	for(int i=0; i<table->tablesize; i++){
-		qclose(table->hash_table[i]);
+	for(uint32_t i=0; table->arena==NULL && i<table->tablesize; i++){
+		hnode_t *np = table->hash_table[i], *next;
+		for(; np!=NULL; np=next){
+			next = np->next;
+			free(np->element);
+			free(np);
+		}
 	}
 	free(table->hash_table);
+	arenaclose(table->arena);
 	free(table);
 }
 
-/* hput -- puts an entry into a hash table under designated key 
+/* doubles the buckets, moving the nodes by their stored hashes; chains
+ * keep their order. Left as is if memory is short */
+static void grow(table_t *table){
+	uint32_t size = table->tablesize * 2;
+	hnode_t **buckets = calloc(size, sizeof(hnode_t*));
+	hnode_t **tails = calloc(size, sizeof(hnode_t*));
+	if(buckets==NULL || tails==NULL || size==0){
+		free(buckets);
+		free(tails);
+		return;
+	}
+	for(uint32_t i=0; i<table->tablesize; i++){
+		hnode_t *np = table->hash_table[i], *next;
+		for(; np!=NULL; np=next){
+			next = np->next;
+			uint32_t b = np->hash & (size - 1);
+			np->next = NULL;
+			if(tails[b]==NULL)
+				buckets[b] = np;
+			else
+				tails[b]->next = np;
+			tails[b] = np;
+		}
+	}
+	free(tails);
+	free(table->hash_table);
+	table->hash_table = buckets;
+	table->tablesize = size;
+}
+
+/* hput -- puts an entry into a hash table under designated key
  * returns 0 for success; non-zero otherwise
  */
 int32_t hput(hashtable_t *htp, void *ep, const char *key, int keylen){
 	if(htp==NULL || ep==NULL)
 		return -1;
 	table_t *table = (table_t*)htp;
-	uint32_t hash = SuperFastHash(key,keylen,table->tablesize);
+	hnode_t *np = table->free;
+	if(np!=NULL)
+		table->free = np->next;
+	else if(table->arena!=NULL)
+		np = arenaalloc(table->arena, sizeof(hnode_t));
+	else
+		np = malloc(sizeof(hnode_t));
+	if(np==NULL)
+		return -1;
+	np->hash = table->fn(key, keylen, table->seed);
+	np->element = ep;
+	np->next = NULL;
 
-	return qput(table->hash_table[hash], ep);
+	/* at the end of the chain, so that equal keys are found in order */
+	hnode_t **link = &table->hash_table[np->hash & (table->tablesize - 1)];
+	while(*link!=NULL)
+		link = &(*link)->next;
+	*link = np;
+	if(++table->count > table->tablesize)
+		grow(table);
+	return 0;
 }
 
 /* happly -- applies a function to every entry in hash table */
@@ -117,39 +371,75 @@ void happly(hashtable_t *htp, void (*fn)(void* ep)){
 	if(htp==NULL || fn==NULL)
 		return;
 	table_t *table = (table_t*)htp;
-	for(int i=0; i<table->tablesize; i++){
-		qapply(table->hash_table[i], fn);
+	for(uint32_t i=0; i<table->tablesize; i++){
+		for(hnode_t *np=table->hash_table[i]; np!=NULL; np=np->next)
+			fn(np->element);
 	}
 }
 
+/* happly_arg -- applies a function to every entry in hash table,
+ * passing arg along */
+void happly_arg(hashtable_t *htp, void (*fn)(void* ep, void* arg), void *arg){
+	if(htp==NULL || fn==NULL)
+		return;
+	table_t *table = (table_t*)htp;
+	for(uint32_t i=0; i<table->tablesize; i++){
+		for(hnode_t *np=table->hash_table[i]; np!=NULL; np=np->next)
+			fn(np->element, arg);
+	}
+}
+
+/* the link to the first node under key that searchfn accepts, or to
+ * the NULL ending its chain */
+static hnode_t **find(table_t *table,
+		      bool (*searchfn)(void* elementp, const void* searchkeyp),
+		      const char *key,
+		      int32_t keylen){
+	uint64_t hash = table->fn(key, keylen, table->seed);
+	hnode_t **link = &table->hash_table[hash & (table->tablesize - 1)];
+	for(; *link!=NULL; link=&(*link)->next){
+		if((*link)->hash==hash && searchfn((*link)->element, key))
+			break;
+	}
+	return link;
+}
+
 /* hsearch -- searchs for an entry under a designated key using a
  * designated search fn -- returns a pointer to the entry or NULL if
  * not found
  */
-void *hsearch(hashtable_t *htp, 
-	      bool (*searchfn)(void* elementp, const void* searchkeyp), 
-	      const char *key, 
+void *hsearch(hashtable_t *htp,
+	      bool (*searchfn)(void* elementp, const void* searchkeyp),
+	      const char *key,
 	      int32_t keylen){
 	if(htp==NULL || searchfn==NULL)
 		return NULL;
-	table_t *table = (table_t*)htp;
-	uint32_t hash = SuperFastHash(key,keylen,table->tablesize);
-
-	return qsearch(table->hash_table[hash],searchfn,key);
+	hnode_t *np = *find((table_t*)htp, searchfn, key, keylen);
+	return np ? np->element : NULL;
 }
 
 /* hremove -- removes and returns an entry under a designated key
  * using a designated search fn -- returns a pointer to the entry or
  * NULL if not found
  */
-void *hremove(hashtable_t *htp, 
-	      bool (*searchfn)(void* elementp, const void* searchkeyp), 
-	      const char *key, 
+void *hremove(hashtable_t *htp,
+	      bool (*searchfn)(void* elementp, const void* searchkeyp),
+	      const char *key,
 	      int32_t keylen){
 	if(htp==NULL || searchfn==NULL)
 		return NULL;
 	table_t *table = (table_t*)htp;
-	uint32_t hash = SuperFastHash(key,keylen,table->tablesize);
-
-	return qremove(table->hash_table[hash],searchfn, key);
+	hnode_t **link = find(table, searchfn, key, keylen), *np = *link;
+	if(np==NULL)
+		return NULL;
+	void *element = np->element;
+	*link = np->next;
+	if(table->arena!=NULL){
+		np->next = table->free;
+		table->free = np;
+	}
+	else
+		free(np);
+	table->count--;
+	return element;
 }
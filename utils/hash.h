@@ -6,12 +6,47 @@
  */
 #include <stdint.h>
 #include <stdbool.h>
+#include "arena.h"
 
 typedef void hashtable_t;	/* representation of a hashtable hidden */
 
-/* hopen -- opens a hash table with initial size hsize */
+/* a hash function: 64 bits from the keylen bytes at key and a seed.
+ * A table hashes each key once, in hput, and keeps the result with
+ * the entry, so it never hashes a key again as it grows */
+typedef uint64_t (*hashfn_t)(const char *key, int keylen, uint64_t seed);
+
+/* wyhash, final version 4: the default */
+uint64_t hash_wy(const char *key, int keylen, uint64_t seed);
+
+/* 64-bit FNV-1a, the seed mixed into its offset basis */
+uint64_t hash_fnv1a(const char *key, int keylen, uint64_t seed);
+
+/* SuperFastHash, which tables used before; 32 bits */
+uint64_t hash_superfast(const char *key, int keylen, uint64_t seed);
+
+/* hash_process_seed -- 64 bits from the kernel's random source, read
+ * once per process; the seed of hashes over keys that clients pick */
+uint64_t hash_process_seed(void);
+
+/* hopen -- opens a hash table with initial size hsize, hashing with
+ * hash_wy under a seed picked at random, so that which keys collide
+ * cannot be worked out in advance. Tables double as they fill */
 hashtable_t *hopen(uint32_t hsize);
 
+/* hopen_with -- opens a hash table with initial size hsize, hashing
+ * with fn under seed */
+hashtable_t *hopen_with(uint32_t hsize, hashfn_t fn, uint64_t seed);
+
+/* hopen_arena -- opens a hash table with initial size hsize that owns
+ * an arena (see arena.h), in which its nodes live and its users
+ * may allocate its entries: hclose frees neither the entries nor
+ * anything else on their own but closes the arena, releasing all at
+ * once */
+hashtable_t *hopen_arena(uint32_t hsize);
+
+/* harena -- the arena of a hash table, NULL unless from hopen_arena */
+arena_t *harena(hashtable_t *htp);
+
 /* hclose -- closes a hash table */
 void hclose(hashtable_t *htp);
 
@@ -23,6 +58,10 @@ int32_t hput(hashtable_t *htp, void *ep, const char *key, int keylen);
 /* happly -- applies a function to every entry in hash table */
 void happly(hashtable_t *htp, void (*fn)(void* ep));
 
+/* happly_arg -- applies a function to every entry in hash table,
+ * passing arg along */
+void happly_arg(hashtable_t *htp, void (*fn)(void* ep, void* arg), void *arg);
+
 /* hsearch -- searchs for an entry under a designated key using a
  * designated search fn -- returns a pointer to the entry or NULL if
  * not found
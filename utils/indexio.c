@@ -10,14 +10,25 @@
  * <word> is a string of lowercase  letters, <docIDi> is a positive integer designating a document, 
  * <counti> is a positive integer designating the number of occurrences of <word> in <docIDi>; 
  * each entry should be placed on the line separated by a space. 
+ * Lines are sorted by <word> and the <docIDi> of a line are increasing.
+ * 
+ * Loading reads the whole file, splits it into newline-aligned chunks and 
+ * parses the chunks on several threads; the parsed entries are then put 
+ * into the hashtable by the calling thread. A loaded index lives in the 
+ * arena of its hashtable: each thread parses into an arena of its own, 
+ * which the index adopts.
  * 
  */
 
+#define _POSIX_C_SOURCE 200809L    // sysconf
+
+#include <pthread.h>
 #include "indexio.h"
+#include "typed.h"
 
 #define hsize 1000    // hashtable size
-
-static FILE *file;
+#define MIN_CHUNK (64*1024)    // smallest file chunk worth its own thread
+#define MAX_THREADS 16
 
 /* allocate entry */
 entry_t *new_entry(char *word){
@@ -49,92 +60,346 @@ document_t *new_doc(int id, int word_count){
 	
 	dp->id = id;
 	dp->word_count = word_count;
+	dp->positions = NULL;
 	return dp;
 }
 
+/* allocate entry in arena */
+entry_t *new_entry_arena(arena_t *arena, char *word){
+	if (arena == NULL)
+		return new_entry(word);
+	if (!word)
+		return NULL;
+
+	size_t len = strlen(word) + 1;
+	entry_t *entry = arenaalloc(arena, sizeof(entry_t));
+	if (!entry)
+		return NULL;
+	entry->documents = qopen_arena(arena);
+	entry->word = arenaalloc(arena, len);
+	if (entry->documents == NULL || entry->word == NULL)
+		return NULL;
+	memcpy(entry->word, word, len);
+	return entry;
+}
+
+/* allocate document in arena */
+document_t *new_doc_arena(arena_t *arena, int id, int word_count){
+	if (arena == NULL)
+		return new_doc(id, word_count);
+
+	document_t *dp = arenaalloc(arena, sizeof(document_t));
+	if (!dp)
+		return NULL;
+	dp->id = id;
+	dp->word_count = word_count;
+	dp->positions = NULL;
+	return dp;
+}
+
+static void free_positions(void *dp){
+    free(((document_t*)dp)->positions);
+}
+
 /* frees all the entries in the index hashtable */
 static void free_entry(void *ep){
     entry_t *entryp = (entry_t*)ep;
     free(entryp->word);
+    qapply(entryp->documents, free_positions);
     qclose(entryp->documents);
 }
 
 void free_entries(hashtable_t *index){
+    if (harena(index) != NULL)
+        return;    // hclose releases the arena, entries and all
     happly(index,free_entry);
 }
 
-/* appends doc id and word count in doc */
-static void doc_queue_write_fn(void *elementp){
-    document_t *dp = (document_t*)elementp;
-    fprintf(file, "%d %d ", dp->id, dp->word_count);
+/* growable array of the entries of an index, used to sort them */
+TYPED_VECTOR(entries, entry_t*)
+
+/* the entries of an index by word, keyed by the word of the entry */
+TYPED_MAP(words, char*, entry_t*, typed_strhash, typed_streq)
+
+static void collect_fn(void *elementp, void *arg){
+    entries_push((entries_t*)arg, (entry_t*)elementp);
 }
 
-static void index_write_fn(void *elementp){
-    entry_t *ep = (entry_t*)elementp;
-    fprintf(file, "%s ", ep->word);
-    qapply(ep->documents, doc_queue_write_fn);
-    fprintf(file, "\n");
+static int entry_cmp(const void *a, const void *b){
+    const entry_t *ea = *(const entry_t**)a;
+    const entry_t *eb = *(const entry_t**)b;
+    return strcmp(ea->word, eb->word);
+}
+
+/* appends doc id and word count in doc */
+static void doc_queue_write_fn(void *elementp, void *arg){
+    document_t *dp = (document_t*)elementp;
+    fprintf((FILE*)arg, "%d %d ", dp->id, dp->word_count);
 }
 
 /*
  * indexsave -- save the index to filename indexnm
  * line format: <word> <docID1> <count1> <docID2> <count2> ....<docIDN> <countN> 
+ * lines are written in increasing word order so that saved indices
+ * can be merged by streaming them (see indexmerge.h)
  * returns: 0 for success; nonzero otherwise
  */
 int32_t indexsave(hashtable_t *index, char *indexnm){
 
     /* open file */
-    file = fopen(indexnm, "w");
+    FILE *file = fopen(indexnm, "w");
     if (file == NULL || access(indexnm, W_OK) != 0){
         printf("Failed to create file: %s\n",indexnm);
         return 1;
     }
 
+    /* sort */
+    entries_t ents = { NULL, 0, 0 };
+    happly_arg(index, collect_fn, &ents);
+    qsort(ents.items, ents.count, sizeof(entry_t*), entry_cmp);
+
     /* write */
-    happly(index, index_write_fn);
+    for (int i = 0; i < ents.count; i++){
+        fprintf(file, "%s ", ents.items[i]->word);
+        qapply_arg(ents.items[i]->documents, doc_queue_write_fn, file);
+        fprintf(file, "\n");
+    }
 
+    entries_free(&ents);
     fclose(file);
     return 0;
 }
 
+/* adds an entry of the index to a words map */
+static void word_collect_fn(void *elementp, void *arg){
+    entry_t *ep = (entry_t*)elementp;
+    entry_t **slot = words_insert((words_t*)arg, ep->word, NULL);
+    if (slot != NULL)
+        *slot = ep;
+}
+
 /* 
  * indexload -- loads the index from file indexnm
  * returns: non-NULL for success; NULL otherwise
  */
 hashtable_t *indexload(char *indexnm){
+    hashtable_t *index = hopen_arena(hsize);
+    if (index == NULL)
+        return NULL;
 
-    /* open file */
-    FILE *file = fopen(indexnm, "r");
-    if (file == NULL || access(indexnm, R_OK) != 0) {
+    if (indexappend(index, indexnm) != 0){
+        hclose(index);
         return NULL;
     }
+    return index;
+}
+
+/* chunk -- a newline-aligned part of an index file and its parsed entries */
+typedef struct chunk {
+    char *begin;
+    char *end;
+    entries_t ents;
+    arena_t *arena;    // where the entries are allocated; NULL for the heap
+} chunk_t;
+
+static inline bool is_blank(char c){
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+/* scans an unsigned decimal number at *p, advancing *p past it
+ * returns: false if there is no number at *p
+ */
+static inline bool scan_int(char **p, char *end, int *value){
+    char *c = *p;
+    int v = 0;
 
-    hashtable_t *index = hopen(hsize);
-    const int MAX_LINE_LEN = 1024;
-    char line_buffer[MAX_LINE_LEN];
-    char *token;
-    char *delim = " ";
+    while (c < end && is_blank(*c))
+        c++;
+    if (c == end || *c < '0' || *c > '9')
+        return false;
+    while (c < end && *c >= '0' && *c <= '9')
+        v = 10*v + (*c++ - '0');
+    *value = v;
+    *p = c;
+    return true;
+}
+
+/* parses the lines of a chunk into entries */
+static void *parse_chunk(void *arg){
+    chunk_t *cp = (chunk_t*)arg;
+    char *p = cp->begin, *end = cp->end;
     int id, word_count;
 
-    while (fgets(line_buffer, MAX_LINE_LEN, file)) {
-        /* remove trailing white space */
-        int len = strcspn(line_buffer, "\r\n");
-        line_buffer[len] = '\0';
-
-        token = strtok(line_buffer, delim);
-        entry_t *ep = new_entry(token);
-        hput(index, ep, token, strlen(token));
-        
-        while ((token = strtok(NULL, delim)) != NULL) {
-            id = atoi(token);
-            token = strtok(NULL, delim);
-            word_count = atoi(token);
-            document_t *dp = new_doc(id, word_count);
-            qput(ep->documents, dp);
+    while (p < end){
+        /* word */
+        while (p < end && (is_blank(*p) || *p == '\n'))
+            p++;
+        char *word = p;
+        while (p < end && !is_blank(*p) && *p != '\n')
+            p++;
+        if (p == word)
+            break;
+        char sep = p < end ? *p : '\n';
+        *p = '\0';    // the buffer has room for a terminator past end
+        entry_t *ep = new_entry_arena(cp->arena, word);
+        if (ep == NULL)
+            break;
+        entries_push(&cp->ents, ep);
+        if (sep == '\n'){
+            p++;
+            continue;
         }
-        
+        p++;
+
+        /* <docID> <count> pairs up to the end of the line */
+        while (scan_int(&p, end, &id) && scan_int(&p, end, &word_count))
+            qput(ep->documents, new_doc_arena(cp->arena, id, word_count));
+        while (p < end && *p != '\n')
+            p++;
     }
+    return NULL;
+}
+
+/* number of loader threads for a file of size bytes */
+static int loader_threads(size_t size){
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    long nthreads = (long)(size / MIN_CHUNK);
+
+    if (ncpu < 1)
+        ncpu = 1;
+    if (nthreads > ncpu)
+        nthreads = ncpu;
+    if (nthreads > MAX_THREADS)
+        nthreads = MAX_THREADS;
+    return nthreads < 1 ? 1 : (int)nthreads;
+}
+
+/* reads the whole file into a buffer with a spare terminating byte */
+static char *read_file(FILE *file, size_t *size){
+    if (fseek(file, 0, SEEK_END) != 0)
+        return NULL;
+    long len = ftell(file);
+    if (len < 0 || fseek(file, 0, SEEK_SET) != 0)
+        return NULL;
 
+    char *buf = malloc(len + 1);
+    if (buf == NULL)
+        return NULL;
+    *size = fread(buf, 1, len, file);
+    buf[*size] = '\0';
+    return buf;
+}
+
+/* the index files are appended to and the entries of its words */
+typedef struct loader {
+    hashtable_t *index;
+    words_t words;
+} loader_t;
+
+indexloader_t *indexloaderopen(hashtable_t *index){
+    if (index == NULL)
+        return NULL;
+    loader_t *lp = malloc(sizeof(loader_t));
+    if (lp == NULL)
+        return NULL;
+    lp->index = index;
+    lp->words = (words_t){ NULL, 0, 0 };
+    happly_arg(index, word_collect_fn, &lp->words);
+    return (indexloader_t*)lp;
+}
+
+void indexloaderclose(indexloader_t *loader){
+    loader_t *lp = (loader_t*)loader;
+    if (lp == NULL)
+        return;
+    words_free(&lp->words);
+    free(lp);
+}
+
+/*
+ * indexappend -- loads the index in file indexnm into an existing index
+ * returns: 0 for success; nonzero otherwise
+ */
+int32_t indexappend(hashtable_t *index, char *indexnm){
+    indexloader_t *lp = indexloaderopen(index);
+    if (lp == NULL)
+        return 1;
+    int32_t result = indexloaderappend(lp, indexnm);
+    indexloaderclose(lp);
+    return result;
+}
+
+int32_t indexloaderappend(indexloader_t *loader, char *indexnm){
+    loader_t *lp = (loader_t*)loader;
+    if (lp == NULL)
+        return 1;
+    hashtable_t *index = lp->index;
+
+    /* open file */
+    FILE *file = fopen(indexnm, "r");
+    if (file == NULL || access(indexnm, R_OK) != 0) {
+        return 1;
+    }
+
+    size_t size = 0;
+    char *buf = read_file(file, &size);
     fclose(file);
-    return index;
+    if (buf == NULL)
+        return 1;
+
+    /* split into newline-aligned chunks */
+    int nthreads = loader_threads(size);
+    chunk_t chunks[nthreads];
+    char *p = buf, *end = buf + size;
+    for (int i = 0; i < nthreads; i++){
+        chunks[i].begin = p;
+        p = (i == nthreads-1) ? end : buf + (size / nthreads) * (i+1);
+        if (p < chunks[i].begin)
+            p = chunks[i].begin;
+        while (p > buf && p < end && *(p-1) != '\n')
+            p++;
+        chunks[i].end = p;
+        chunks[i].ents = (entries_t){ NULL, 0, 0 };
+        chunks[i].arena = harena(index) ? arenaopen() : NULL;
+    }
+
+    /* parse */
+    pthread_t threads[nthreads];
+    bool started[nthreads];
+    for (int i = 1; i < nthreads; i++){
+        started[i] = pthread_create(&threads[i], NULL, parse_chunk, &chunks[i]) == 0;
+        if (!started[i])
+            parse_chunk(&chunks[i]);
+    }
+    parse_chunk(&chunks[0]);
+
+    /* merge the entries of every chunk, in file order, into those 
+     * already in the index */
+    for (int i = 0; i < nthreads; i++){
+        if (i > 0 && started[i])
+            pthread_join(threads[i], NULL);
+        if (chunks[i].arena != NULL)
+            arenaadopt(harena(index), chunks[i].arena);
+        entries_t *ents = &chunks[i].ents;
+        for (int j = 0; j < ents->count; j++){
+            entry_t *ep = ents->items[j];
+            bool found;
+            entry_t **slot = words_insert(&lp->words, ep->word, &found);
+            if (slot != NULL && found){
+                qconcat((*slot)->documents, ep->documents);
+                if (chunks[i].arena == NULL){
+                    free(ep->word);
+                    free(ep);
+                }
+                continue;
+            }
+            if (slot != NULL)
+                *slot = ep;
+            hput(index, ep, ep->word, strlen(ep->word));
+        }
+        entries_free(ents);
+    }
+
+    free(buf);
+    return 0;
 }
@@ -31,10 +31,14 @@ typedef struct entry{
  *
  * @param id - document id designated by crawler
  * @param word_count - the count of a specific word in the index in this doc
+ * @param positions - the word_count positions of the word in the doc, 
+ *                    increasing (see posio.h); NULL unless recorded. 
+ *                    In the arena of the index if it has one
  */
 typedef struct document{
 	int id;
 	int word_count;
+	int *positions;
 } document_t;
 
 /* allocate index entry */
@@ -43,6 +47,13 @@ entry_t *new_entry(char *word);
 /* allocate document */
 document_t *new_doc(int id, int word_count);
 
+/* allocate index entry in arena, whose queue of documents is in the 
+ * arena too (see queue.h); from the heap if arena is NULL */
+entry_t *new_entry_arena(arena_t *arena, char *word);
+
+/* allocate document in arena; from the heap if arena is NULL */
+document_t *new_doc_arena(arena_t *arena, int id, int word_count);
+
 /*
  * indexsave -- save the index to filename indexnm
  *
@@ -55,11 +66,45 @@ int32_t indexsave(hashtable_t *index, char *indexnm);
  *
  * returns: non-NULL for success; NULL otherwise
  * 
- * the user is responsible for freeing the hash table
+ * the user is responsible for freeing the hash table; its entries are 
+ * in its arena (see hopen_arena)
  */
 hashtable_t *indexload(char *indexnm);
 
 /*
- * free_entries -- frees all entry structs in the index
+ * indexappend -- loads the index in file indexnm into an existing
+ * index; documents of words already present are appended to the
+ * existing entry. The new entries go in the arena of the index if it 
+ * has one, on the heap otherwise
+ *
+ * returns: 0 for success; nonzero otherwise
+ */
+int32_t indexappend(hashtable_t *index, char *indexnm);
+
+/* a loader appending several index files to one index */
+typedef void indexloader_t;
+
+/*
+ * indexloaderopen -- starts appending index files to index. The words 
+ * already in the index are mapped once, here, so that each file 
+ * appended through the loader costs only its own words
+ *
+ * returns: non-NULL for success; NULL otherwise
+ */
+indexloader_t *indexloaderopen(hashtable_t *index);
+
+/*
+ * indexloaderappend -- as indexappend, into the index of the loader
+ *
+ * returns: 0 for success; nonzero otherwise
+ */
+int32_t indexloaderappend(indexloader_t *loader, char *indexnm);
+
+/* indexloaderclose -- frees the loader, leaving its index loaded */
+void indexloaderclose(indexloader_t *loader);
+
+/*
+ * free_entries -- frees all entry structs in the index; nothing to do 
+ * for an index with an arena, which hclose releases whole
  */
 void free_entries(hashtable_t *index);
@@ -0,0 +1,222 @@
+/* indexmerge.c --- streaming k-way merge of saved index files
+ *
+ * Author: Ian Kamweru, Abdibaset Bare, Nathaniel Mensah
+ * Version: 1.0
+ *
+ * Description: each input is read one line (one word) at a time. At
+ * every step the smallest current word across the inputs is written,
+ * followed by the union of its document lists merged in increasing
+ * id order; the inputs holding that word then advance to their next
+ * line. Nothing but the current line of each input is kept in memory.
+ */
+
+#define _POSIX_C_SOURCE 200809L    // getline
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "indexmerge.h"
+
+/* reader -- the current line of one input index */
+typedef struct reader {
+	char *name;         // file name, for error messages
+	FILE *file;
+	char *line;         // current line (getline buffer)
+	size_t size;        // size of the line buffer
+	char *prev;         // word of the previous line, to check order
+	size_t prev_size;
+	char *word;         // word of the current line
+	char *pos;          // first unread posting of the current line
+	int offset;         // added to every document id
+	int id;             // current posting, valid if has_posting
+	int count;
+	bool has_posting;
+	bool done;          // no more lines
+} reader_t;
+
+/* reads the next posting of the current line */
+static void next_posting(reader_t *rp){
+	char *end;
+	long id, count;
+
+	rp->has_posting = false;
+	id = strtol(rp->pos, &end, 10);
+	if (end == rp->pos)
+		return;
+	rp->pos = end;
+	count = strtol(rp->pos, &end, 10);
+	if (end == rp->pos)
+		return;
+	rp->pos = end;
+	rp->id = (int)id + rp->offset;
+	rp->count = (int)count;
+	rp->has_posting = true;
+}
+
+/* reads the next line of an input
+ * returns: 0 for success or end of input; nonzero if lines are out of order
+ */
+static int32_t next_line(reader_t *rp){
+	ssize_t len;
+
+	/* remember the word we are leaving */
+	if (rp->word != NULL){
+		size_t wlen = strlen(rp->word) + 1;
+		if (wlen > rp->prev_size){
+			rp->prev = realloc(rp->prev, wlen);
+			rp->prev_size = wlen;
+		}
+		strcpy(rp->prev, rp->word);
+	}
+
+	do {
+		len = getline(&rp->line, &rp->size, rp->file);
+		if (len < 0){
+			rp->done = true;
+			rp->word = NULL;
+			return 0;
+		}
+		rp->line[strcspn(rp->line, "\r\n")] = '\0';
+	} while (rp->line[0] == '\0');
+
+	rp->word = rp->line;
+	rp->pos = rp->line + strcspn(rp->line, " ");
+	if (*rp->pos != '\0')
+		*(rp->pos++) = '\0';
+
+	if (rp->prev != NULL && strcmp(rp->prev, rp->word) >= 0){
+		printf("Index %s is not sorted at word: %s\n", rp->name, rp->word);
+		return 1;
+	}
+	next_posting(rp);
+	return 0;
+}
+
+static void close_readers(reader_t *readers, int ninputs){
+	for (int i = 0; i < ninputs; i++){
+		if (readers[i].file)
+			fclose(readers[i].file);
+		free(readers[i].line);
+		free(readers[i].prev);
+	}
+	free(readers);
+}
+
+/*
+ * indexmerge -- merges the ninputs index files in inputs into outnm
+ * returns: 0 for success; nonzero otherwise
+ */
+int32_t indexmerge(char **inputs, int ninputs, int *offsets, char *outnm){
+	if (inputs == NULL || ninputs <= 0 || outnm == NULL)
+		return 1;
+
+	reader_t *readers = calloc(ninputs, sizeof(reader_t));
+	if (readers == NULL)
+		return 1;
+
+	for (int i = 0; i < ninputs; i++){
+		readers[i].name = inputs[i];
+		readers[i].offset = offsets ? offsets[i] : 0;
+		readers[i].file = fopen(inputs[i], "r");
+		if (readers[i].file == NULL){
+			printf("Failed to open index: %s\n", inputs[i]);
+			close_readers(readers, ninputs);
+			return 1;
+		}
+		if (next_line(&readers[i]) != 0){
+			close_readers(readers, ninputs);
+			return 1;
+		}
+	}
+
+	FILE *out = fopen(outnm, "w");
+	if (out == NULL){
+		printf("Failed to create file: %s\n", outnm);
+		close_readers(readers, ninputs);
+		return 1;
+	}
+
+	int32_t status = 0;
+	while (status == 0){
+		/* smallest current word */
+		char *word = NULL;
+		for (int i = 0; i < ninputs; i++){
+			if (!readers[i].done && (word == NULL || strcmp(readers[i].word, word) < 0))
+				word = readers[i].word;
+		}
+		if (word == NULL)
+			break;
+		fprintf(out, "%s ", word);
+
+		/* merge the document lists of every input holding the word */
+		while (true){
+			int id = 0, count = 0;
+			bool found = false;
+			for (int i = 0; i < ninputs; i++){
+				reader_t *rp = &readers[i];
+				if (rp->done || !rp->has_posting || strcmp(rp->word, word) != 0)
+					continue;
+				if (!found || rp->id < id){
+					id = rp->id;
+					count = rp->count;
+					found = true;
+				}
+				else if (rp->id == id){
+					count = rp->count;    // the later input wins
+				}
+			}
+			if (!found)
+				break;
+			fprintf(out, "%d %d ", id, count);
+			for (int i = 0; i < ninputs; i++){
+				reader_t *rp = &readers[i];
+				if (!rp->done && rp->has_posting && rp->id == id && strcmp(rp->word, word) == 0)
+					next_posting(rp);
+			}
+		}
+		fprintf(out, "\n");
+
+		/* advance; word points into one of the lines, so compare first */
+		bool advance[ninputs];
+		for (int i = 0; i < ninputs; i++)
+			advance[i] = !readers[i].done && strcmp(readers[i].word, word) == 0;
+		for (int i = 0; i < ninputs && status == 0; i++){
+			if (advance[i])
+				status = next_line(&readers[i]);
+		}
+	}
+
+	fclose(out);
+	close_readers(readers, ninputs);
+	if (status != 0)
+		remove(outnm);
+	return status;
+}
+
+/*
+ * index_maxid -- highest document id in index file indexnm
+ */
+int index_maxid(char *indexnm){
+	reader_t reader;
+	int maxid = 0, status;
+
+	memset(&reader, 0, sizeof(reader));
+	reader.name = indexnm;
+	reader.file = fopen(indexnm, "r");
+	if (reader.file == NULL)
+		return -1;
+
+	while ((status = next_line(&reader)) == 0 && !reader.done){
+		for (; reader.has_posting; next_posting(&reader)){
+			if (reader.id > maxid)
+				maxid = reader.id;
+		}
+	}
+	if (status != 0)
+		maxid = -1;
+	fclose(reader.file);
+	free(reader.line);
+	free(reader.prev);
+	return maxid;
+}
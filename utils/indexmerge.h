@@ -0,0 +1,36 @@
+#pragma once
+/* 
+ * indexmerge.h --- streaming k-way merge of saved index files
+ * 
+ * Author: Ian Kamweru, Abdibaset Bare, Nathaniel Mensah
+ * Version: 1.0
+ * 
+ * Description: merges several index files written by indexsave()
+ * (lines sorted by word, document ids increasing within a line) into
+ * one index file in the same format. The inputs are streamed a line at
+ * a time, so memory use is bounded by the longest line of the inputs
+ * rather than by the size of the index.
+ */
+
+#include <stdint.h>
+
+/*
+ * indexmerge -- merges the ninputs index files in inputs into outnm
+ * 
+ * offsets -- if non-NULL, offsets[i] is added to every document id
+ *            read from inputs[i] (used to remap ids of separate crawls)
+ * 
+ * When a document id occurs under the same word in several inputs,
+ * the posting of the last such input wins.
+ *
+ * returns: 0 for success; nonzero otherwise (an input is missing or
+ * its lines are not sorted)
+ */
+int32_t indexmerge(char **inputs, int ninputs, int *offsets, char *outnm);
+
+/*
+ * index_maxid -- streams index file indexnm and returns its highest
+ * document id, 0 if it is empty, or -1 if it cannot be read or its
+ * lines are not sorted
+ */
+int index_maxid(char *indexnm);
@@ -0,0 +1,180 @@
+/* 
+ * intersect.c -- sorted-id intersection kernels
+ *
+ * Author: Ian Kamweru, Abdibaset Bare, Nathaniel Mensah
+ * Version: 1.0
+ * 
+ * Description: the vector kernels compare a block of each list with
+ * every rotation of the other block (shuffles), so one pass finds all
+ * matches between the blocks; then whichever block ends with the
+ * smaller id is replaced by the next. A scalar merge finishes the
+ * lists once fewer than a block of either remains.
+ */
+
+#define _POSIX_C_SOURCE 200809L    // pthread_once
+
+#include <stdbool.h>
+#include <pthread.h>
+#include "intersect.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86 1
+#endif
+
+static bool have_sse2 = false;
+static bool have_avx2 = false;
+static pthread_once_t cpu_once = PTHREAD_ONCE_INIT;
+
+static void detect_cpu(void){
+#ifdef HAVE_X86
+	__builtin_cpu_init();
+	have_sse2 = __builtin_cpu_supports("sse2");
+	have_avx2 = __builtin_cpu_supports("avx2");
+#endif
+}
+
+/* merges a[i..] and b[j..] into out[n..]; returns the new n */
+static int merge_tail(const int *a, int na, int i, const int *b, int nb, int j, int *out, int n){
+	while (i < na && j < nb){
+		if (a[i] < b[j])
+			i++;
+		else if (a[i] > b[j])
+			j++;
+		else {
+			out[n++] = a[i];
+			i++, j++;
+		}
+	}
+	return n;
+}
+
+static int intersect_scalar(const int *a, int na, const int *b, int nb, int *out){
+	return merge_tail(a, na, 0, b, nb, 0, out, 0);
+}
+
+int intersect_seek(const int *ids, int n, int from, int id, long *probes){
+	int bound = 1, lo = from, hi = from;
+	long count = 0;
+	while (hi < n && ids[hi] < id){
+		count++;
+		lo = hi + 1;
+		hi += bound;
+		bound *= 2;
+	}
+	if (hi > n)
+		hi = n;
+	while (lo < hi){
+		int mid = lo + (hi - lo) / 2;
+		count++;
+		if (ids[mid] < id)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (probes)
+		*probes += count;
+	return lo;
+}
+
+/* looks each id of the shorter list up in the longer by galloping */
+static int intersect_gallop(const int *a, int na, const int *b, int nb, int *out){
+	if (na > nb)
+		return intersect_gallop(b, nb, a, na, out);
+	int n = 0, j = 0;
+	for (int i = 0; i < na && j < nb; i++){
+		j = intersect_seek(b, nb, j, a[i], NULL);
+		if (j < nb && b[j] == a[i])
+			out[n++] = a[i];
+	}
+	return n;
+}
+
+#ifdef HAVE_X86
+static int intersect_sse2(const int *a, int na, const int *b, int nb, int *out){
+	int i = 0, j = 0, n = 0;
+	while (i + 4 <= na && j + 4 <= nb){
+		__m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+		__m128i vb = _mm_loadu_si128((const __m128i*)(b + j));
+		__m128i eq = _mm_cmpeq_epi32(va, vb);
+		eq = _mm_or_si128(eq, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0,3,2,1))));
+		eq = _mm_or_si128(eq, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1,0,3,2))));
+		eq = _mm_or_si128(eq, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2,1,0,3))));
+		for (int mask = _mm_movemask_ps(_mm_castsi128_ps(eq)); mask; mask &= mask - 1)
+			out[n++] = a[i + __builtin_ctz(mask)];
+		int amax = a[i+3], bmax = b[j+3];
+		if (amax <= bmax)
+			i += 4;
+		if (bmax <= amax)
+			j += 4;
+	}
+	return merge_tail(a, na, i, b, nb, j, out, n);
+}
+
+__attribute__((target("avx2")))
+static int intersect_avx2(const int *a, int na, const int *b, int nb, int *out){
+	int i = 0, j = 0, n = 0;
+	const __m256i rotate = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0);
+	while (i + 8 <= na && j + 8 <= nb){
+		__m256i va = _mm256_loadu_si256((const __m256i*)(a + i));
+		__m256i vb = _mm256_loadu_si256((const __m256i*)(b + j));
+		__m256i eq = _mm256_cmpeq_epi32(va, vb);
+		for (int r = 1; r < 8; r++){
+			vb = _mm256_permutevar8x32_epi32(vb, rotate);
+			eq = _mm256_or_si256(eq, _mm256_cmpeq_epi32(va, vb));
+		}
+		for (int mask = _mm256_movemask_ps(_mm256_castsi256_ps(eq)); mask; mask &= mask - 1)
+			out[n++] = a[i + __builtin_ctz(mask)];
+		int amax = a[i+7], bmax = b[j+7];
+		if (amax <= bmax)
+			i += 8;
+		if (bmax <= amax)
+			j += 8;
+	}
+	return merge_tail(a, na, i, b, nb, j, out, n);
+}
+#endif
+
+int intersect_with(intersect_kind_t kind, const int *a, int na, const int *b, int nb, int *out){
+	if (na <= 0 || nb <= 0)
+		return 0;
+	pthread_once(&cpu_once, detect_cpu);
+
+	if (kind == INTERSECT_AUTO){
+		if (na >= INTERSECT_GALLOP_RATIO * nb || nb >= INTERSECT_GALLOP_RATIO * na)
+			kind = INTERSECT_GALLOP;
+		else
+			kind = have_avx2 ? INTERSECT_AVX2 : have_sse2 ? INTERSECT_SSE2 : INTERSECT_SCALAR;
+	}
+	switch (kind){
+	case INTERSECT_GALLOP:
+		return intersect_gallop(a, na, b, nb, out);
+#ifdef HAVE_X86
+	case INTERSECT_SSE2:
+		return have_sse2 ? intersect_sse2(a, na, b, nb, out) : -1;
+	case INTERSECT_AVX2:
+		return have_avx2 ? intersect_avx2(a, na, b, nb, out) : -1;
+#else
+	case INTERSECT_SSE2:
+	case INTERSECT_AVX2:
+		return -1;
+#endif
+	default:
+		return intersect_scalar(a, na, b, nb, out);
+	}
+}
+
+int intersect(const int *a, int na, const int *b, int nb, int *out){
+	return intersect_with(INTERSECT_AUTO, a, na, b, nb, out);
+}
+
+const char *intersect_name(intersect_kind_t kind){
+	switch (kind){
+	case INTERSECT_AUTO:   return "auto";
+	case INTERSECT_SCALAR: return "scalar merge";
+	case INTERSECT_GALLOP: return "galloping";
+	case INTERSECT_SSE2:   return "sse2 blocks";
+	case INTERSECT_AVX2:   return "avx2 blocks";
+	}
+	return "unknown";
+}
@@ -0,0 +1,46 @@
+#pragma once
+/* 
+ * intersect.h -- public interface to sorted-id intersection kernels
+ * 
+ * Author: Ian Kamweru, Abdibaset Bare, Nathaniel Mensah
+ * Version: 1.0
+ * 
+ * Description: intersects two lists of increasing, distinct ids. A
+ * scalar merge, galloping (for lists of very different lengths) and
+ * block-compare kernels using SSE2 or AVX2 are provided; intersect
+ * picks galloping when one list is INTERSECT_GALLOP_RATIO times longer
+ * than the other, and otherwise the widest kernel the processor
+ * supports, detected once at run time.
+ */
+
+#define INTERSECT_GALLOP_RATIO 32
+
+typedef enum {
+	INTERSECT_AUTO,
+	INTERSECT_SCALAR,
+	INTERSECT_GALLOP,
+	INTERSECT_SSE2,
+	INTERSECT_AVX2
+} intersect_kind_t;
+
+/* intersect -- writes the ids in both a (na ids) and b (nb ids) to out,
+ * which must have room for the shorter of the two lists
+ * returns: the number of ids written
+ */
+int intersect(const int *a, int na, const int *b, int nb, int *out);
+
+/* intersect_with -- intersects with the given kernel
+ * returns: the number of ids written; -1 if the processor lacks the kernel
+ */
+int intersect_with(intersect_kind_t kind, const int *a, int na, const int *b, int nb, int *out);
+
+/* intersect_seek -- the index of the first of the n increasing ids, from
+ * index from on, that is at least id, found by galloping, so skipping far
+ * costs the log of the distance; if probes is not NULL, the ids compared
+ * are added to it
+ * returns: that index; n if every id is smaller
+ */
+int intersect_seek(const int *ids, int n, int from, int id, long *probes);
+
+/* intersect_name -- the name of a kernel, for reports */
+const char *intersect_name(intersect_kind_t kind);
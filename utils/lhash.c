@@ -11,42 +11,59 @@
 #include <queue.h>
 #include <hash.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <lhash.h>
 #include <pthread.h>
 
-pthread_mutex_t mutex_h = PTHREAD_MUTEX_INITIALIZER;
+/* a locked hashtable is a hashtable with its own mutex, so separate
+ * locked hashtables never contend with each other */
+typedef struct lockedHash {
+    pthread_mutex_t mutex;
+    hashtable_t *table;
+} lockedHash_t;
 
 /* lhopen -- opens a hash table with initial size hsize */
-hashtable_t* lhopen(uint32_t lhsize){
-    pthread_mutex_lock(&mutex_h);
-    lhash_t* lhtp = (lhash_t*) hopen(lhsize);
-    pthread_mutex_unlock(&mutex_h);
-    return lhtp;
+lhash_t* lhopen(uint32_t lhsize){
+    lockedHash_t *lh = malloc(sizeof(lockedHash_t));
+    if(lh == NULL)
+        return NULL;
+    if((lh->table = hopen(lhsize)) == NULL){
+        free(lh);
+        return NULL;
+    }
+    pthread_mutex_init(&lh->mutex, NULL);
+    return (lhash_t*)lh;
 }
 
 /* lhclose -- closes a hash table */
 void lhclose(lhash_t* lhtp){
-    pthread_mutex_lock(&mutex_h);
-    hclose((hashtable_t*)lhtp);
-    pthread_mutex_unlock(&mutex_h);
-    pthread_mutex_destroy(&mutex_h); // Destroy the mutex
+    if(lhtp == NULL)
+        return;
+    lockedHash_t *lh = (lockedHash_t*)lhtp;
+    pthread_mutex_lock(&lh->mutex);
+    hclose(lh->table);
+    pthread_mutex_unlock(&lh->mutex);
+    pthread_mutex_destroy(&lh->mutex); // Destroy the mutex
+    free(lh);
 }
 
 /* lhput -- puts an entry into a hash table under designated key 
  * returns 0 for success; non-zero otherwise
  */
 int32_t lhput(lhash_t* lhtp, void *ep, const char *key, int keylen){
-    pthread_mutex_lock(&mutex_h);
-    int32_t status = hput((hashtable_t*)lhtp,ep,key,keylen);
-    pthread_mutex_unlock(&mutex_h);
+    lockedHash_t *lh = (lockedHash_t*)lhtp;
+    pthread_mutex_lock(&lh->mutex);
+    int32_t status = hput(lh->table,ep,key,keylen);
+    pthread_mutex_unlock(&lh->mutex);
     return status;
 }
 
 /* lhapply -- applies a function to every entry in hash table */
 void lhapply(lhash_t* lhtp, void(*fn)(void *ep)){
-    pthread_mutex_lock(&mutex_h);
-    happly((hashtable_t*)lhtp, fn);
-    pthread_mutex_unlock(&mutex_h);
+    lockedHash_t *lh = (lockedHash_t*)lhtp;
+    pthread_mutex_lock(&lh->mutex);
+    happly(lh->table, fn);
+    pthread_mutex_unlock(&lh->mutex);
 }
 
 /* lhsearch -- searchs for an entry under a designated key using a
@@ -54,9 +71,10 @@ void lhapply(lhash_t* lhtp, void(*fn)(void *ep)){
  */
 void* lhsearch(lhash_t *lhtp, bool(*searchfn)(void *ep, const void *searchkeyp), 
                 const char *key, int keylen){
-    pthread_mutex_lock(&mutex_h);
-    void* entry = hsearch((hashtable_t*)lhtp, searchfn, key, keylen);
-    pthread_mutex_unlock(&mutex_h);
+    lockedHash_t *lh = (lockedHash_t*)lhtp;
+    pthread_mutex_lock(&lh->mutex);
+    void* entry = hsearch(lh->table, searchfn, key, keylen);
+    pthread_mutex_unlock(&lh->mutex);
     return entry;
 }
 
@@ -66,8 +84,9 @@ void* lhsearch(lhash_t *lhtp, bool(*searchfn)(void *ep, const void *searchkeyp),
  */
 void* lhremove(lhash_t *lhtp, bool(*searchfn)(void *ep, const void *searchkeyp), 
                 const char *key, int keylen){
-    pthread_mutex_lock(&mutex_h);
-    void* data = hremove((hashtable_t*)lhtp, searchfn, key, keylen);
-    pthread_mutex_unlock(&mutex_h);
+    lockedHash_t *lh = (lockedHash_t*)lhtp;
+    pthread_mutex_lock(&lh->mutex);
+    void* data = hremove(lh->table, searchfn, key, keylen);
+    pthread_mutex_unlock(&lh->mutex);
     return data;
 }
@@ -15,48 +15,65 @@
 #include <queue.h>
 #include <pthread.h>
 
-pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+/* a locked queue is a queue with its own mutex, so separate locked
+ * queues never contend with each other */
+typedef struct lockedQueue {
+    pthread_mutex_t mutex;
+    queue_t *queue;
+} lockedQueue_t;
 
 /* initialize empty locked queue */
 lqueue_t* lqopen(void) {
-    pthread_mutex_lock(&mutex); // Lock the mutex
-    queue_t* lqueue = qopen();
-    pthread_mutex_unlock(&mutex); // Unlock the mutex
-    return (lqueue_t*)lqueue;
+    lockedQueue_t *lq = (lockedQueue_t*)malloc(sizeof(lockedQueue_t));
+    if (lq == NULL)
+        return NULL;
+    if ((lq->queue = qopen()) == NULL) {
+        free(lq);
+        return NULL;
+    }
+    pthread_mutex_init(&lq->mutex, NULL);
+    return (lqueue_t*)lq;
 }
 
 /* deallocate a locked queue, frees everything in it */
 void lqclose(lqueue_t *lqueue) {
-    pthread_mutex_lock(&mutex); // Lock the mutex
-    qclose((queue_t*)lqueue);
-    pthread_mutex_unlock(&mutex); // Unlock the mutex
-    pthread_mutex_destroy(&mutex); // Destroy the mutex
+    if (lqueue == NULL)
+        return;
+    lockedQueue_t *lq = (lockedQueue_t*)lqueue;
+    pthread_mutex_lock(&lq->mutex); // Lock the mutex
+    qclose(lq->queue);
+    pthread_mutex_unlock(&lq->mutex); // Unlock the mutex
+    pthread_mutex_destroy(&lq->mutex); // Destroy the mutex
+    free(lq);
 }
 
 /* put element at the end of the locked queue
  * returns 0 is successful; nonzero otherwise 
  */
 int32_t lqput(lqueue_t *lqueue, void* elementp) {
+    lockedQueue_t *lq = (lockedQueue_t*)lqueue;
     int32_t status; // keep track of whether the operation was successful
-    pthread_mutex_lock(&mutex); // Lock the mutex
-    status = qput((queue_t*)lqueue, elementp);
-    pthread_mutex_unlock(&mutex); // Unlock the mutex
+    pthread_mutex_lock(&lq->mutex); // Lock the mutex
+    status = qput(lq->queue, elementp);
+    pthread_mutex_unlock(&lq->mutex); // Unlock the mutex
     return status;
 }
 
 /* get the first first element from locked queue, removing it from the queue */
 void* lqget(lqueue_t *lqueue) {
-    pthread_mutex_lock(&mutex); // Lock the mutex
-    void *data = qget(lqueue);
-    pthread_mutex_unlock(&mutex); // Unlock the mutex
+    lockedQueue_t *lq = (lockedQueue_t*)lqueue;
+    pthread_mutex_lock(&lq->mutex); // Lock the mutex
+    void *data = qget(lq->queue);
+    pthread_mutex_unlock(&lq->mutex); // Unlock the mutex
     return data;
 }
 
 /* apply a function to every element of the locked queue */
 void lqapply(lqueue_t *lqueue, void (*fn)(void* elementp)) {
-    pthread_mutex_lock(&mutex); // Lock the mutex
-    qapply((queue_t*)lqueue, fn);
-    pthread_mutex_unlock(&mutex); // Unlock the mutex
+    lockedQueue_t *lq = (lockedQueue_t*)lqueue;
+    pthread_mutex_lock(&lq->mutex); // Lock the mutex
+    qapply(lq->queue, fn);
+    pthread_mutex_unlock(&lq->mutex); // Unlock the mutex
 }
 
 /* search a locked queue using a supplied boolean function
@@ -69,8 +86,9 @@ void lqapply(lqueue_t *lqueue, void (*fn)(void* elementp)) {
  * returns a pointer to an element, or NULL if not found
  */
 void* lqsearch(lqueue_t *lqueue, bool (*searchfn)(void* element,const void* keyp),const void* skeyp) {
-    pthread_mutex_lock(&mutex); // Lock the mutex
-    void* data = qsearch((queue_t*)lqueue, searchfn, skeyp);
-    pthread_mutex_unlock(&mutex); // Unlock the mutex
+    lockedQueue_t *lq = (lockedQueue_t*)lqueue;
+    pthread_mutex_lock(&lq->mutex); // Lock the mutex
+    void* data = qsearch(lq->queue, searchfn, skeyp);
+    pthread_mutex_unlock(&lq->mutex); // Unlock the mutex
     return data;
 }
@@ -0,0 +1,194 @@
+/* 
+ * lrucache.c -- bounded, thread-safe LRU cache
+ *
+ * Author: Ian Kamweru, Abdibaset Bare, Nathaniel Mensah
+ * Version: 1.0
+ * 
+ * Description: entries are found through a typed hash map (see
+ * typed.h) and kept on a doubly linked list in recency order, most
+ * recently used first; the entry at the tail is the one evicted when
+ * the cache is over budget.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "lrucache.h"
+#include "typed.h"
+
+#define NODE_OVERHEAD 64    // bookkeeping bytes charged per entry
+
+typedef struct lrunode {
+	char *key;
+	char *value;
+	size_t len;
+	struct lrunode *prev;    // more recently used
+	struct lrunode *next;    // less recently used
+} lrunode_t;
+
+/* key -> lrunode_t, keyed by the key of the node */
+TYPED_MAP(nodes, const char*, lrunode_t*, typed_strhash, typed_streq)
+
+typedef struct lru {
+	pthread_mutex_t mutex;
+	nodes_t table;
+	lrunode_t *head;         // most recently used
+	lrunode_t *tail;         // least recently used
+	size_t bytes;
+	size_t maxbytes;
+	uint64_t hits;
+	uint64_t misses;
+} lru_t;
+
+static size_t node_bytes(lrunode_t *np){
+	return strlen(np->key) + 1 + np->len + NODE_OVERHEAD;
+}
+
+static void unlink_node(lru_t *lru, lrunode_t *np){
+	if (np->prev) np->prev->next = np->next; else lru->head = np->next;
+	if (np->next) np->next->prev = np->prev; else lru->tail = np->prev;
+	np->prev = np->next = NULL;
+}
+
+static void push_front(lru_t *lru, lrunode_t *np){
+	np->prev = NULL;
+	np->next = lru->head;
+	if (lru->head) lru->head->prev = np; else lru->tail = np;
+	lru->head = np;
+}
+
+/* removes an entry from the table and the list and frees it */
+static void evict(lru_t *lru, lrunode_t *np){
+	unlink_node(lru, np);
+	nodes_remove(&lru->table, np->key, NULL, NULL);
+	lru->bytes -= node_bytes(np);
+	free(np->key);
+	free(np->value);
+	free(np);
+}
+
+/* frees every entry and empties the table */
+static void free_nodes(lru_t *lru){
+	lrunode_t *next;
+	for (lrunode_t *np = lru->head; np != NULL; np = next){
+		next = np->next;
+		free(np->key);
+		free(np->value);
+		free(np);
+	}
+	nodes_clear(&lru->table);
+	lru->head = lru->tail = NULL;
+	lru->bytes = 0;
+}
+
+lrucache_t *lruopen(size_t maxbytes){
+	lru_t *lru = malloc(sizeof(lru_t));
+	if (lru == NULL)
+		return NULL;
+	lru->table = (nodes_t){ NULL, 0, 0 };
+	pthread_mutex_init(&lru->mutex, NULL);
+	lru->head = lru->tail = NULL;
+	lru->bytes = 0;
+	lru->maxbytes = maxbytes;
+	lru->hits = lru->misses = 0;
+	return (lrucache_t*)lru;
+}
+
+void lruclose(lrucache_t *cp){
+	if (cp == NULL)
+		return;
+	lru_t *lru = (lru_t*)cp;
+	free_nodes(lru);
+	nodes_free(&lru->table);
+	pthread_mutex_destroy(&lru->mutex);
+	free(lru);
+}
+
+char *lruget(lrucache_t *cp, const char *key, size_t *len){
+	if (cp == NULL || key == NULL)
+		return NULL;
+	lru_t *lru = (lru_t*)cp;
+	char *copy = NULL;
+
+	pthread_mutex_lock(&lru->mutex);
+	lrunode_t **npp = nodes_find(&lru->table, key);
+	lrunode_t *np = npp ? *npp : NULL;
+	if (np == NULL){
+		lru->misses++;
+	}
+	else if ((copy = malloc(np->len + 1)) != NULL){
+		lru->hits++;
+		memcpy(copy, np->value, np->len);
+		copy[np->len] = '\0';
+		if (len)
+			*len = np->len;
+		unlink_node(lru, np);
+		push_front(lru, np);
+	}
+	pthread_mutex_unlock(&lru->mutex);
+	return copy;
+}
+
+int32_t lruput(lrucache_t *cp, const char *key, const char *value, size_t len){
+	if (cp == NULL || key == NULL || value == NULL)
+		return -1;
+	lru_t *lru = (lru_t*)cp;
+	if (strlen(key) + 1 + len + NODE_OVERHEAD > lru->maxbytes)
+		return -1;
+
+	lrunode_t *np = malloc(sizeof(lrunode_t));
+	if (np == NULL)
+		return -1;
+	np->key = malloc(strlen(key) + 1);
+	np->value = malloc(len + 1);
+	np->len = len;
+	if (np->key == NULL || np->value == NULL){
+		free(np->key);
+		free(np->value);
+		free(np);
+		return -1;
+	}
+	strcpy(np->key, key);
+	memcpy(np->value, value, len);
+	np->value[len] = '\0';
+
+	pthread_mutex_lock(&lru->mutex);
+	lrunode_t **old = nodes_find(&lru->table, key);
+	if (old)
+		evict(lru, *old);
+	while (lru->tail && lru->bytes + node_bytes(np) > lru->maxbytes)
+		evict(lru, lru->tail);
+	lrunode_t **slot = nodes_insert(&lru->table, np->key, NULL);
+	if (slot == NULL){
+		pthread_mutex_unlock(&lru->mutex);
+		free(np->key);
+		free(np->value);
+		free(np);
+		return -1;
+	}
+	*slot = np;
+	push_front(lru, np);
+	lru->bytes += node_bytes(np);
+	pthread_mutex_unlock(&lru->mutex);
+	return 0;
+}
+
+void lruclear(lrucache_t *cp){
+	if (cp == NULL)
+		return;
+	lru_t *lru = (lru_t*)cp;
+	pthread_mutex_lock(&lru->mutex);
+	free_nodes(lru);
+	pthread_mutex_unlock(&lru->mutex);
+}
+
+void lrustats(lrucache_t *cp, uint64_t *hits, uint64_t *misses, size_t *bytes){
+	if (cp == NULL)
+		return;
+	lru_t *lru = (lru_t*)cp;
+	pthread_mutex_lock(&lru->mutex);
+	if (hits) *hits = lru->hits;
+	if (misses) *misses = lru->misses;
+	if (bytes) *bytes = lru->bytes;
+	pthread_mutex_unlock(&lru->mutex);
+}
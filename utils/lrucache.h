@@ -0,0 +1,45 @@
+#pragma once
+/* 
+ * lrucache.h -- public interface to a bounded, thread-safe LRU cache
+ * 
+ * Author: Ian Kamweru, Abdibaset Bare, Nathaniel Mensah
+ * Version: 1.0
+ * 
+ * Description: maps string keys to byte strings. The cache holds at
+ * most maxbytes of keys, values and bookkeeping; inserting past the
+ * limit evicts the least recently used entries. Every operation takes
+ * the cache's own lock, so a cache may be shared by many threads.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* the cache representation is hidden from users of the module */
+typedef void lrucache_t;
+
+/* lruopen -- opens an empty cache holding at most maxbytes */
+lrucache_t *lruopen(size_t maxbytes);
+
+/* lruclose -- closes a cache, freeing every entry */
+void lruclose(lrucache_t *cp);
+
+/* lruget -- looks up key and marks it most recently used
+ * returns a malloc'd copy of the value (its length in *len), which the
+ * caller must free, or NULL if the key is not cached
+ */
+char *lruget(lrucache_t *cp, const char *key, size_t *len);
+
+/* lruput -- caches a copy of the len bytes of value under key,
+ * replacing any earlier value
+ * returns 0 for success; nonzero if the entry is larger than the cache
+ * or memory is exhausted
+ */
+int32_t lruput(lrucache_t *cp, const char *key, const char *value, size_t len);
+
+/* lruclear -- removes every entry, e.g. when the data cached is stale */
+void lruclear(lrucache_t *cp);
+
+/* lrustats -- reports the number of lookups that hit and missed and
+ * the bytes in use; any of the pointers may be NULL
+ */
+void lrustats(lrucache_t *cp, uint64_t *hits, uint64_t *misses, size_t *bytes);
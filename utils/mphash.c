@@ -0,0 +1,212 @@
+/*
+ * mphash.c -- a minimal perfect hash of fixed keys
+ *
+ * Author: Ian Kamweru, Abdibaset Bare, Nathaniel Mensah
+ * Version: 1.0
+ *
+ * Description: each key is hashed once to 64 bits; the hash of a
+ * level is that value remixed with the level number, so no string is
+ * read twice. The bit arrays of all levels are laid end to end and
+ * the number of set bits before each 64-bit word is kept alongside,
+ * so the rank of a bit is one table read and one popcount. The few
+ * keys still colliding after MAX_LEVELS levels are kept in a short
+ * list searched by hash; if two of them share a hash, the build fails.
+ */
+
+#include <string.h>
+#include <stdbool.h>
+#include "mphash.h"
+
+#define GAMMA 2          // bits of a level per key still to place
+#define MAX_LEVELS 32
+
+typedef struct mph {
+	int nlevels;
+	size_t offsets[MAX_LEVELS + 1];  // first word of each level in bits
+	uint64_t *bits;      // every level's bits, level after level
+	uint32_t *ranks;     // set bits before each word of bits
+	int *positions;      // the key of each slot
+	int nfallback;       // keys placed by no level
+	uint64_t *fallback_hashes;
+	int *fallback_positions;
+	size_t nwords;
+	int nkeys;
+} mph_t;
+
+/* 64-bit FNV-1a */
+static uint64_t key_hash(const char *key){
+	uint64_t h = 0xcbf29ce484222325ULL;
+	for (const unsigned char *p = (const unsigned char*)key; *p; p++){
+		h ^= *p;
+		h *= 0x100000001b3ULL;
+	}
+	return h;
+}
+
+/* the hash of a key at a level: splitmix64 of its hash and the level */
+static inline uint64_t level_hash(uint64_t h, int level){
+	uint64_t z = h + (uint64_t)(level + 1) * 0x9e3779b97f4a7c15ULL;
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+static inline bool test_bit(const uint64_t *bits, size_t i){
+	return (bits[i / 64] >> (i % 64)) & 1;
+}
+
+static inline void set_bit(uint64_t *bits, size_t i){
+	bits[i / 64] |= (uint64_t)1 << (i % 64);
+}
+
+/* the slot of a key whose hash is h, placed at level */
+static inline int slot(mph_t *mp, uint64_t h, int level, bool *placed){
+	size_t nbits = (mp->offsets[level+1] - mp->offsets[level]) * 64;
+	size_t bit = mp->offsets[level] * 64 + level_hash(h, level) % nbits;
+	*placed = test_bit(mp->bits, bit);
+	uint64_t before = mp->bits[bit / 64] & (((uint64_t)1 << (bit % 64)) - 1);
+	return mp->ranks[bit / 64] + __builtin_popcountll(before);
+}
+
+mphash_t *mphbuild(char **keys, int n){
+	mph_t *mp = calloc(1, sizeof(mph_t));
+	uint64_t *hashes = malloc((n ? n : 1) * sizeof(uint64_t));
+	int *remaining = malloc((n ? n : 1) * sizeof(int));
+	int *levels = malloc((n ? n : 1) * sizeof(int));    // level of each key
+	if (mp == NULL || hashes == NULL || remaining == NULL || levels == NULL){
+		free(mp);
+		free(hashes);
+		free(remaining);
+		free(levels);
+		return NULL;
+	}
+	mp->nkeys = n;
+	for (int i = 0; i < n; i++){
+		hashes[i] = key_hash(keys[i]);
+		remaining[i] = i;
+		levels[i] = -1;
+	}
+
+	/* place the keys level by level */
+	int nremaining = n;
+	bool ok = true;
+	while (nremaining > 0 && mp->nlevels < MAX_LEVELS && ok){
+		int level = mp->nlevels;
+		size_t words = ((size_t)GAMMA * nremaining + 63) / 64;
+		size_t nbits = words * 64;
+		uint64_t *seen = calloc(words, sizeof(uint64_t));
+		uint64_t *collided = calloc(words, sizeof(uint64_t));
+		uint64_t *bits = realloc(mp->bits, (mp->nwords + words) * sizeof(uint64_t));
+		if (seen == NULL || collided == NULL || bits == NULL){
+			free(seen);
+			free(collided);
+			if (bits != NULL)
+				mp->bits = bits;
+			ok = false;
+			break;
+		}
+		mp->bits = bits;
+		for (int i = 0; i < nremaining; i++){
+			size_t bit = level_hash(hashes[remaining[i]], level) % nbits;
+			if (test_bit(seen, bit))
+				set_bit(collided, bit);
+			set_bit(seen, bit);
+		}
+		int kept = 0;
+		for (int i = 0; i < nremaining; i++){
+			size_t bit = level_hash(hashes[remaining[i]], level) % nbits;
+			if (test_bit(collided, bit))
+				remaining[kept++] = remaining[i];
+			else
+				levels[remaining[i]] = level;
+		}
+		for (size_t w = 0; w < words; w++)
+			mp->bits[mp->nwords + w] = seen[w] & ~collided[w];
+		free(seen);
+		free(collided);
+		mp->offsets[level] = mp->nwords;
+		mp->nwords += words;
+		mp->offsets[level + 1] = mp->nwords;
+		mp->nlevels++;
+		nremaining = kept;
+	}
+
+	/* keys whose hashes are equal can never be told apart */
+	for (int i = 0; ok && i < nremaining; i++){
+		for (int j = i + 1; ok && j < nremaining; j++)
+			ok = hashes[remaining[i]] != hashes[remaining[j]];
+	}
+
+	/* ranks, then the key of every slot */
+	mp->ranks = malloc((mp->nwords ? mp->nwords : 1) * sizeof(uint32_t));
+	mp->positions = malloc((n ? n : 1) * sizeof(int));
+	mp->fallback_hashes = malloc((nremaining ? nremaining : 1) * sizeof(uint64_t));
+	mp->fallback_positions = malloc((nremaining ? nremaining : 1) * sizeof(int));
+	if (!ok || mp->ranks == NULL || mp->positions == NULL ||
+	    mp->fallback_hashes == NULL || mp->fallback_positions == NULL){
+		free(hashes);
+		free(remaining);
+		free(levels);
+		mphclose(mp);
+		return NULL;
+	}
+	uint32_t rank = 0;
+	for (size_t w = 0; w < mp->nwords; w++){
+		mp->ranks[w] = rank;
+		rank += __builtin_popcountll(mp->bits[w]);
+	}
+	for (int i = 0; i < n; i++){
+		bool placed;
+		if (levels[i] >= 0)
+			mp->positions[slot(mp, hashes[i], levels[i], &placed)] = i;
+	}
+	for (int i = 0; i < nremaining; i++){
+		mp->fallback_hashes[i] = hashes[remaining[i]];
+		mp->fallback_positions[i] = remaining[i];
+		mp->positions[rank + i] = remaining[i];
+	}
+	mp->nfallback = nremaining;
+
+	free(hashes);
+	free(remaining);
+	free(levels);
+	return (mphash_t*)mp;
+}
+
+void mphclose(mphash_t *mpp){
+	if (mpp == NULL)
+		return;
+	mph_t *mp = (mph_t*)mpp;
+	free(mp->bits);
+	free(mp->ranks);
+	free(mp->positions);
+	free(mp->fallback_hashes);
+	free(mp->fallback_positions);
+	free(mp);
+}
+
+int mphlookup(mphash_t *mpp, const char *key){
+	mph_t *mp = (mph_t*)mpp;
+	if (mp == NULL || key == NULL || mp->nkeys == 0)
+		return -1;
+	uint64_t h = key_hash(key);
+	for (int level = 0; level < mp->nlevels; level++){
+		bool placed;
+		int s = slot(mp, h, level, &placed);
+		if (placed)
+			return mp->positions[s];
+	}
+	for (int i = 0; i < mp->nfallback; i++){
+		if (mp->fallback_hashes[i] == h)
+			return mp->fallback_positions[i];
+	}
+	return -1;
+}
+
+size_t mphbytes(mphash_t *mpp){
+	mph_t *mp = (mph_t*)mpp;
+	if (mp == NULL)
+		return 0;
+	return sizeof(mph_t) + mp->nwords * (sizeof(uint64_t) + sizeof(uint32_t)) +
+	       mp->nkeys * sizeof(int) + mp->nfallback * (sizeof(uint64_t) + sizeof(int));
+}
@@ -0,0 +1,41 @@
+#pragma once
+/*
+ * mphash.h -- public interface to a minimal perfect hash of fixed keys
+ *
+ * Author: Ian Kamweru, Abdibaset Bare, Nathaniel Mensah
+ * Version: 1.0
+ *
+ * Description: built once over n distinct strings, the function maps
+ * each of them to its own position in the array it was built from,
+ * with no collisions and a few bits per key besides the positions. It
+ * is built level by level in the manner of BBHash: every remaining
+ * key is hashed into a bit array about twice as large as their
+ * number, the keys that land on a bit alone are placed there, and
+ * the keys that collide move on to the next, smaller level. A key is
+ * looked up by hashing it at each level until its bit is found set;
+ * the number of set bits before it gives its slot. A string that is
+ * not one of the keys also lands on some slot, so the caller compares
+ * the key at the position returned with the string looked up.
+ */
+#include <stdint.h>
+#include <stdlib.h>
+
+/* the function representation is hidden from users of the module */
+typedef void mphash_t;
+
+/* mphbuild -- builds the function over the n keys, which are distinct
+ * returns: non-NULL for success; NULL otherwise (including the very
+ * unlikely case of two keys with the same 64-bit hash)
+ */
+mphash_t *mphbuild(char **keys, int n);
+
+/* mphclose -- frees a function */
+void mphclose(mphash_t *mp);
+
+/* mphlookup -- the position among the keys of the only key that key
+ * may be; -1 if it is none of them
+ */
+int mphlookup(mphash_t *mp, const char *key);
+
+/* mphbytes -- the heap bytes held by the function */
+size_t mphbytes(mphash_t *mp);
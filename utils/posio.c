@@ -0,0 +1,229 @@
+/* posio.c --- saves and reads the word positions of an index
+ *
+ * Author: Ian Kamweru, Abdibaset Bare, Nathaniel Mensah
+ * Version: 1.0
+ *
+ * Description: records are written word by word in sorted order,
+ * documents by increasing id, so that every number but the first of
+ * a sequence is a small delta and most take a single varint byte.
+ * Reading never copies: posscan walks the file in memory and hands
+ * out pointers to the encoded positions, which are decoded on use.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "posio.h"
+#include "indexio.h"
+#include "typed.h"
+
+#define COPY_BUF 65536
+
+void pos_path(char *indexnm, char *buf, size_t len){
+	snprintf(buf, len, "%s.pos", indexnm);
+}
+
+static void put_varint(FILE *file, unsigned value){
+	while (value >= 0x80){
+		putc((value & 0x7f) | 0x80, file);
+		value >>= 7;
+	}
+	putc(value, file);
+}
+
+/* reads a varint at *p, before end, advancing *p past it
+ * returns: false if there is no complete varint at *p
+ */
+static inline bool get_varint(const uint8_t **p, const uint8_t *end, unsigned *value){
+	unsigned v = 0;
+	for (int shift = 0; *p < end && shift < 35; shift += 7){
+		uint8_t byte = *(*p)++;
+		v |= (unsigned)(byte & 0x7f) << shift;
+		if (byte < 0x80){
+			*value = v;
+			return true;
+		}
+	}
+	return false;
+}
+
+/* growable array of the entries of an index, used to sort them */
+TYPED_VECTOR(entries, entry_t*)
+
+static void collect_fn(void *elementp, void *arg){
+	entries_push((entries_t*)arg, (entry_t*)elementp);
+}
+
+static int entry_cmp(const void *a, const void *b){
+	return strcmp((*(entry_t* const*)a)->word, (*(entry_t* const*)b)->word);
+}
+
+/* the documents of one entry, to sort them by id */
+typedef struct docs {
+	document_t **items;
+	int count;
+} docs_t;
+
+static void count_fn(void *elementp, void *arg){
+	(*(int*)arg)++;
+}
+
+static void doc_collect_fn(void *elementp, void *arg){
+	docs_t *dp = (docs_t*)arg;
+	dp->items[dp->count++] = (document_t*)elementp;
+}
+
+static int doc_cmp(const void *a, const void *b){
+	return (*(document_t* const*)a)->id - (*(document_t* const*)b)->id;
+}
+
+int32_t possave(hashtable_t *index, char *posnm){
+	FILE *file = fopen(posnm, "wb");
+	if (file == NULL){
+		printf("Failed to create file: %s\n", posnm);
+		return 1;
+	}
+
+	entries_t ents = { NULL, 0, 0 };
+	happly_arg(index, collect_fn, &ents);
+	qsort(ents.items, ents.count, sizeof(entry_t*), entry_cmp);
+
+	int32_t status = 0;
+	for (int i = 0; i < ents.count && status == 0; i++){
+		int ndocs = 0;
+		qapply_arg(ents.items[i]->documents, count_fn, &ndocs);
+		docs_t docs = { malloc((ndocs ? ndocs : 1) * sizeof(document_t*)), 0 };
+		if (docs.items == NULL){
+			status = 1;
+			break;
+		}
+		qapply_arg(ents.items[i]->documents, doc_collect_fn, &docs);
+		qsort(docs.items, docs.count, sizeof(document_t*), doc_cmp);
+
+		fputs(ents.items[i]->word, file);
+		putc('\0', file);
+		put_varint(file, docs.count);
+		int prev_id = 0;
+		for (int j = 0; j < docs.count; j++){
+			document_t *dp = docs.items[j];
+			if (dp->positions == NULL){
+				printf("No positions for %s in document %d\n", ents.items[i]->word, dp->id);
+				status = 1;
+				break;
+			}
+			put_varint(file, dp->id - prev_id);
+			put_varint(file, dp->word_count);
+			prev_id = dp->id;
+			for (int k = 0, prev = 0; k < dp->word_count; k++){
+				put_varint(file, dp->positions[k] - prev);
+				prev = dp->positions[k];
+			}
+		}
+		free(docs.items);
+	}
+
+	entries_free(&ents);
+	if (fclose(file) != 0)
+		status = 1;
+	if (status != 0)
+		remove(posnm);
+	return status;
+}
+
+int32_t posconcat(char **inputs, int ninputs, char *outnm){
+	FILE *out = fopen(outnm, "wb");
+	if (out == NULL){
+		printf("Failed to create file: %s\n", outnm);
+		return 1;
+	}
+
+	char buf[COPY_BUF];
+	int32_t status = 0;
+	for (int i = 0; i < ninputs && status == 0; i++){
+		FILE *in = fopen(inputs[i], "rb");
+		if (in == NULL){
+			printf("Failed to open positions: %s\n", inputs[i]);
+			status = 1;
+			break;
+		}
+		size_t n;
+		while ((n = fread(buf, 1, sizeof(buf), in)) > 0){
+			if (fwrite(buf, 1, n, out) != n){
+				status = 1;
+				break;
+			}
+		}
+		fclose(in);
+	}
+
+	if (fclose(out) != 0)
+		status = 1;
+	if (status != 0)
+		remove(outnm);
+	return status;
+}
+
+uint8_t *posread(char *posnm, size_t *len){
+	FILE *file = fopen(posnm, "rb");
+	if (file == NULL)
+		return NULL;
+
+	uint8_t *buf = NULL;
+	long size;
+	if (fseek(file, 0, SEEK_END) == 0 && (size = ftell(file)) >= 0 &&
+	    fseek(file, 0, SEEK_SET) == 0 && (buf = malloc(size ? size : 1)) != NULL){
+		*len = fread(buf, 1, size, file);
+		if (*len != (size_t)size){
+			free(buf);
+			buf = NULL;
+		}
+	}
+	fclose(file);
+	return buf;
+}
+
+int32_t posscan(const uint8_t *buf, size_t len,
+                void (*fn)(const char *word, int id, int count, const uint8_t *positions, void *arg),
+                void *arg){
+	const uint8_t *p = buf, *end = buf + len;
+	unsigned ndocs, delta, count, skip;
+
+	while (p < end){
+		const char *word = (const char*)p;
+		const uint8_t *nul = memchr(p, '\0', end - p);
+		if (nul == NULL || nul == p)
+			return 1;
+		p = nul + 1;
+		if (!get_varint(&p, end, &ndocs))
+			return 1;
+
+		int id = 0;
+		for (unsigned i = 0; i < ndocs; i++){
+			if (!get_varint(&p, end, &delta) || !get_varint(&p, end, &count))
+				return 1;
+			id += delta;
+			const uint8_t *positions = p;
+			for (unsigned j = 0; j < count; j++){
+				if (!get_varint(&p, end, &skip))
+					return 1;
+			}
+			fn(word, id, (int)count, positions, arg);
+		}
+	}
+	return 0;
+}
+
+void posdecode(const uint8_t *p, int count, int *positions){
+	int pos = 0;
+	for (int i = 0; i < count; i++){
+		unsigned v = 0;
+		int shift = 0;
+		uint8_t byte;
+		do {
+			byte = *p++;
+			v |= (unsigned)(byte & 0x7f) << shift;
+			shift += 7;
+		} while (byte >= 0x80);
+		pos += v;
+		positions[i] = pos;
+	}
+}
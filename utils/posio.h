@@ -0,0 +1,68 @@
+#pragma once
+/*
+ * posio.h --- saves and reads the word positions of an index
+ *
+ * Author: Ian Kamweru, Abdibaset Bare, Nathaniel Mensah
+ * Version: 1.0
+ *
+ * Description: an index built with positions has a position file
+ * <indexnm>.pos next to each index or segment file. The position of a
+ * word in a page is the ordinal of that occurrence among the indexed
+ * words of the page, counting from 0. For every word, in increasing
+ * word order, the file holds one record:
+ *   <word> NUL <ndocs> { <id delta> <count> <position deltas> }...
+ * where every number is a varint (7 bits a byte, low bits first), the
+ * first id and the first position are deltas from 0, and the ids of a
+ * record increase. Position files of indices covering disjoint ranges
+ * of ids can be concatenated; a word then has a record in each part.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "hash.h"
+
+/*
+ * pos_path -- builds the position file name of index file indexnm
+ * into buf (of size len)
+ */
+void pos_path(char *indexnm, char *buf, size_t len);
+
+/*
+ * possave -- saves the positions of every document of index to file
+ * posnm; each document_t holds word_count positions, increasing
+ *
+ * returns: 0 for success; nonzero otherwise
+ */
+int32_t possave(hashtable_t *index, char *posnm);
+
+/*
+ * posconcat -- writes the ninputs position files in inputs, one after
+ * the other, to outnm; the inputs must cover disjoint ranges of ids
+ *
+ * returns: 0 for success; nonzero otherwise
+ */
+int32_t posconcat(char **inputs, int ninputs, char *outnm);
+
+/*
+ * posread -- reads position file posnm into a buffer of *len bytes
+ *
+ * returns: the buffer, which the user frees; NULL if it cannot be read
+ */
+uint8_t *posread(char *posnm, size_t *len);
+
+/*
+ * posscan -- calls fn once for every document of every record in the
+ * len bytes of buf, with the word, the document id, the number of
+ * positions and where they start (see posdecode)
+ *
+ * returns: 0 for success; nonzero if buf is not a valid position file
+ */
+int32_t posscan(const uint8_t *buf, size_t len,
+                void (*fn)(const char *word, int id, int count, const uint8_t *positions, void *arg),
+                void *arg);
+
+/*
+ * posdecode -- decodes count positions starting at p, as passed to
+ * the fn of posscan, into positions
+ */
+void posdecode(const uint8_t *p, int count, int *positions);
@@ -0,0 +1,382 @@
+/* 
+ * qindex.c -- read-only index for answering queries
+ *
+ * Author: Ian Kamweru, Abdibaset Bare, Nathaniel Mensah
+ * Version: 1.0
+ * 
+ * Description: all ids and counts live in two arrays shared by every
+ * term, so a frozen index is a handful of allocations however many
+ * terms it holds. The words are kept front coded in a term dictionary
+ * (see termdict.h) whose numbering is the order of the term table. A
+ * minimal perfect hash of the words (see mphash.h) gives the only term
+ * a query word can be, and decoding that term's word confirms it, so
+ * a lookup costs one hash and one compare. The position files of the
+ * segments are read back to back into one buffer and stay encoded;
+ * each document of a list only gets a pointer into it.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "qindex.h"
+#include "indexio.h"
+#include "segment.h"
+#include "posio.h"
+
+#define MAX_PATH_LEN 1024
+
+#define DENSE_FRACTION 16    // words in 1 of this many documents get a bitmap
+
+typedef struct qindex {
+	postings_t *terms;   // sorted by word
+	int nterms;
+	termdict_t *dict;    // the words; word i is that of terms[i]
+	mphash_t *mph;       // word to term number, may be NULL
+	int *ids;            // every term's ids, term after term
+	int *counts;
+	int *block_max;      // every term's block maxima, term after term
+	uint8_t *posbuf;     // the position files, NULL if the index has none
+	const uint8_t **positions;  // every term's position pointers
+} qi_t;
+
+/* entries of the hashtable being frozen */
+typedef struct collect {
+	entry_t **items;
+	int count;
+	size_t ndocs;        // postings of all words
+} collect_t;
+
+static void count_fn(void *elementp, void *arg){
+	(*(int*)arg)++;
+}
+
+static void collect_fn(void *elementp, void *arg){
+	entry_t *ep = (entry_t*)elementp;
+	collect_t *cp = (collect_t*)arg;
+	int df = 0;
+
+	qapply_arg(ep->documents, count_fn, &df);
+	cp->items[cp->count++] = ep;
+	cp->ndocs += df;
+}
+
+static int entry_comparator(const void *a, const void *b){
+	return strcmp((*(entry_t* const*)a)->word, (*(entry_t* const*)b)->word);
+}
+
+/* appends the documents of an entry to the postings being filled */
+static void fill_fn(void *elementp, void *arg){
+	document_t *dp = (document_t*)elementp;
+	postings_t *pp = (postings_t*)arg;
+	pp->ids[pp->df] = dp->id;
+	pp->counts[pp->df] = dp->word_count;
+	pp->df++;
+}
+
+static int document_comparator(const void *a, const void *b){
+	return ((const document_t*)a)->id - ((const document_t*)b)->id;
+}
+
+/* restores increasing id order in the postings of an unsorted index */
+static void sort_postings(postings_t *pp){
+	for (int i = 1; i < pp->df; i++){
+		if (pp->ids[i-1] < pp->ids[i])
+			continue;
+		document_t *docs = malloc(pp->df * sizeof(document_t));
+		if (docs == NULL)
+			return;
+		for (int j = 0; j < pp->df; j++){
+			docs[j].id = pp->ids[j];
+			docs[j].word_count = pp->counts[j];
+		}
+		qsort(docs, pp->df, sizeof(document_t), document_comparator);
+		for (int j = 0; j < pp->df; j++){
+			pp->ids[j] = docs[j].id;
+			pp->counts[j] = docs[j].word_count;
+		}
+		free(docs);
+		return;
+	}
+}
+
+qindex_t *qindexbuild(hashtable_t *index){
+	if (index == NULL)
+		return NULL;
+
+	int nentries = 0;
+	happly_arg(index, count_fn, &nentries);
+	collect_t c = { malloc((nentries ? nentries : 1) * sizeof(entry_t*)), 0, 0 };
+	qi_t *qi = calloc(1, sizeof(qi_t));
+	if (c.items == NULL || qi == NULL){
+		free(c.items);
+		free(qi);
+		return NULL;
+	}
+	happly_arg(index, collect_fn, &c);
+	qsort(c.items, c.count, sizeof(entry_t*), entry_comparator);
+
+	qi->nterms = c.count;
+	qi->terms = malloc((c.count ? c.count : 1) * sizeof(postings_t));
+	qi->ids = malloc((c.ndocs ? c.ndocs : 1) * sizeof(int));
+	qi->counts = malloc((c.ndocs ? c.ndocs : 1) * sizeof(int));
+	char **words = malloc((c.count ? c.count : 1) * sizeof(char*));
+	for (int i = 0; words != NULL && i < c.count; i++)
+		words[i] = c.items[i]->word;
+	qi->dict = words ? termdictbuild(words, c.count) : NULL;
+	qi->mph = words ? mphbuild(words, c.count) : NULL;
+	free(words);
+	if (qi->terms == NULL || qi->dict == NULL || qi->ids == NULL || qi->counts == NULL){
+		free(c.items);
+		qindexclose(qi);
+		return NULL;
+	}
+
+	size_t next = 0;
+	for (int i = 0; i < c.count; i++){
+		postings_t *pp = &qi->terms[i];
+		pp->ids = qi->ids + next;
+		pp->counts = qi->counts + next;
+		pp->df = 0;
+		qapply_arg(c.items[i]->documents, fill_fn, pp);
+		sort_postings(pp);
+		next += pp->df;
+	}
+	free(c.items);
+
+	/* score bounds of each list and of each of its blocks */
+	size_t nblocks = 0;
+	for (int i = 0; i < qi->nterms; i++)
+		nblocks += (qi->terms[i].df + CURSOR_BLOCK - 1) / CURSOR_BLOCK;
+	qi->block_max = calloc(nblocks ? nblocks : 1, sizeof(int));
+	if (qi->block_max == NULL){
+		qindexclose(qi);
+		return NULL;
+	}
+	next = 0;
+	for (int i = 0; i < qi->nterms; i++){
+		postings_t *pp = &qi->terms[i];
+		pp->block_max = qi->block_max + next;
+		pp->max_count = 0;
+		for (int j = 0; j < pp->df; j++){
+			if (pp->counts[j] > pp->block_max[j / CURSOR_BLOCK])
+				pp->block_max[j / CURSOR_BLOCK] = pp->counts[j];
+			if (pp->counts[j] > pp->max_count)
+				pp->max_count = pp->counts[j];
+		}
+		next += (pp->df + CURSOR_BLOCK - 1) / CURSOR_BLOCK;
+	}
+
+	/* bitmaps of the dense words, and their counts by document id so
+	 * that the documents of an intersection are ranked without walking
+	 * the lists */
+	int maxid = 0;
+	for (int i = 0; i < qi->nterms; i++){
+		postings_t *pp = &qi->terms[i];
+		if (pp->df > 0 && pp->ids[pp->df - 1] > maxid)
+			maxid = pp->ids[pp->df - 1];
+	}
+	for (int i = 0; i < qi->nterms; i++){
+		postings_t *pp = &qi->terms[i];
+		pp->bitmap = NULL;
+		pp->dense_counts = NULL;
+		pp->positions = NULL;
+		if (pp->df > 1 && (long)pp->df * DENSE_FRACTION >= maxid && pp->ids[0] >= 0){
+			pp->bitmap = roaringfrom(pp->ids, pp->df);
+			roaringoptimize(pp->bitmap);
+			if (pp->max_count <= UINT16_MAX)
+				pp->dense_counts = calloc(maxid + 1, sizeof(uint16_t));
+			for (int j = 0; pp->dense_counts && j < pp->df; j++)
+				pp->dense_counts[pp->ids[j]] = (uint16_t)pp->counts[j];
+		}
+	}
+	return (qindex_t*)qi;
+}
+
+/* reads the position files of every segment of indexnm, back to back
+ * returns: the buffer; NULL if a segment has no position file
+ */
+static uint8_t *read_positions(char *indexnm, size_t *len){
+	char path[MAX_PATH_LEN], posnm[MAX_PATH_LEN];
+	segment_t *sp;
+
+	queue_t *segments = manifestload(indexnm);
+	if (segments == NULL){
+		pos_path(indexnm, posnm, sizeof(posnm));
+		return posread(posnm, len);
+	}
+
+	uint8_t *buf = NULL;
+	bool complete = true;
+	*len = 0;
+	while ((sp = qget(segments))){
+		size_t seglen;
+		uint8_t *segbuf = NULL, *grown;
+		segment_path(indexnm, sp->name, path, sizeof(path));
+		pos_path(path, posnm, sizeof(posnm));
+		if (complete && (segbuf = posread(posnm, &seglen)) != NULL &&
+		    (grown = realloc(buf, *len + seglen + 1)) != NULL){
+			buf = grown;
+			memcpy(buf + *len, segbuf, seglen);
+			*len += seglen;
+		}
+		else {
+			complete = false;
+		}
+		free(segbuf);
+		free(sp->name);
+		free(sp);
+	}
+	qclose(segments);
+	if (!complete || buf == NULL){
+		free(buf);
+		return NULL;
+	}
+	return buf;
+}
+
+/* matches each document of a position file to its posting */
+typedef struct attach {
+	qi_t *qi;
+	const char *word;    // word of the current record
+	postings_t *pp;      // its term
+	int next;            // first posting of pp not yet matched
+	bool ok;
+} attach_t;
+
+static void attach_fn(const char *word, int id, int count, const uint8_t *positions, void *arg){
+	attach_t *ap = (attach_t*)arg;
+	if (!ap->ok)
+		return;
+	if (ap->word != word){
+		ap->word = word;
+		ap->pp = qindexfind(ap->qi, word);
+		ap->next = 0;
+	}
+	postings_t *pp = ap->pp;
+	if (pp == NULL){
+		ap->ok = false;
+		return;
+	}
+
+	/* the ids of a record increase, so search from the last match */
+	int lo = ap->next, hi = pp->df;
+	while (lo < hi){
+		int mid = lo + (hi - lo) / 2;
+		if (pp->ids[mid] < id)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == pp->df || pp->ids[lo] != id || pp->counts[lo] != count){
+		ap->ok = false;
+		return;
+	}
+	ap->qi->positions[pp->ids - ap->qi->ids + lo] = positions;
+	ap->next = lo + 1;
+}
+
+/* points every posting of qi at its positions; a position file that
+ * does not match the index (a stale one) is ignored */
+static void load_positions(qi_t *qi, char *indexnm){
+	size_t len = 0, ndocs = 0;
+	uint8_t *buf = read_positions(indexnm, &len);
+	if (buf == NULL)
+		return;
+	for (int i = 0; i < qi->nterms; i++)
+		ndocs += qi->terms[i].df;
+	qi->positions = calloc(ndocs ? ndocs : 1, sizeof(uint8_t*));
+	if (qi->positions == NULL){
+		free(buf);
+		return;
+	}
+
+	attach_t attach = { qi, NULL, NULL, 0, true };
+	bool ok = posscan(buf, len, attach_fn, &attach) == 0 && attach.ok;
+	for (size_t i = 0; ok && i < ndocs; i++)
+		ok = qi->positions[i] != NULL;
+	if (!ok){
+		printf("Ignoring positions of %s: they do not match the index\n", indexnm);
+		free(qi->positions);
+		qi->positions = NULL;
+		free(buf);
+		return;
+	}
+	qi->posbuf = buf;
+	for (int i = 0; i < qi->nterms; i++)
+		qi->terms[i].positions = qi->positions + (qi->terms[i].ids - qi->ids);
+}
+
+qindex_t *qindexload(char *indexnm){
+	hashtable_t *index = segmentsload(indexnm);
+	if (index == NULL)
+		return NULL;
+	qindex_t *qi = qindexbuild(index);
+	free_entries(index);
+	hclose(index);
+	if (qi != NULL)
+		load_positions((qi_t*)qi, indexnm);
+	return qi;
+}
+
+void qindexclose(qindex_t *qp){
+	if (qp == NULL)
+		return;
+	qi_t *qi = (qi_t*)qp;
+	for (int i = 0; qi->terms && qi->block_max && i < qi->nterms; i++){
+		roaringclose(qi->terms[i].bitmap);
+		free(qi->terms[i].dense_counts);
+	}
+	free(qi->terms);
+	termdictclose(qi->dict);
+	mphclose(qi->mph);
+	free(qi->ids);
+	free(qi->counts);
+	free(qi->block_max);
+	free(qi->posbuf);
+	free(qi->positions);
+	free(qi);
+}
+
+postings_t *qindexfind(qindex_t *qp, const char *word){
+	if (qp == NULL || word == NULL)
+		return NULL;
+	qi_t *qi = (qi_t*)qp;
+	if (qi->mph == NULL){
+		int i = termdictfind(qi->dict, word);
+		return i < 0 ? NULL : &qi->terms[i];
+	}
+
+	/* the only term the word can be, then one compare to be sure */
+	size_t len = strlen(word);
+	char buf[len + 1];
+	int i = mphlookup(qi->mph, word);
+	if (i < 0 || termdictword(qi->dict, i, buf, sizeof(buf)) != (int)len || strcmp(buf, word) != 0)
+		return NULL;
+	return &qi->terms[i];
+}
+
+int qindexprefix(qindex_t *qp, const char *prefix, postings_t **first){
+	if (qp == NULL || prefix == NULL)
+		return 0;
+	qi_t *qi = (qi_t*)qp;
+	int begin, count = termdictprefix(qi->dict, prefix, &begin);
+	*first = &qi->terms[begin];
+	return count;
+}
+
+int qindexword(qindex_t *qp, postings_t *pp, char *buf, size_t len){
+	if (qp == NULL || pp == NULL)
+		return -1;
+	qi_t *qi = (qi_t*)qp;
+	return termdictword(qi->dict, pp - qi->terms, buf, len);
+}
+
+bool qindexhaspositions(qindex_t *qp){
+	return qp != NULL && ((qi_t*)qp)->posbuf != NULL;
+}
+
+int qindexpositions(postings_t *pp, int i, int *positions){
+	if (pp == NULL || pp->positions == NULL || i < 0 || i >= pp->df)
+		return -1;
+	posdecode(pp->positions[i], pp->counts[i], positions);
+	return pp->counts[i];
+}
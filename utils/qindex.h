@@ -0,0 +1,84 @@
+#pragma once
+/* 
+ * qindex.h -- public interface to a read-only index for answering queries
+ * 
+ * Author: Ian Kamweru, Abdibaset Bare, Nathaniel Mensah
+ * Version: 1.0
+ * 
+ * Description: a loaded index (a hashtable of entry_t) is frozen into a
+ * table of terms sorted by word, whose words are kept in a front-coded
+ * dictionary (see termdict.h). The documents of each term are kept as
+ * two parallel arrays, ids in increasing order and the word's count in
+ * each, so that queries can size, intersect and skip through them
+ * without walking queues. Each list also carries the largest count in
+ * it and in each of its blocks of CURSOR_BLOCK postings, the score
+ * bounds that let ranked queries skip documents (see cursor.h). Words
+ * found in a large share of the documents also get a compressed bitmap
+ * (see roaring.h), so conjunctions of them run word-parallel, and a
+ * table of their counts by document id to rank what those find. The
+ * bitmaps and tables are built as the index is loaded. If the
+ * index was built with positions (see posio.h), each document of a
+ * list also points at the encoded positions of the word in it. A
+ * frozen index never changes, so any number of threads may read it at
+ * once.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include "hash.h"
+#include "cursor.h"
+#include "roaring.h"
+#include "termdict.h"
+#include "mphash.h"
+
+/* the documents containing one word */
+typedef struct postings {
+	int df;          // number of documents containing the word
+	int *ids;        // document ids, increasing
+	int *counts;     // count of the word in each document
+	int max_count;   // largest of the counts
+	int *block_max;  // largest count of each block of CURSOR_BLOCK postings
+	roaring_t *bitmap; // the ids, for dense words only; NULL otherwise
+	uint16_t *dense_counts; // count by document id, for dense words whose
+	                        // counts fit; NULL otherwise
+	const uint8_t **positions; // encoded positions in each document; NULL if none
+} postings_t;
+
+/* the index representation is hidden from users of the module */
+typedef void qindex_t;
+
+/* qindexbuild -- freezes index, which is left unchanged
+ * returns: non-NULL for success; NULL otherwise
+ */
+qindex_t *qindexbuild(hashtable_t *index);
+
+/* qindexload -- loads every segment of index indexnm and freezes it,
+ * with the positions of its words if every segment has a position file
+ * returns: non-NULL for success; NULL otherwise
+ */
+qindex_t *qindexload(char *indexnm);
+
+/* qindexclose -- frees a frozen index */
+void qindexclose(qindex_t *qi);
+
+/* qindexfind -- the postings of word; NULL if no document contains it */
+postings_t *qindexfind(qindex_t *qi, const char *word);
+
+/* qindexprefix -- the terms whose word starts with prefix; they are
+ * consecutive in word order, and *first is set to the first of them
+ * returns: the number of such terms
+ */
+int qindexprefix(qindex_t *qi, const char *prefix, postings_t **first);
+
+/* qindexword -- decodes the word of the term pp of qi into buf, of size len
+ * returns: the length of the word; -1 if it does not fit
+ */
+int qindexword(qindex_t *qi, postings_t *pp, char *buf, size_t len);
+
+/* qindexhaspositions -- whether the words of the index have positions */
+bool qindexhaspositions(qindex_t *qi);
+
+/* qindexpositions -- decodes the positions of the word of pp in its
+ * i-th document into positions, which has room for pp->counts[i]
+ * returns: the number of positions; -1 if the index has none
+ */
+int qindexpositions(postings_t *pp, int i, int *positions);
@@ -4,7 +4,12 @@
  * Author: Ian Kamweru, Abdibaset, Nathaniel Mensah
  * Version: 1.0
  * 
- * Description: implementation of Queue ADT
+ * Description: implementation of Queue ADT. The nodes of a queue are
+ * cut from slabs it owns, each twice the size of the one before up to
+ * MAX_SLAB nodes; nodes given back by qget and qremove go on a free
+ * list and are reused before the slabs are cut further. qclose frees
+ * the slabs whole rather than node by node. The wrapper and slabs of
+ * a queue opened in an arena come from the arena instead.
  */
 
 #include <stdio.h>
@@ -12,6 +17,10 @@
 #include <stdlib.h>
 #include <string.h>
 #include "queue.h"
+#include "arena.h"
+
+#define MIN_SLAB 1      // nodes in the first slab of a queue
+#define MAX_SLAB 1024   // nodes in a slab at most
 
 /* the queue representation is hidden from users of the module */
 typedef struct qelement {
@@ -19,11 +28,49 @@ typedef struct qelement {
 	struct qelement *next;
 }qelement_t;
 
+typedef struct qslab {
+	struct qslab *next;
+	int size;            // nodes in the slab
+	int used;            // nodes cut from it so far
+	qelement_t nodes[];
+}qslab_t;
+
 typedef struct queueWrapper {
     qelement_t *front;
     qelement_t *back;
+    qelement_t *free;    // nodes given back, linked through next
+    qslab_t *slabs;      // the slab being cut first
+    arena_t *arena;      // where the wrapper and slabs live; NULL for the heap
 }queueWrapper_t;
 
+/* a node from the free list, or else cut from the slabs */
+static qelement_t *node_alloc(queueWrapper_t *q){
+    qelement_t *qep = q->free;
+    if (qep != NULL){
+        q->free = qep->next;
+        return qep;
+    }
+    if (q->slabs == NULL || q->slabs->used == q->slabs->size){
+        int size = q->slabs ? 2 * q->slabs->size : MIN_SLAB;
+        if (size > MAX_SLAB)
+            size = MAX_SLAB;
+        size_t bytes = sizeof(qslab_t) + size * sizeof(qelement_t);
+        qslab_t *slab = q->arena ? arenaalloc(q->arena, bytes) : malloc(bytes);
+        if (slab == NULL)
+            return NULL;
+        slab->next = q->slabs;
+        slab->size = size;
+        slab->used = 0;
+        q->slabs = slab;
+    }
+    return &q->slabs->nodes[q->slabs->used++];
+}
+
+static void node_free(queueWrapper_t *q, qelement_t *qep){
+    qep->next = q->free;
+    q->free = qep;
+}
+
 /* initialize empty queue */
 queue_t* qopen(void){
     queueWrapper_t *qp = (queueWrapper_t*)malloc(sizeof(queueWrapper_t));
@@ -31,6 +78,22 @@ queue_t* qopen(void){
         return NULL;
     qp->front = NULL;
     qp->back = NULL;
+    qp->free = NULL;
+    qp->slabs = NULL;
+    qp->arena = NULL;
+    return (queue_t*)qp;
+}
+
+/* initialize empty queue in an arena */
+queue_t* qopen_arena(arena_t *arena){
+    queueWrapper_t *qp = (queueWrapper_t*)arenaalloc(arena, sizeof(queueWrapper_t));
+    if(qp == NULL)
+        return NULL;
+    qp->front = NULL;
+    qp->back = NULL;
+    qp->free = NULL;
+    qp->slabs = NULL;
+    qp->arena = arena;
     return (queue_t*)qp;
 }
 
@@ -39,16 +102,18 @@ void qclose(queue_t *qp) {
     if(qp==NULL)
         return;
     queueWrapper_t *q = (queueWrapper_t*) qp;
-    qelement_t *curr = q->front;
-    qelement_t *next;
-    while (curr != NULL) {
-        next = curr->next;
+    if (q->arena != NULL)
+        return;
+    qelement_t *curr;
+    for (curr = q->front; curr != NULL; curr = curr->next) {
         free(curr->element);
-        free(curr);
-        curr = next;
     }
-    q->front = NULL;
-    q->back = NULL;
+    qslab_t *slab = q->slabs, *next;
+    while (slab != NULL) {
+        next = slab->next;
+        free(slab);
+        slab = next;
+    }
     free(q); 
 }
 
@@ -57,7 +122,7 @@ void qclose(queue_t *qp) {
  */
 int32_t qput(queue_t *qp, void* elementp) {
     queueWrapper_t *q = (queueWrapper_t*)qp;
-    qelement_t *qep = (qelement_t*) malloc(sizeof(qelement_t));
+    qelement_t *qep = node_alloc(q);
     if (qep == NULL) {
         return -1;
     }
@@ -88,7 +153,7 @@ void* qget(queue_t *qp) {
     if(q->front == NULL){
         q->back = NULL;
     }
-    free(qep);
+    node_free(q, qep);
     return data;
 }
 
@@ -104,6 +169,18 @@ void qapply(queue_t *qp, void (*fn)(void* elementp)){
     }
 }
 
+/* apply a function to every element of the queue, passing arg along */
+void qapply_arg(queue_t *qp, void (*fn)(void* elementp, void* arg), void *arg){
+    if(qp == NULL){
+        return;
+    }
+    queueWrapper_t *q = (queueWrapper_t*)qp;
+    qelement_t *curr;
+    for(curr=q->front; curr!=NULL; curr=curr->next){
+        fn((void*)curr->element, arg);
+    }
+}
+
 /* search a queue using a supplied boolean function
  * skeyp -- a key to search for
  * searchfn -- a function applied to every element of the queue
@@ -149,8 +226,11 @@ void* qremove(queue_t *qp,bool (*searchfn)(void* element,const void* keyp),const
             } else {
                 prev->next = curr->next;
             }
+            if(q->back == curr) {
+                q->back = prev;
+            }
             data = curr->element;
-            free(curr);
+            node_free(q, curr);
             break;
         }
     }
@@ -166,6 +246,29 @@ void qconcat(queue_t *q1p, queue_t *q2p){
     }
     queueWrapper_t *q1 = (queueWrapper_t*)q1p;
     queueWrapper_t *q2 = (queueWrapper_t*)q2p;
+
+    /* the nodes of q2 move to q1, so its slabs and free nodes do too; 
+     * they go after the slab q1 is cutting */
+    if (q2->slabs != NULL){
+        qslab_t *last = q2->slabs;
+        while (last->next != NULL)
+            last = last->next;
+        if (q1->slabs == NULL){
+            q1->slabs = q2->slabs;
+        } else {
+            last->next = q1->slabs->next;
+            q1->slabs->next = q2->slabs;
+        }
+        q2->slabs = NULL;
+    }
+    if (q2->free != NULL){
+        qelement_t *last = q2->free;
+        while (last->next != NULL)
+            last = last->next;
+        last->next = q1->free;
+        q1->free = q2->free;
+        q2->free = NULL;
+    }
     
     if(q1->front==NULL){
         q1->front = q2->front;
@@ -4,6 +4,7 @@
  */
 #include <stdint.h>
 #include <stdbool.h>
+#include "arena.h"
 
 /* the queue representation is hidden from users of the module */
 typedef void queue_t;		
@@ -11,6 +12,12 @@ typedef void queue_t;
 /* create an empty queue */
 queue_t* qopen(void);        
 
+/* create an empty queue whose nodes come from arena (see arena.h);
+ * qclose does nothing to it: its nodes, and its elements, which are
+ * expected to live in the arena too, go when the arena is closed
+ */
+queue_t* qopen_arena(arena_t *arena);
+
 /* deallocate a queue, frees everything in it */
 void qclose(queue_t *qp);   
 
@@ -25,6 +32,9 @@ void* qget(queue_t *qp);
 /* apply a function to every element of the queue */
 void qapply(queue_t *qp, void (*fn)(void* elementp));
 
+/* apply a function to every element of the queue, passing arg along */
+void qapply_arg(queue_t *qp, void (*fn)(void* elementp, void* arg), void *arg);
+
 /* search a queue using a supplied boolean function
  * skeyp -- a key to search for
  * searchfn -- a function applied to every element of the queue
@@ -48,6 +58,8 @@ void* qremove(queue_t *qp,
 
 /* concatenatenates elements of q2 into q1
  * q2 is dealocated, closed, and unusable upon completion 
+ * q1 and q2 are both from qopen, or from qopen_arena with the same
+ * arena or arenas adopted by the same one (see arena.h)
  */
 void qconcat(queue_t *q1p, queue_t *q2p);
 
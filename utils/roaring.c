@@ -0,0 +1,517 @@
+/* 
+ * roaring.c -- compressed bitmaps of document ids
+ *
+ * Author: Ian Kamweru, Abdibaset Bare, Nathaniel Mensah
+ * Version: 1.0
+ * 
+ * Description: containers are kept sorted by key (the high 16 bits).
+ * Arrays hold at most ARRAY_MAX low halves, beyond which a bitmap is
+ * smaller. Operations between arrays merge them; an array against any
+ * other container probes it; anything else is expanded to bitmaps and
+ * combined word by word by a kernel chosen once from the processor's
+ * features. Results are converted back to arrays when they thin out.
+ */
+
+#define _POSIX_C_SOURCE 200809L    // pthread_once
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "roaring.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86 1
+#endif
+
+#define ARRAY_MAX 4096          // largest array container
+#define BITMAP_WORDS 1024       // 65536 bits
+#define SCRATCH_WORDS (3 * BITMAP_WORDS)    // two operands and a result
+
+typedef enum { OP_AND, OP_OR, OP_ANDNOT } op_t;
+typedef enum { C_ARRAY, C_BITMAP, C_RUN } ctype_t;
+
+typedef struct container {
+	uint16_t key;       // high 16 bits of the ids
+	ctype_t type;
+	int card;           // number of ids
+	int len;            // C_ARRAY: values; C_RUN: runs
+	uint16_t *values;   // C_ARRAY: low halves, increasing;
+	                    // C_RUN: start and length-1 of each run
+	uint64_t *bits;     // C_BITMAP
+} container_t;
+
+typedef struct roaring {
+	container_t *cs;    // by increasing key
+	int n;
+	int size;
+} ro_t;
+
+/****************************** kernels *************************************/
+
+/* combines two bitmaps word by word into out; returns the bits set */
+typedef int (*kernel_t)(uint64_t *out, const uint64_t *a, const uint64_t *b, op_t op);
+
+static int kernel_scalar(uint64_t *out, const uint64_t *a, const uint64_t *b, op_t op){
+	int card = 0;
+	for (int i = 0; i < BITMAP_WORDS; i++){
+		out[i] = op == OP_AND ? a[i] & b[i] : op == OP_OR ? a[i] | b[i] : a[i] & ~b[i];
+		card += __builtin_popcountll(out[i]);
+	}
+	return card;
+}
+
+#ifdef HAVE_X86
+static int kernel_sse2(uint64_t *out, const uint64_t *a, const uint64_t *b, op_t op){
+	int card = 0;
+	for (int i = 0; i < BITMAP_WORDS; i += 2){
+		__m128i x = _mm_loadu_si128((const __m128i*)(a + i));
+		__m128i y = _mm_loadu_si128((const __m128i*)(b + i));
+		__m128i r = op == OP_AND ? _mm_and_si128(x, y) : op == OP_OR ? _mm_or_si128(x, y) : _mm_andnot_si128(y, x);
+		_mm_storeu_si128((__m128i*)(out + i), r);
+		card += __builtin_popcountll(out[i]) + __builtin_popcountll(out[i+1]);
+	}
+	return card;
+}
+
+__attribute__((target("avx2,popcnt")))
+static int kernel_avx2(uint64_t *out, const uint64_t *a, const uint64_t *b, op_t op){
+	int card = 0;
+	for (int i = 0; i < BITMAP_WORDS; i += 4){
+		__m256i x = _mm256_loadu_si256((const __m256i*)(a + i));
+		__m256i y = _mm256_loadu_si256((const __m256i*)(b + i));
+		__m256i r = op == OP_AND ? _mm256_and_si256(x, y) : op == OP_OR ? _mm256_or_si256(x, y) : _mm256_andnot_si256(y, x);
+		_mm256_storeu_si256((__m256i*)(out + i), r);
+		card += __builtin_popcountll(out[i]) + __builtin_popcountll(out[i+1]) +
+		        __builtin_popcountll(out[i+2]) + __builtin_popcountll(out[i+3]);
+	}
+	return card;
+}
+#endif
+
+static kernel_t kernel = kernel_scalar;
+static pthread_once_t kernel_once = PTHREAD_ONCE_INIT;
+
+static void choose_kernel(void){
+#ifdef HAVE_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt"))
+		kernel = kernel_avx2;
+	else if (__builtin_cpu_supports("sse2"))
+		kernel = kernel_sse2;
+#endif
+}
+
+/**************************** containers ************************************/
+
+static void free_container(container_t *c){
+	free(c->values);
+	free(c->bits);
+	c->values = NULL;
+	c->bits = NULL;
+}
+
+/* expands any container into a bitmap of BITMAP_WORDS words */
+static void to_bits(container_t *c, uint64_t *bits){
+	if (c->type == C_BITMAP){
+		memcpy(bits, c->bits, BITMAP_WORDS * sizeof(uint64_t));
+		return;
+	}
+	memset(bits, 0, BITMAP_WORDS * sizeof(uint64_t));
+	if (c->type == C_ARRAY){
+		for (int i = 0; i < c->len; i++)
+			bits[c->values[i] >> 6] |= (uint64_t)1 << (c->values[i] & 63);
+		return;
+	}
+	for (int r = 0; r < c->len; r++){
+		int start = c->values[2*r], end = start + c->values[2*r+1];
+		for (int v = start; v <= end; v++)
+			bits[v >> 6] |= (uint64_t)1 << (v & 63);
+	}
+}
+
+/* makes c hold a copy of the card bits set in bits
+ * returns: true for success; false otherwise
+ */
+static bool from_bits(container_t *c, const uint64_t *bits, int card){
+	c->card = card;
+	if (card > ARRAY_MAX){
+		c->type = C_BITMAP;
+		c->len = 0;
+		c->bits = malloc(BITMAP_WORDS * sizeof(uint64_t));
+		if (c->bits == NULL)
+			return false;
+		memcpy(c->bits, bits, BITMAP_WORDS * sizeof(uint64_t));
+		return true;
+	}
+	c->type = C_ARRAY;
+	c->values = malloc((card ? card : 1) * sizeof(uint16_t));
+	c->len = 0;
+	for (int w = 0; w < BITMAP_WORDS && c->values; w++){
+		for (uint64_t word = bits[w]; word; word &= word - 1)
+			c->values[c->len++] = (uint16_t)(w * 64 + __builtin_ctzll(word));
+	}
+	return c->values != NULL;
+}
+
+static bool container_contains(container_t *c, uint16_t v){
+	int lo = 0, hi;
+	switch (c->type){
+	case C_BITMAP:
+		return (c->bits[v >> 6] >> (v & 63)) & 1;
+	case C_ARRAY:
+		hi = c->len;
+		while (lo < hi){
+			int mid = (lo + hi) / 2;
+			if (c->values[mid] < v)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		return lo < c->len && c->values[lo] == v;
+	case C_RUN:
+		/* the last run starting at or before v */
+		hi = c->len;
+		while (lo < hi){
+			int mid = (lo + hi) / 2;
+			if (c->values[2*mid] <= v)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		return lo > 0 && v <= c->values[2*(lo-1)] + c->values[2*(lo-1)+1];
+	}
+	return false;
+}
+
+static bool copy_container(container_t *dst, container_t *src){
+	*dst = *src;
+	dst->values = NULL;
+	dst->bits = NULL;
+	if (src->values){
+		int n = src->type == C_RUN ? 2 * src->len : src->len;
+		dst->values = malloc((n ? n : 1) * sizeof(uint16_t));
+		if (dst->values == NULL)
+			return false;
+		memcpy(dst->values, src->values, n * sizeof(uint16_t));
+	}
+	if (src->bits){
+		dst->bits = malloc(BITMAP_WORDS * sizeof(uint64_t));
+		if (dst->bits == NULL)
+			return false;
+		memcpy(dst->bits, src->bits, BITMAP_WORDS * sizeof(uint64_t));
+	}
+	return true;
+}
+
+/* combines two containers with the same key into out, using scratch
+ * (SCRATCH_WORDS words) to expand them */
+static bool combine(container_t *out, container_t *a, container_t *b, op_t op, uint64_t *scratch){
+	out->key = a->key;
+
+	/* an array keeps its own values or drops some */
+	if (a->type == C_ARRAY && (op == OP_ANDNOT || (op == OP_AND && b->type != C_ARRAY))){
+		out->type = C_ARRAY;
+		out->values = malloc((a->len ? a->len : 1) * sizeof(uint16_t));
+		if (out->values == NULL)
+			return false;
+		out->len = 0;
+		for (int i = 0; i < a->len; i++){
+			if (container_contains(b, a->values[i]) == (op == OP_AND))
+				out->values[out->len++] = a->values[i];
+		}
+		out->card = out->len;
+		return true;
+	}
+	if (op == OP_AND && b->type == C_ARRAY && a->type != C_ARRAY)
+		return combine(out, b, a, op, scratch);
+
+	/* two arrays merge when the result is an array */
+	if (a->type == C_ARRAY && b->type == C_ARRAY && (op == OP_AND || a->len + b->len <= ARRAY_MAX)){
+		out->type = C_ARRAY;
+		out->values = malloc((a->len + b->len + 1) * sizeof(uint16_t));
+		if (out->values == NULL)
+			return false;
+		int i = 0, j = 0, n = 0;
+		while (i < a->len && j < b->len){
+			if (a->values[i] < b->values[j]){
+				if (op == OP_OR)
+					out->values[n++] = a->values[i];
+				i++;
+			}
+			else if (a->values[i] > b->values[j]){
+				if (op == OP_OR)
+					out->values[n++] = b->values[j];
+				j++;
+			}
+			else {
+				out->values[n++] = a->values[i];
+				i++, j++;
+			}
+		}
+		for (; op == OP_OR && i < a->len; i++)
+			out->values[n++] = a->values[i];
+		for (; op == OP_OR && j < b->len; j++)
+			out->values[n++] = b->values[j];
+		out->len = out->card = n;
+		return true;
+	}
+
+	/* otherwise a word at a time; bitmaps are read in place */
+	uint64_t *x = a->bits, *y = b->bits, *r = scratch + 2 * BITMAP_WORDS;
+	if (a->type != C_BITMAP)
+		to_bits(a, x = scratch);
+	if (b->type != C_BITMAP)
+		to_bits(b, y = scratch + BITMAP_WORDS);
+	pthread_once(&kernel_once, choose_kernel);
+	return from_bits(out, r, kernel(r, x, y, op));
+}
+
+/***************************** bitmaps **************************************/
+
+static container_t *push(ro_t *r){
+	if (r->n == r->size){
+		int size = r->size ? 2 * r->size : 8;
+		container_t *cs = realloc(r->cs, size * sizeof(container_t));
+		if (cs == NULL)
+			return NULL;
+		r->cs = cs;
+		r->size = size;
+	}
+	container_t *c = &r->cs[r->n++];
+	memset(c, 0, sizeof(container_t));
+	return c;
+}
+
+roaring_t *roaringfrom(const int *ids, int n){
+	ro_t *r = calloc(1, sizeof(ro_t));
+	if (r == NULL)
+		return NULL;
+
+	for (int i = 0; i < n; ){
+		int key = ids[i] >> 16, j = i;
+		while (j < n && ids[j] >> 16 == key)
+			j++;
+		container_t *c = push(r);
+		if (c == NULL){
+			roaringclose(r);
+			return NULL;
+		}
+		c->key = (uint16_t)key;
+		c->card = j - i;
+		if (c->card > ARRAY_MAX){
+			c->type = C_BITMAP;
+			c->bits = calloc(BITMAP_WORDS, sizeof(uint64_t));
+			for (int k = i; k < j && c->bits; k++)
+				c->bits[(ids[k] & 0xffff) >> 6] |= (uint64_t)1 << (ids[k] & 63);
+		}
+		else {
+			c->type = C_ARRAY;
+			c->len = c->card;
+			c->values = malloc(c->len * sizeof(uint16_t));
+			for (int k = i; k < j && c->values; k++)
+				c->values[k - i] = (uint16_t)(ids[k] & 0xffff);
+		}
+		if (c->bits == NULL && c->values == NULL){
+			roaringclose(r);
+			return NULL;
+		}
+		i = j;
+	}
+	return (roaring_t*)r;
+}
+
+void roaringclose(roaring_t *rp){
+	ro_t *r = (ro_t*)rp;
+	if (r == NULL)
+		return;
+	for (int i = 0; i < r->n; i++)
+		free_container(&r->cs[i]);
+	free(r->cs);
+	free(r);
+}
+
+/* combines two bitmaps, key by key, expanding containers in scratch */
+static roaring_t *roaring_op(roaring_t *ap, roaring_t *bp, op_t op, uint64_t *scratch){
+	ro_t *a = (ro_t*)ap, *b = (ro_t*)bp;
+	if (a == NULL || b == NULL || scratch == NULL)
+		return NULL;
+	ro_t *r = calloc(1, sizeof(ro_t));
+	if (r == NULL)
+		return NULL;
+
+	int i = 0, j = 0;
+	bool ok = true;
+	while (ok && (i < a->n || (op == OP_OR && j < b->n))){
+		container_t *c = NULL;
+		if (j == b->n || (i < a->n && a->cs[i].key < b->cs[j].key)){
+			if (op != OP_AND && (ok = (c = push(r)) != NULL))
+				ok = copy_container(c, &a->cs[i]);
+			i++;
+		}
+		else if (i == a->n || b->cs[j].key < a->cs[i].key){
+			if (op == OP_OR && (ok = (c = push(r)) != NULL))
+				ok = copy_container(c, &b->cs[j]);
+			j++;
+		}
+		else {
+			if ((ok = (c = push(r)) != NULL))
+				ok = combine(c, &a->cs[i], &b->cs[j], op, scratch);
+			i++, j++;
+		}
+		/* empty results take no container */
+		if (ok && c != NULL && c->card == 0){
+			free_container(c);
+			r->n--;
+		}
+	}
+	if (!ok){
+		roaringclose(r);
+		return NULL;
+	}
+	return (roaring_t*)r;
+}
+
+static roaring_t *roaring_op1(roaring_t *a, roaring_t *b, op_t op){
+	uint64_t *scratch = malloc(SCRATCH_WORDS * sizeof(uint64_t));
+	roaring_t *r = roaring_op(a, b, op, scratch);
+	free(scratch);
+	return r;
+}
+
+roaring_t *roaringand(roaring_t *a, roaring_t *b){
+	return roaring_op1(a, b, OP_AND);
+}
+
+roaring_t *roaringor(roaring_t *a, roaring_t *b){
+	return roaring_op1(a, b, OP_OR);
+}
+
+roaring_t *roaringandnot(roaring_t *a, roaring_t *b){
+	return roaring_op1(a, b, OP_ANDNOT);
+}
+
+roaring_t *roaringandall(roaring_t **sets, int n){
+	if (sets == NULL || n < 2)
+		return NULL;
+	uint64_t *scratch = malloc(SCRATCH_WORDS * sizeof(uint64_t));
+	roaring_t *r = roaring_op(sets[0], sets[1], OP_AND, scratch), *next;
+	for (int i = 2; i < n && r != NULL && roaringcount(r) > 0; i++){
+		next = roaring_op(r, sets[i], OP_AND, scratch);
+		roaringclose(r);
+		r = next;
+	}
+	free(scratch);
+	return r;
+}
+
+void roaringoptimize(roaring_t *rp){
+	ro_t *r = (ro_t*)rp;
+	uint64_t *bits = malloc(BITMAP_WORDS * sizeof(uint64_t));
+	if (r == NULL || bits == NULL){
+		free(bits);
+		return;
+	}
+	for (int i = 0; i < r->n; i++){
+		container_t *c = &r->cs[i];
+		if (c->type == C_RUN)
+			continue;
+		to_bits(c, bits);
+
+		/* a run starts at every set bit whose predecessor is clear */
+		int nruns = 0;
+		for (int w = 0; w < BITMAP_WORDS; w++){
+			uint64_t prev = w ? bits[w-1] >> 63 : 0;
+			nruns += __builtin_popcountll(bits[w] & ~((bits[w] << 1) | prev));
+		}
+		size_t current = c->type == C_ARRAY ? c->len * sizeof(uint16_t) : BITMAP_WORDS * sizeof(uint64_t);
+		if (2 * nruns * sizeof(uint16_t) >= current)
+			continue;
+
+		uint16_t *runs = malloc(2 * nruns * sizeof(uint16_t));
+		if (runs == NULL)
+			continue;
+		int n = 0;
+		for (int v = 0; v < 65536; v++){
+			if (!((bits[v >> 6] >> (v & 63)) & 1))
+				continue;
+			int start = v;
+			while (v + 1 < 65536 && ((bits[(v+1) >> 6] >> ((v+1) & 63)) & 1))
+				v++;
+			runs[2*n] = (uint16_t)start;
+			runs[2*n+1] = (uint16_t)(v - start);
+			n++;
+		}
+		free_container(c);
+		c->type = C_RUN;
+		c->values = runs;
+		c->len = n;
+	}
+	free(bits);
+}
+
+int roaringcount(roaring_t *rp){
+	ro_t *r = (ro_t*)rp;
+	int count = 0;
+	for (int i = 0; r && i < r->n; i++)
+		count += r->cs[i].card;
+	return count;
+}
+
+bool roaringcontains(roaring_t *rp, int id){
+	ro_t *r = (ro_t*)rp;
+	if (r == NULL || id < 0)
+		return false;
+	int lo = 0, hi = r->n;
+	uint16_t key = (uint16_t)(id >> 16);
+	while (lo < hi){
+		int mid = (lo + hi) / 2;
+		if (r->cs[mid].key < key)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo < r->n && r->cs[lo].key == key && container_contains(&r->cs[lo], (uint16_t)(id & 0xffff));
+}
+
+int roaringtoarray(roaring_t *rp, int *ids){
+	ro_t *r = (ro_t*)rp;
+	int n = 0;
+	for (int i = 0; r && i < r->n; i++){
+		container_t *c = &r->cs[i];
+		int high = c->key << 16;
+		switch (c->type){
+		case C_ARRAY:
+			for (int k = 0; k < c->len; k++)
+				ids[n++] = high | c->values[k];
+			break;
+		case C_BITMAP:
+			for (int w = 0; w < BITMAP_WORDS; w++){
+				for (uint64_t word = c->bits[w]; word; word &= word - 1)
+					ids[n++] = high | (w * 64 + __builtin_ctzll(word));
+			}
+			break;
+		case C_RUN:
+			for (int k = 0; k < c->len; k++){
+				for (int v = c->values[2*k]; v <= c->values[2*k] + c->values[2*k+1]; v++)
+					ids[n++] = high | v;
+			}
+			break;
+		}
+	}
+	return n;
+}
+
+size_t roaringbytes(roaring_t *rp){
+	ro_t *r = (ro_t*)rp;
+	size_t bytes = 0;
+	for (int i = 0; r && i < r->n; i++){
+		container_t *c = &r->cs[i];
+		bytes += sizeof(container_t);
+		if (c->type == C_BITMAP)
+			bytes += BITMAP_WORDS * sizeof(uint64_t);
+		else
+			bytes += (c->type == C_RUN ? 2 * c->len : c->len) * sizeof(uint16_t);
+	}
+	return bytes;
+}
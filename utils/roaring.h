@@ -0,0 +1,60 @@
+#pragma once
+/* 
+ * roaring.h -- public interface to compressed bitmaps of document ids
+ * 
+ * Author: Ian Kamweru, Abdibaset Bare, Nathaniel Mensah
+ * Version: 1.0
+ * 
+ * Description: a set of non-negative ids split, as in Roaring bitmaps,
+ * into chunks of 65536 ids sharing their high 16 bits. Each chunk is
+ * held in whichever container is smallest for it: a sorted array of
+ * low halves (sparse chunks), a 65536-bit bitmap (dense chunks) or a
+ * list of runs (clustered chunks). Set operations work container by
+ * container; bitmap against bitmap runs a word at a time, with SSE2 or
+ * AVX2 when the processor has them.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* the bitmap representation is hidden from users of the module */
+typedef void roaring_t;
+
+/* roaringfrom -- builds the set of the n increasing ids
+ * returns: non-NULL for success; NULL otherwise
+ */
+roaring_t *roaringfrom(const int *ids, int n);
+
+/* roaringclose -- frees a set */
+void roaringclose(roaring_t *rp);
+
+/* roaringand, roaringor, roaringandnot -- a new set holding the ids in
+ * both a and b, in either, or in a but not b
+ */
+roaring_t *roaringand(roaring_t *a, roaring_t *b);
+roaring_t *roaringor(roaring_t *a, roaring_t *b);
+roaring_t *roaringandnot(roaring_t *a, roaring_t *b);
+
+/* roaringandall -- a new set holding the ids in every one of the n >= 2
+ * sets; the sets are combined in order with one scratch buffer, and
+ * the rest are skipped once the result is empty
+ */
+roaring_t *roaringandall(roaring_t **sets, int n);
+
+/* roaringoptimize -- converts containers to runs where runs are smaller */
+void roaringoptimize(roaring_t *rp);
+
+/* roaringcount -- the number of ids in the set */
+int roaringcount(roaring_t *rp);
+
+/* roaringcontains -- whether id is in the set */
+bool roaringcontains(roaring_t *rp, int id);
+
+/* roaringtoarray -- writes the ids in increasing order to ids, which
+ * must have room for roaringcount of them
+ * returns: the number of ids written
+ */
+int roaringtoarray(roaring_t *rp, int *ids);
+
+/* roaringbytes -- the memory held by the containers of the set */
+size_t roaringbytes(roaring_t *rp);
@@ -0,0 +1,132 @@
+/* segment.c --- immutable index segments and the manifest that lists them
+ *
+ * Author: Ian Kamweru, Abdibaset Bare, Nathaniel Mensah
+ * Version: 1.0
+ *
+ * Description: reads and appends to the manifest <indexnm>.manifest
+ * and loads every segment it lists into a single in-memory index.
+ * Segments cover disjoint, increasing ranges of document ids, so
+ * loading them oldest first keeps each word's documents in id order.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "segment.h"
+#include "indexio.h"
+
+#define MAX_PATH_LEN 1024
+
+/* builds the manifest file name of index indexnm */
+static void manifest_path(char *indexnm, char *buf, size_t len){
+	snprintf(buf, len, "%s.manifest", indexnm);
+}
+
+/*
+ * manifestload -- loads the manifest of index indexnm
+ * returns: a queue of segment_t; NULL if there is no manifest
+ */
+queue_t *manifestload(char *indexnm){
+	char path[MAX_PATH_LEN];
+	char name[MAX_PATH_LEN];
+	int first_id, last_id;
+
+	manifest_path(indexnm, path, sizeof(path));
+	FILE *file = fopen(path, "r");
+	if (file == NULL)
+		return NULL;
+
+	queue_t *segments = qopen();
+	while (fscanf(file, "%1023s %d %d", name, &first_id, &last_id) == 3){
+		segment_t *sp = malloc(sizeof(segment_t));
+		if (sp == NULL)
+			break;
+		sp->name = malloc(strlen(name)+1);
+		strcpy(sp->name, name);
+		sp->first_id = first_id;
+		sp->last_id = last_id;
+		qput(segments, sp);
+	}
+
+	fclose(file);
+	return segments;
+}
+
+/*
+ * manifestappend -- appends a segment line to the manifest of indexnm
+ * returns: 0 for success; nonzero otherwise
+ */
+int32_t manifestappend(char *indexnm, char *segnm, int first_id, int last_id){
+	char path[MAX_PATH_LEN];
+
+	manifest_path(indexnm, path, sizeof(path));
+	FILE *file = fopen(path, "a");
+	if (file == NULL){
+		printf("Failed to open manifest: %s\n", path);
+		return 1;
+	}
+
+	/* segment names are stored relative to the index directory */
+	char *base = strrchr(segnm, '/');
+	fprintf(file, "%s %d %d\n", base ? base+1 : segnm, first_id, last_id);
+	fclose(file);
+	return 0;
+}
+
+/* highest document id in any segment of the manifest */
+int manifest_lastid(queue_t *segments){
+	segment_t *sp;
+	int last_id = 0;
+	queue_t *tmp = qopen();
+
+	while ((sp = qget(segments))){
+		if (sp->last_id > last_id)
+			last_id = sp->last_id;
+		qput(tmp, sp);
+	}
+	while ((sp = qget(tmp)))
+		qput(segments, sp);
+	qclose(tmp);
+	return last_id;
+}
+
+/* builds the path of segment segnm, relative to the directory of indexnm */
+void segment_path(char *indexnm, char *segnm, char *buf, size_t len){
+	char *slash = strrchr(indexnm, '/');
+	if (slash == NULL)
+		snprintf(buf, len, "%s", segnm);
+	else
+		snprintf(buf, len, "%.*s/%s", (int)(slash - indexnm), indexnm, segnm);
+}
+
+/*
+ * segmentsload -- loads every segment of index indexnm into one hashtable
+ * returns: non-NULL for success; NULL otherwise
+ */
+hashtable_t *segmentsload(char *indexnm){
+	char path[MAX_PATH_LEN];
+	segment_t *sp;
+
+	queue_t *segments = manifestload(indexnm);
+	if (segments == NULL)
+		return indexload(indexnm);
+
+	hashtable_t *index = NULL;
+	indexloader_t *loader = NULL;
+	while ((sp = qget(segments))){
+		segment_path(indexnm, sp->name, path, sizeof(path));
+		if (index == NULL){
+			if ((index = indexload(path)) != NULL)
+				loader = indexloaderopen(index);
+		}
+		else if (indexloaderappend(loader, path) != 0)
+			printf("Failed to load segment: %s\n", path);
+		if (index == NULL)
+			printf("Failed to load segment: %s\n", path);
+		free(sp->name);
+		free(sp);
+	}
+	indexloaderclose(loader);
+	qclose(segments);
+	return index;
+}
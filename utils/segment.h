@@ -0,0 +1,72 @@
+#pragma once
+/* 
+ * segment.h --- immutable index segments and the manifest that lists them
+ * 
+ * Author: Ian Kamweru, Abdibaset Bare, Nathaniel Mensah
+ * Version: 1.0
+ * 
+ * Description: an index is stored as one or more immutable segment
+ * files, each in the indexio format and each covering a disjoint,
+ * increasing range of document ids. The manifest <indexnm>.manifest
+ * lists the segments oldest first, one per line:
+ *   <segment-file> <first-id> <last-id>
+ * Segment file names are relative to the directory of <indexnm>. New
+ * pages are indexed into a new segment that is appended to the
+ * manifest; existing segments are never rewritten.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "hash.h"
+#include "queue.h"
+
+/* segment struct
+ *
+ * @param name - segment file name, relative to the index directory
+ * @param first_id - lowest document id indexed in the segment
+ * @param last_id - highest document id indexed in the segment
+ */
+typedef struct segment {
+	char *name;
+	int first_id;
+	int last_id;
+} segment_t;
+
+/* 
+ * manifestload -- loads the manifest of index indexnm
+ *
+ * returns: a queue of segment_t, oldest first; NULL if the index has
+ * no manifest (a plain single-file index)
+ */
+queue_t *manifestload(char *indexnm);
+
+/*
+ * manifestappend -- appends segment segnm covering ids
+ * [first_id, last_id] to the manifest of indexnm, creating the
+ * manifest if needed
+ *
+ * returns: 0 for success; nonzero otherwise
+ */
+int32_t manifestappend(char *indexnm, char *segnm, int first_id, int last_id);
+
+/*
+ * manifest_lastid -- highest document id in any segment of the
+ * manifest, or 0 if the manifest is empty
+ */
+int manifest_lastid(queue_t *segments);
+
+/*
+ * segment_path -- builds the path of segment segnm of index indexnm
+ * into buf (of size len)
+ */
+void segment_path(char *indexnm, char *segnm, char *buf, size_t len);
+
+/*
+ * segmentsload -- loads every segment of index indexnm into one
+ * hashtable; an index without a manifest is loaded with indexload()
+ *
+ * returns: non-NULL for success; NULL otherwise
+ *
+ * the user is responsible for freeing the hash table
+ */
+hashtable_t *segmentsload(char *indexnm);
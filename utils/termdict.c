@@ -0,0 +1,194 @@
+/*
+ * termdict.c -- a front-coded term dictionary
+ *
+ * Author: Ian Kamweru, Abdibaset Bare, Nathaniel Mensah
+ * Version: 1.0
+ *
+ * Description: all blocks live back to back in one buffer. A block is
+ * its first word, NUL terminated, then for each following word the
+ * number of letters it shares with the word before (a varint) and
+ * its remaining letters, NUL terminated. Sorted words share long
+ * prefixes, so most words cost a few bytes instead of a whole string
+ * and a pointer.
+ */
+
+#include <string.h>
+#include <stdbool.h>
+#include "termdict.h"
+
+typedef struct td {
+	int nwords;
+	int nblocks;
+	size_t maxlen;       // length of the longest word
+	uint8_t *data;       // the blocks
+	size_t size;
+	size_t *blocks;      // offset of each block in data
+} td_t;
+
+static size_t put_varint(uint8_t *p, size_t value){
+	size_t n = 0;
+	while (value >= 0x80){
+		p[n++] = (value & 0x7f) | 0x80;
+		value >>= 7;
+	}
+	p[n++] = value;
+	return n;
+}
+
+static const uint8_t *get_varint(const uint8_t *p, size_t *value){
+	size_t v = 0;
+	int shift = 0;
+	while (*p >= 0x80){
+		v |= (size_t)(*p++ & 0x7f) << shift;
+		shift += 7;
+	}
+	*value = v | (size_t)*p++ << shift;
+	return p;
+}
+
+termdict_t *termdictbuild(char **words, int n){
+	td_t *td = calloc(1, sizeof(td_t));
+	if (td == NULL)
+		return NULL;
+	td->nwords = n;
+	td->nblocks = (n + TERMDICT_BLOCK - 1) / TERMDICT_BLOCK;
+
+	/* a varint and a terminator at most, on top of the letters */
+	size_t bound = 1;
+	for (int i = 0; i < n; i++){
+		size_t len = strlen(words[i]);
+		bound += len + 11;
+		if (len > td->maxlen)
+			td->maxlen = len;
+	}
+	td->data = malloc(bound);
+	td->blocks = malloc((td->nblocks ? td->nblocks : 1) * sizeof(size_t));
+	if (td->data == NULL || td->blocks == NULL){
+		termdictclose(td);
+		return NULL;
+	}
+
+	size_t at = 0;
+	for (int i = 0; i < n; i++){
+		const char *suffix = words[i];
+		if (i % TERMDICT_BLOCK == 0){
+			td->blocks[i / TERMDICT_BLOCK] = at;
+		}
+		else {
+			size_t shared = 0;
+			while (words[i][shared] != '\0' && words[i][shared] == words[i-1][shared])
+				shared++;
+			at += put_varint(td->data + at, shared);
+			suffix += shared;
+		}
+		size_t len = strlen(suffix) + 1;
+		memcpy(td->data + at, suffix, len);
+		at += len;
+	}
+
+	/* give back the slack of the bound */
+	uint8_t *data = realloc(td->data, at ? at : 1);
+	if (data != NULL)
+		td->data = data;
+	td->size = at;
+	return (termdict_t*)td;
+}
+
+void termdictclose(termdict_t *tp){
+	if (tp == NULL)
+		return;
+	td_t *td = (td_t*)tp;
+	free(td->data);
+	free(td->blocks);
+	free(td);
+}
+
+/* whether a word sorts before key, comparing len letters at most; with
+ * after, words equal to key on those letters count as before it too */
+static inline bool before(const char *word, const char *key, size_t len, bool after){
+	int cmp = strncmp(word, key, len);
+	return cmp < 0 || (after && cmp == 0);
+}
+
+/* the number of words that come before key (see before) */
+static int rank(td_t *td, const char *key, size_t len, bool after){
+	/* the last block whose first word comes before key */
+	int lo = 0, hi = td->nblocks;
+	while (lo < hi){
+		int mid = lo + (hi - lo) / 2;
+		if (before((const char*)td->data + td->blocks[mid], key, len, after))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == 0)
+		return 0;
+	int block = lo - 1;
+
+	/* the words of that block that come before key */
+	char word[td->maxlen + 1];
+	const uint8_t *p = td->data + td->blocks[block];
+	int first = block * TERMDICT_BLOCK, count = 0;
+	int last = first + TERMDICT_BLOCK < td->nwords ? first + TERMDICT_BLOCK : td->nwords;
+	for (int i = first; i < last; i++){
+		size_t shared = 0;
+		if (i > first)
+			p = get_varint(p, &shared);
+		size_t suffix = strlen((const char*)p);
+		memcpy(word + shared, p, suffix + 1);
+		p += suffix + 1;
+		if (!before(word, key, len, after))
+			break;
+		count++;
+	}
+	return first + count;
+}
+
+int termdictfind(termdict_t *tp, const char *word){
+	if (tp == NULL || word == NULL)
+		return -1;
+	td_t *td = (td_t*)tp;
+	size_t len = strlen(word) + 1;    // the terminator too: a whole match
+	int i = rank(td, word, len, false);
+	return rank(td, word, len, true) > i ? i : -1;
+}
+
+int termdictprefix(termdict_t *tp, const char *prefix, int *first){
+	if (tp == NULL || prefix == NULL)
+		return 0;
+	td_t *td = (td_t*)tp;
+	size_t len = strlen(prefix);
+	*first = rank(td, prefix, len, false);
+	return rank(td, prefix, len, true) - *first;
+}
+
+int termdictword(termdict_t *tp, int i, char *buf, size_t len){
+	td_t *td = (td_t*)tp;
+	if (td == NULL || i < 0 || i >= td->nwords)
+		return -1;
+
+	char word[td->maxlen + 1];
+	int block = i / TERMDICT_BLOCK;
+	const uint8_t *p = td->data + td->blocks[block];
+	size_t wlen = 0;
+	for (int j = block * TERMDICT_BLOCK; j <= i; j++){
+		size_t shared = 0;
+		if (j > block * TERMDICT_BLOCK)
+			p = get_varint(p, &shared);
+		size_t suffix = strlen((const char*)p);
+		memcpy(word + shared, p, suffix + 1);
+		p += suffix + 1;
+		wlen = shared + suffix;
+	}
+	if (wlen + 1 > len)
+		return -1;
+	memcpy(buf, word, wlen + 1);
+	return (int)wlen;
+}
+
+size_t termdictbytes(termdict_t *tp){
+	td_t *td = (td_t*)tp;
+	if (td == NULL)
+		return 0;
+	return sizeof(td_t) + td->size + td->nblocks * sizeof(size_t);
+}
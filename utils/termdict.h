@@ -0,0 +1,50 @@
+#pragma once
+/*
+ * termdict.h -- public interface to a front-coded term dictionary
+ *
+ * Author: Ian Kamweru, Abdibaset Bare, Nathaniel Mensah
+ * Version: 1.0
+ *
+ * Description: a dictionary numbers a sorted list of distinct words
+ * 0, 1, 2, ... and stores them front coded: words are grouped in
+ * blocks of TERMDICT_BLOCK, the first word of a block is kept whole
+ * and every other word as the length of the prefix it shares with the
+ * word before it followed by the rest of it. Only the offset of each
+ * block is kept besides, so a word is found by binary search over the
+ * first words of the blocks and decoding a single block. A dictionary
+ * never changes once built, so any number of threads may read it.
+ */
+#include <stdint.h>
+#include <stdlib.h>
+
+#define TERMDICT_BLOCK 16    // words per block
+
+/* the dictionary representation is hidden from users of the module */
+typedef void termdict_t;
+
+/* termdictbuild -- builds a dictionary of the n words, which must be
+ * sorted (by strcmp) and distinct
+ * returns: non-NULL for success; NULL otherwise
+ */
+termdict_t *termdictbuild(char **words, int n);
+
+/* termdictclose -- frees a dictionary */
+void termdictclose(termdict_t *td);
+
+/* termdictfind -- the number of word; -1 if it is not in the dictionary */
+int termdictfind(termdict_t *td, const char *word);
+
+/* termdictprefix -- the words starting with prefix, which are numbered
+ * consecutively; *first is set to the number of the first of them
+ * returns: the number of such words
+ */
+int termdictprefix(termdict_t *td, const char *prefix, int *first);
+
+/* termdictword -- decodes word number i into buf, of size len
+ * returns: the length of the word; -1 if there is no word i or it does
+ * not fit in buf
+ */
+int termdictword(termdict_t *td, int i, char *buf, size_t len);
+
+/* termdictbytes -- the heap bytes held by the dictionary */
+size_t termdictbytes(termdict_t *td);
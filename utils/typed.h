@@ -0,0 +1,313 @@
+#pragma once
+/*
+ * typed.h -- type-specialized vectors, queues and hash maps
+ *
+ * Author: Ian Kamweru, Abdibaset Bare, Nathaniel Mensah
+ * Version: 1.0
+ *
+ * Description: each macro expands to a struct and a family of static
+ * inline functions for one element type, or one key and value type.
+ * Elements are stored by value in a single array, and the hash and
+ * equality of a map are macros or inline functions named when the map
+ * is declared, so the compiler inlines them where queue.h and hash.h
+ * go through a node per element and a search callback per comparison.
+ *
+ *   TYPED_VECTOR(ids, int)     declares ids_t, ids_push, ids_free
+ *   TYPED_QUEUE(pages, webpage_t*)
+ *                              declares pages_t, pages_put, pages_get,
+ *                              pages_append, pages_size, pages_at,
+ *                              pages_sort, pages_free: a FIFO over a
+ *                              ring buffer
+ *   TYPED_MAP(words, char*, entry_t*, typed_strhash, typed_streq)
+ *                              declares words_t, words_find,
+ *                              words_insert, words_remove, words_next,
+ *                              words_clear, words_free
+ *
+ * A zero-initialized struct is an empty container; the containers own
+ * their arrays but not what the elements point to.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hash.h"
+
+#define TYPED_MIN_SLOTS 16
+
+/* a string under hash_wy, seeded once per process (see hash.h) so that
+ * caches keyed by what clients send cannot be fed colliding keys */
+static inline uint32_t typed_strhash(const char *key){
+	return (uint32_t)hash_wy(key, (int)strlen(key), hash_process_seed());
+}
+
+static inline bool typed_streq(const char *a, const char *b){
+	return strcmp(a, b) == 0;
+}
+
+/* the finalizer of MurmurHash3, which spreads every bit of an int */
+static inline uint32_t typed_inthash(int key){
+	uint32_t h = (uint32_t)key;
+	h ^= h >> 16;
+	h *= 0x85ebca6bu;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35u;
+	h ^= h >> 16;
+	return h;
+}
+
+static inline bool typed_inteq(int a, int b){
+	return a == b;
+}
+
+/* a growable array: items[0] to items[count-1] */
+#define TYPED_VECTOR(name, T)                                               \
+typedef struct name {                                                       \
+	T *items;                                                               \
+	int count;                                                              \
+	int size;                                                               \
+} name##_t;                                                                 \
+                                                                            \
+/* appends item; returns 0 for success, nonzero otherwise */               \
+static inline int32_t name##_push(name##_t *v, T item){                     \
+	if (v->count == v->size){                                               \
+		int size = v->size ? 2 * v->size : TYPED_MIN_SLOTS;                 \
+		T *items = realloc(v->items, size * sizeof(T));                     \
+		if (items == NULL)                                                  \
+			return -1;                                                      \
+		v->items = items;                                                   \
+		v->size = size;                                                     \
+	}                                                                       \
+	v->items[v->count++] = item;                                            \
+	return 0;                                                               \
+}                                                                           \
+                                                                            \
+static inline void name##_free(name##_t *v){                                \
+	free(v->items);                                                         \
+	v->items = NULL;                                                        \
+	v->count = v->size = 0;                                                 \
+}
+
+/* a FIFO queue: count items from items[head], wrapping around. The
+ * i-th item from the front is read in place, so positions 0 to
+ * name_size()-1 serve as a cursor; growing and sorting lay the items
+ * out from items[0] again, so sorting sees one run */
+#define TYPED_QUEUE(name, T)                                                \
+typedef struct name {                                                       \
+	T *items;                                                               \
+	int head;                                                               \
+	int count;                                                              \
+	int size;                                                               \
+} name##_t;                                                                 \
+                                                                            \
+/* moves the items to a new array of size slots, from slot 0 */             \
+static inline int32_t name##_relayout(name##_t *q, int size){               \
+	T *items = malloc(size * sizeof(T));                                    \
+	if (items == NULL)                                                      \
+		return -1;                                                          \
+	for (int i = 0; i < q->count; i++)                                      \
+		items[i] = q->items[(q->head + i) % q->size];                       \
+	free(q->items);                                                         \
+	q->items = items;                                                       \
+	q->head = 0;                                                            \
+	q->size = size;                                                         \
+	return 0;                                                               \
+}                                                                           \
+                                                                            \
+/* makes room for n more items */                                           \
+static inline int32_t name##_reserve(name##_t *q, int n){                   \
+	if (q->count + n <= q->size)                                            \
+		return 0;                                                           \
+	int size = q->size ? q->size : TYPED_MIN_SLOTS;                         \
+	while (size < q->count + n)                                             \
+		size *= 2;                                                          \
+	return name##_relayout(q, size);                                        \
+}                                                                           \
+                                                                            \
+/* puts item at the back; returns 0 for success, nonzero otherwise */       \
+static inline int32_t name##_put(name##_t *q, T item){                      \
+	if (name##_reserve(q, 1) != 0)                                          \
+		return -1;                                                          \
+	q->items[(q->head + q->count++) % q->size] = item;                      \
+	return 0;                                                               \
+}                                                                           \
+                                                                            \
+/* puts the n items at the back, in order; returns 0 for success,           \
+ * nonzero otherwise (nothing is put) */                                    \
+static inline int32_t name##_append(name##_t *q, T const *items, int n){    \
+	if (n < 0 || name##_reserve(q, n) != 0)                                 \
+		return -1;                                                          \
+	for (int i = 0; i < n; i++)                                             \
+		q->items[(q->head + q->count++) % q->size] = items[i];              \
+	return 0;                                                               \
+}                                                                           \
+                                                                            \
+/* takes the item at the front into *item; false if the queue is empty */   \
+static inline bool name##_get(name##_t *q, T *item){                        \
+	if (q->count == 0)                                                      \
+		return false;                                                       \
+	*item = q->items[q->head];                                              \
+	q->head = (q->head + 1) % q->size;                                      \
+	q->count--;                                                             \
+	return true;                                                            \
+}                                                                           \
+                                                                            \
+static inline int name##_size(name##_t *q){                                 \
+	return q->count;                                                        \
+}                                                                           \
+                                                                            \
+/* the i-th item from the front, left in the queue; NULL if i is not        \
+ * in 0 to name_size()-1 */                                                 \
+static inline T *name##_at(name##_t *q, int i){                             \
+	if (i < 0 || i >= q->count)                                             \
+		return NULL;                                                        \
+	return &q->items[(q->head + i) % q->size];                              \
+}                                                                           \
+                                                                            \
+/* sorts the queue in place, front first; cmp compares two pointers to      \
+ * items, as qsort would; returns 0 for success, nonzero otherwise (the     \
+ * queue is unchanged) */                                                   \
+static inline int32_t name##_sort(name##_t *q,                              \
+		int (*cmp)(const void*, const void*)){                              \
+	if (q->count < 2)                                                       \
+		return 0;                                                           \
+	if (q->head + q->count > q->size && name##_relayout(q, q->size) != 0)   \
+		return -1;                                                          \
+	qsort(q->items + q->head, q->count, sizeof(T), cmp);                    \
+	return 0;                                                               \
+}                                                                           \
+                                                                            \
+static inline void name##_free(name##_t *q){                                \
+	free(q->items);                                                         \
+	q->items = NULL;                                                        \
+	q->head = q->count = q->size = 0;                                       \
+}
+
+/* a hash map with open addressing and linear probing; the hash of
+ * every key is kept in its slot, 0 marking an empty one, so probes
+ * compare keys only when the hashes match and growing never rehashes
+ * a key. The table is at most half full. */
+#define TYPED_MAP(name, K, V, hashfn, eqfn)                                 \
+typedef struct name##_slot {                                                \
+	uint32_t hash;                                                          \
+	K key;                                                                  \
+	V value;                                                                \
+} name##_slot_t;                                                            \
+                                                                            \
+typedef struct name {                                                       \
+	name##_slot_t *slots;                                                   \
+	int count;                                                              \
+	int size;        /* a power of two, or 0 */                            \
+} name##_t;                                                                 \
+                                                                            \
+static inline uint32_t name##_hash(K key){                                  \
+	uint32_t h = hashfn(key);                                               \
+	return h ? h : 1;                                                       \
+}                                                                           \
+                                                                            \
+/* the slot holding key, or the empty slot where it would go */            \
+static inline name##_slot_t *name##_lookup(name##_t *m, K key, uint32_t h){ \
+	uint32_t mask = m->size - 1;                                            \
+	for (uint32_t i = h & mask;; i = (i + 1) & mask){                       \
+		name##_slot_t *s = &m->slots[i];                                    \
+		if (s->hash == 0 || (s->hash == h && eqfn(s->key, key)))            \
+			return s;                                                       \
+	}                                                                       \
+}                                                                           \
+                                                                            \
+static inline int32_t name##_grow(name##_t *m){                             \
+	int size = m->size ? 2 * m->size : TYPED_MIN_SLOTS;                     \
+	name##_slot_t *slots = calloc(size, sizeof(name##_slot_t));             \
+	if (slots == NULL)                                                      \
+		return -1;                                                          \
+	for (int i = 0; i < m->size; i++){                                      \
+		if (m->slots[i].hash == 0)                                          \
+			continue;                                                       \
+		uint32_t j = m->slots[i].hash & (size - 1);                         \
+		while (slots[j].hash != 0)                                          \
+			j = (j + 1) & (size - 1);                                       \
+		slots[j] = m->slots[i];                                             \
+	}                                                                       \
+	free(m->slots);                                                         \
+	m->slots = slots;                                                       \
+	m->size = size;                                                         \
+	return 0;                                                               \
+}                                                                           \
+                                                                            \
+/* the value of key; NULL if key is not in the map */                      \
+static inline V *name##_find(name##_t *m, K key){                           \
+	if (m->count == 0)                                                      \
+		return NULL;                                                        \
+	name##_slot_t *s = name##_lookup(m, key, name##_hash(key));             \
+	return s->hash ? &s->value : NULL;                                      \
+}                                                                           \
+                                                                            \
+/* the value of key, added zeroed if key was not in the map; *found, if   \
+ * found is not NULL, tells which. returns: NULL if out of memory */       \
+static inline V *name##_insert(name##_t *m, K key, bool *found){            \
+	if (2 * (m->count + 1) > m->size && name##_grow(m) != 0)                \
+		return NULL;                                                        \
+	uint32_t h = name##_hash(key);                                          \
+	name##_slot_t *s = name##_lookup(m, key, h);                            \
+	if (found)                                                              \
+		*found = s->hash != 0;                                              \
+	if (s->hash == 0){                                                      \
+		s->hash = h;                                                        \
+		s->key = key;                                                       \
+		memset(&s->value, 0, sizeof(V));                                    \
+		m->count++;                                                         \
+	}                                                                       \
+	return &s->value;                                                       \
+}                                                                           \
+                                                                            \
+/* removes key, moving back the slots probed past it; the key and value   \
+ * removed are stored in *keyp and *valuep if those are not NULL          \
+ * returns: false if key was not in the map */                             \
+static inline bool name##_remove(name##_t *m, K key, K *keyp, V *valuep){   \
+	if (m->count == 0)                                                      \
+		return false;                                                       \
+	name##_slot_t *s = name##_lookup(m, key, name##_hash(key));             \
+	if (s->hash == 0)                                                       \
+		return false;                                                       \
+	if (keyp)                                                               \
+		*keyp = s->key;                                                     \
+	if (valuep)                                                             \
+		*valuep = s->value;                                                 \
+	uint32_t mask = m->size - 1, i = s - m->slots, j = i;                   \
+	while (true){                                                           \
+		j = (j + 1) & mask;                                                 \
+		if (m->slots[j].hash == 0)                                          \
+			break;                                                          \
+		uint32_t home = m->slots[j].hash & mask;                            \
+		/* slot j stays if its home lies cyclically in (i, j] */           \
+		if (i <= j ? (i < home && home <= j) : (i < home || home <= j))     \
+			continue;                                                       \
+		m->slots[i] = m->slots[j];                                          \
+		i = j;                                                              \
+	}                                                                       \
+	m->slots[i].hash = 0;                                                   \
+	m->count--;                                                             \
+	return true;                                                            \
+}                                                                           \
+                                                                            \
+/* the next slot in use at or after slot *i, advancing *i past it; NULL   \
+ * after the last. Walks the map from *i = 0, in no particular order */    \
+static inline name##_slot_t *name##_next(name##_t *m, int *i){              \
+	for (; *i < m->size; (*i)++){                                           \
+		if (m->slots[*i].hash != 0)                                         \
+			return &m->slots[(*i)++];                                       \
+	}                                                                       \
+	return NULL;                                                            \
+}                                                                           \
+                                                                            \
+/* empties the map, keeping its slots */                                   \
+static inline void name##_clear(name##_t *m){                               \
+	if (m->size > 0)                                                        \
+		memset(m->slots, 0, m->size * sizeof(name##_slot_t));              \
+	m->count = 0;                                                           \
+}                                                                           \
+                                                                            \
+static inline void name##_free(name##_t *m){                                \
+	free(m->slots);                                                         \
+	m->slots = NULL;                                                        \
+	m->count = m->size = 0;                                                 \
+}
@@ -17,6 +17,8 @@
 #include <string.h>
 #include <ctype.h>
 #include <unistd.h>
+#include <stdint.h>
+#include <pthread.h>
 #include <curl/curl.h>
 #include <webpage.h>
 
@@ -43,9 +45,9 @@ struct URL {
 
 /* Private function prototypes */
 static char *RemoveDotSegments(char *input);
-static void RemoveWhitespace(char* str);
 static int ParseURL(char* str, struct URL* url);
 static char *FixupRelativeURL(char *base, char *rel, size_t len);
+static char *MakeLinkURL(char *base, const char *href, const char *end);
 static void *checkp(void *p, char *message);
 
 /* Private global variables */
@@ -88,6 +90,177 @@ void webpage_delete(void *data)
   }
 }
 
+/**************** webpage_getWords ****************/
+/*
+ * webpage_getWords - returns the next words from doc[*pos] as slices
+ * See "webpage.h" for full documentation.
+ *
+ * The html is classified a block of BLOCK bytes at a time into bit
+ * masks of its letters, '<', '>' and '\0', with SSE2 or AVX2 where
+ * the processor has them; lowercasing is a byte OR of 0x20 with the
+ * letter mask, done and stored in the same pass. The scan then jumps
+ * from one boundary to the next with a count of trailing zeros:
+ *     1. outside words, to the next letter, '<' or '\0'
+ *     2. in a tag, to the next '>' or '\0'
+ *     3. in a word, to the next non-letter
+ * so the cost per block is that of its words and tags, not its bytes.
+ * As in webpage_getNextWord, a letter is an ASCII letter, and a '<'
+ * opens a tag only between words.
+ */
+#define BLOCK 32
+
+typedef struct classes {
+  uint32_t alpha, lt, gt, nul;          // bit i for byte i of the block
+} classes_t;
+
+enum { IN_TEXT, IN_TAG, IN_WORD };
+
+static void classify_scalar(const char *p, char *lower, classes_t *c) {
+  c->alpha = c->lt = c->gt = c->nul = 0;
+  for (int i = 0; i < BLOCK; i++) {
+    unsigned char ch = p[i];
+    uint32_t bit = (uint32_t)1 << i;
+    if ((unsigned char)((ch | 0x20) - 'a') < 26) {
+      c->alpha |= bit;
+      ch |= 0x20;
+    }
+    else if (ch == '<')
+      c->lt |= bit;
+    else if (ch == '>')
+      c->gt |= bit;
+    else if (ch == '\0')
+      c->nul |= bit;
+    if (lower != NULL)
+      lower[i] = ch;
+  }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86 1
+
+static void classify_sse2(const char *p, char *lower, classes_t *c) {
+  const __m128i case_bit = _mm_set1_epi8(0x20), a = _mm_set1_epi8('a');
+  const __m128i z = _mm_set1_epi8(25), lt = _mm_set1_epi8('<');
+  const __m128i gt = _mm_set1_epi8('>'), nul = _mm_setzero_si128();
+  c->alpha = c->lt = c->gt = c->nul = 0;
+  for (int h = 0; h < BLOCK; h += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(p + h));
+    __m128i folded = _mm_sub_epi8(_mm_or_si128(v, case_bit), a);
+    __m128i alpha = _mm_cmpeq_epi8(_mm_min_epu8(folded, z), folded);
+    if (lower != NULL)
+      _mm_storeu_si128((__m128i*)(lower + h), _mm_or_si128(v, _mm_and_si128(alpha, case_bit)));
+    c->alpha |= (uint32_t)_mm_movemask_epi8(alpha) << h;
+    c->lt |= (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, lt)) << h;
+    c->gt |= (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, gt)) << h;
+    c->nul |= (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, nul)) << h;
+  }
+}
+
+__attribute__((target("avx2")))
+static void classify_avx2(const char *p, char *lower, classes_t *c) {
+  const __m256i case_bit = _mm256_set1_epi8(0x20);
+  __m256i v = _mm256_loadu_si256((const __m256i*)p);
+  __m256i folded = _mm256_sub_epi8(_mm256_or_si256(v, case_bit), _mm256_set1_epi8('a'));
+  __m256i alpha = _mm256_cmpeq_epi8(_mm256_min_epu8(folded, _mm256_set1_epi8(25)), folded);
+  if (lower != NULL)
+    _mm256_storeu_si256((__m256i*)lower, _mm256_or_si256(v, _mm256_and_si256(alpha, case_bit)));
+  c->alpha = _mm256_movemask_epi8(alpha);
+  c->lt = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('<')));
+  c->gt = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('>')));
+  c->nul = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_setzero_si256()));
+}
+#endif
+
+typedef void (*classifier_t)(const char *p, char *lower, classes_t *c);
+static classifier_t classify_block = classify_scalar;
+static pthread_once_t classify_once = PTHREAD_ONCE_INIT;
+
+static void pick_classifier(void) {
+#ifdef HAVE_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    classify_block = classify_avx2;
+  else if (__builtin_cpu_supports("sse2"))
+    classify_block = classify_sse2;
+#endif
+}
+
+/* the first set bit of mask at or above bit i, or BLOCK if none */
+static inline int next_bit(uint32_t mask, int i) {
+  mask = i < BLOCK ? mask & ~(((uint32_t)1 << i) - 1) : 0;
+  return mask ? __builtin_ctz(mask) : BLOCK;
+}
+
+int webpage_getWords(webpage_t *page, int *pos, wordslice_t *slices, int max, char *lower) {
+  if (page == NULL || page->html == NULL || pos == NULL || *pos < 0 ||
+      slices == NULL || max <= 0) {
+    return -1;
+  }
+  pthread_once(&classify_once, pick_classifier);
+
+  const char *doc = page->html;
+  int size = page->html_len + 1;        // the html and its '\0'
+  int state = IN_TEXT, start = 0, n = 0;
+  char tail[BLOCK], tail_lower[BLOCK];
+  classes_t c;
+
+  for (int base = *pos; base < size; base += BLOCK) {
+    // the last block is copied out, padded with '\0'
+    if (base + BLOCK <= size) {
+      classify_block(doc + base, lower ? lower + base : NULL, &c);
+    } else {
+      memset(tail, 0, BLOCK);
+      memcpy(tail, doc + base, size - base);
+      classify_block(tail, lower ? tail_lower : NULL, &c);
+      if (lower != NULL)
+        memcpy(lower + base, tail_lower, size - base);
+    }
+
+    for (int i = 0, j; i < BLOCK; ) {
+      if (state == IN_WORD) {
+        if ((j = next_bit(~c.alpha, i)) == BLOCK)
+          break;
+        slices[n].offset = start;
+        slices[n].len = base + j - start;
+        if (lower != NULL)
+          lower[base + j] = '\0';
+        state = IN_TEXT;
+        i = j;                          // the byte after may open a tag
+        if (++n == max) {
+          *pos = base + j;
+          return n;
+        }
+      } else if (state == IN_TAG) {
+        if ((j = next_bit(c.gt | c.nul, i)) == BLOCK)
+          break;
+        if (c.nul & ((uint32_t)1 << j)) {
+          *pos = base + j;              // out of html; rest on the '\0'
+          return n;
+        }
+        state = IN_TEXT;
+        i = j + 1;
+      } else {
+        if ((j = next_bit(c.alpha | c.lt | c.nul, i)) == BLOCK)
+          break;
+        if (c.nul & ((uint32_t)1 << j)) {
+          *pos = base + j;              // out of html; rest on the '\0'
+          return n;
+        }
+        if (c.lt & ((uint32_t)1 << j)) {
+          state = IN_TAG;
+        } else {
+          state = IN_WORD;
+          start = base + j;
+        }
+        i = j + 1;
+      }
+    }
+  }
+  *pos = size - 1;
+  return n;
+}
+
 /**************** webpage_getNextWord ****************/
 /*
  * webpage_getNextWord - returns the next word from doc[pos] into word
@@ -96,13 +269,10 @@ void webpage_delete(void *data)
  *   cleaned by David Kotz in April 2016, 2017.
  *
  * Pseudocode:
- *     1. skip any leading non-alphabetic characters
- *     2. if we find a tag, i.e., <...tag...>, skip that tag
- *     3. save beginning of the word
- *     4. find the end, i.e., first non-alphabetic character
- *     5. create a new word buffer
- *     6. copy the word into the new buffer
- *     7. return first position past end of word
+ *     1. find the next word with webpage_getWords
+ *     2. create a new word buffer
+ *     3. copy the word into the new buffer
+ *     4. return first position past end of word
  * 
  */
 int webpage_getNextWord(webpage_t *page, int pos, char **word) {
@@ -111,57 +281,132 @@ int webpage_getNextWord(webpage_t *page, int pos, char **word) {
     return -1;
   }
 
-  const char *doc = page->html;		   // the html document
-  const char *beg;                         // beginning of word
-  const char *end;                         // end of word
-
-  // consume any non-alphabetic characters
-  while (doc[pos] != '\0' && !isalpha(doc[pos])) {
-    // if we find a tag, i.e., <...tag...>, skip it
-    if (doc[pos] == '<') {
-      end = strchr(&doc[pos], '>');    // find the close
-			/* ST: end is a pointer -- cant compare to a char */
-      if(*end == '\0' || *(++end) == '\0') { // ran out of html
-				return -1;
-      }
-      pos = end - doc;	      // skip over the <...tag...>
-    } else {
-      pos++;		      // just move forward
-    }
+  wordslice_t slice;
+  *word = NULL;
+  if (webpage_getWords(page, &pos, &slice, 1, NULL) != 1) {
+    return -1;                          // ran out of html
   }
 
-  // ran out of html
-  if (doc[pos] == '\0') {
-    *word = NULL;
+  // allocate space for length of new word + '\0'
+  *word = calloc(slice.len + 1, sizeof(char));
+  if (*word == NULL) {	      // out of memory!
     return -1;
   }
 
-  // pos is at the first character of a word
-  beg = &(doc[pos]);
+  // copy the new word
+  memcpy(*word, &page->html[slice.offset], slice.len);
+
+  return pos;
+}
 
-  // consume word
-  while (doc[pos] != '\0' && isalpha(doc[pos])) {
-    pos++;
+/**************** webpage_getURLs ****************/
+/*
+ * webpage_getURLs - returns the next urls from html[*pos]
+ * See "webpage.h" for full documentation.
+ *
+ * One forward pass over the html, which is left as it is:
+ *     1. in text, skip to the next '<'
+ *     2. skip a comment <!-- ... --> whole, and any other tag that
+ *        does not start with a letter (</a>, <!DOCTYPE ...>) to its '>';
+ *        a '<' followed by anything else is text
+ *     3. read the tag name, then each attribute: a name, optionally
+ *        '=' and a value quoted with ' or " (which may hold a '>'), or
+ *        bare up to whitespace or '>', until the '>' ending the tag
+ *     4. the first href of an <a> tag is a link (see MakeLinkURL)
+ * Tags are read to their end, so *pos always rests between tags.
+ */
+int webpage_getURLs(webpage_t *page, int *pos, char **urls, int max) {
+  // make sure we have text, a base url, and room for the results
+  if (page == NULL || page->html == NULL || page->url == NULL ||
+      pos == NULL || *pos < 0 || urls == NULL || max <= 0) {
+    return -1;
   }
-  // at this point, doc[pos] is the first character *after* the word.
 
-  // pos refers to the last character of the word
-  end = &(doc[pos-1]);
+  const char *html = page->html;           // the html document
+  const char *p = html + *pos;             // the next byte to look at
+  const char *lt = NULL;                   // the '<' opening a tag
+  int n = 0;                               // urls found
+
+  while (n < max && (lt = strchr(p, '<')) != NULL) {
+    p = lt + 1;
+    if (strncmp(p, "!--", 3) == 0) {       // comment
+      const char *close = strstr(p + 3, "-->");
+      p = close ? close + 3 : p + strlen(p);
+      continue;
+    }
+    if (*p == '/' || *p == '!' || *p == '?') {  // end tag, doctype, ...
+      const char *close = strchr(p, '>');
+      p = close ? close + 1 : p + strlen(p);
+      continue;
+    }
+    if (!isalpha((unsigned char)*p)) {    // not a tag: "a < b"
+      continue;
+    }
+
+    // the tag name
+    const char *name = p;
+    while (isalnum((unsigned char)*p)) {
+      p++;
+    }
+    bool anchor = (p - name == 1 && tolower((unsigned char)*name) == 'a');
+    bool linked = false;                   // seen its href yet?
+
+    // the attributes, up to the end of the tag
+    while (*p != '\0' && *p != '>') {
+      if (isspace((unsigned char)*p) || *p == '/') {
+        p++;
+        continue;
+      }
+      const char *attr = p;
+      while (*p != '\0' && *p != '>' && *p != '=' && *p != '/' &&
+             !isspace((unsigned char)*p)) {
+        p++;
+      }
+      size_t attrlen = p - attr;
+      while (isspace((unsigned char)*p)) {
+        p++;
+      }
+      if (*p != '=') {                     // no value
+        continue;
+      }
+      p++;
+      while (isspace((unsigned char)*p)) {
+        p++;
+      }
 
-  // 'beg' points to first character of the word
-  // 'end' points to last character of the word
-  int wordlen = end - beg + 1;
+      const char *value = p, *end;         // the value is [value, end)
+      if (*p == '"' || *p == '\'') {       // href="url" or href='url'
+        char delim = *p++;
+        value = p;
+        while (*p != '\0' && *p != delim) {
+          p++;
+        }
+        end = p;
+        if (*p != '\0') {
+          p++;
+        }
+      } else {                             // href=url
+        while (*p != '\0' && *p != '>' && !isspace((unsigned char)*p)) {
+          p++;
+        }
+        end = p;
+      }
 
-  // allocate space for length of new word + '\0'
-  *word = calloc(wordlen + 1, sizeof(char));
-  if (*word == NULL) {	      // out of memory!
-    return -1;
+      if (anchor && !linked && attrlen == 4 && strncasecmp(attr, "href", 4) == 0) {
+        linked = true;
+        if ((urls[n] = MakeLinkURL(page->url, value, end)) != NULL) {
+          n++;
+        }
+      }
+    }
+    if (*p == '>') {
+      p++;
+    }
   }
 
-  // copy the new word
-  strncpy(*word, beg, wordlen);
-
-  return pos;
+  // out of html, or out of room after a tag
+  *pos = (lt ? p : p + strlen(p)) - html;
+  return n;
 }
 
 /**************** webpage_getNextURL ****************/
@@ -175,120 +420,20 @@ int webpage_getNextWord(webpage_t *page, int pos, char **word) {
  *
  * Pseudocode:
  *     1. check arguments
- *     2. if pos = 0: remove whitespace from html
- *     3. find hyperlink starting tags "<a" or "<A"
- *     4. find next href attribute "href="
- *     5. find next end tag ">"
- *     6. check that href comes before end tag
- *     7. deal with quoted and unquoted urls
- *     8. determine if url is absolute
- *     9. fixup relative links
- *    10. create new character buffer for result and return it
+ *     2. find the next url with webpage_getURLs
+ *     3. return the position past its tag
  */
 int webpage_getNextURL(webpage_t *page, int pos, char **result) {
   // make sure we have text and base url
-  if (page == NULL || page->html == NULL || page->url == NULL) {
+  if (page == NULL || page->html == NULL || page->url == NULL || result == NULL) {
     return -1;
   }
 
-  char *html = page->html;                 // the html document
-  char *base_url = page->url;		   // the base URL for this html
-  int bad_link;                            // is this link ill formatted?
-  int relative;                            // is this link relative?
-  char delim;                              // url delimiter: ' ', ''', '"'
-  char *lnk;                               // hyperlink tags
-  char *href;                              // href in a tag
-  char *end;                               // end of hyperlink tag or url
-  char *ptr;                               // absolute vs. relative
-  char *hash;                              // hash mark character
-
-  // condense html, makes parsing easier
-  if (pos == 0) {
-    RemoveWhitespace(html);
+  if (webpage_getURLs(page, &pos, result, 1) != 1) {
+    *result = NULL;                        // no more links on this page
+    return -1;
   }
-
-  // parse for hyperlinks
-  do {
-    relative = 0;                        // assume absolute link
-    bad_link = 0;                        // assume valid link
-
-    // find tag "<a" or "<A""
-    lnk = strcasestr(&html[pos], "<a");
-
-    // no more links on this page
-    if (!lnk) { result = NULL; return -1; }
-
-
-    // find next href after hyperlink tag
-    href = strcasestr(lnk, "href=");
-
-    // no more links on this page
-    if (!href) { result = NULL; return -1; }
-
-    // find end of hyperlink tag
-    end = strchr(lnk, '>');
-
-    // if the href we have is outside the current tag, continue
-    if (end && (end < href)) {
-      bad_link = 1; pos+=2; continue;
-    }
-
-    // move href to beginning of url
-    href+=5;
-
-    // something went wrong, just continue
-    if (!href) { bad_link=1; pos+=2; continue; }
-
-    // is the url quoted?
-    if (*href == '\'' || *href == '"') {  // yes, href="url" or href='url'
-      delim = *(href++);               // remember delimiter
-      end = strchr(href, delim);       // find next of same delimiter
-    } else {			       // no, href=url
-      end = strchr(href, '>');         // hope: <a ... href=url>
-      // since we've stripped whitespace
-      // this could mangle things like:
-      // <a ... href=url name=val>
-    }
-
-    // if there is a # before the end of the url, exclude the #fragment
-    hash = strchr(href, '#');
-    if (hash && hash < end) {
-      end = hash;
-    }
-
-    // if we don't know where to end the url, continue
-    if (!end) {
-      bad_link = 1; pos += 2; continue;
-    }
-
-    // have a link now
-    if (*href == '#') {                   // internal reference
-      bad_link = 1; pos += 2; continue;
-    }
-
-    // is the url absolute, i.e, ':' must precede any '/', '?', or '#'
-    ptr = strpbrk(href, ":/?#");
-    if (!ptr || *ptr != ':') { 
-      relative = 1; 
-    } else if (strncasecmp(href, "http", 4)) { // absolute, but not http(s)
-      bad_link = 1; pos += 2; continue;
-    }
-  } while (bad_link);                       // keep parsing
-
-  // have a good link now
-  if (relative) {                           // need to fixup relative links
-    *result = FixupRelativeURL(base_url, href, end - href);
-    if (!*result) { return -2; }
-  }
-	else {
-    // create new buffer
-    *result = calloc(end-href+1, sizeof(char));
-    if (!*result) { return -2; }          // check memory
-    // copy over absolute url
-    strncpy(*result, href, end - href);
-  }
-  // return position at the end of the url
-  return end - html;
+  return pos;
 }
 
 /******************** NormalizeURL *******************************/
@@ -851,26 +996,49 @@ static char *FixupRelativeURL(char *base, char *rel, size_t len)
 
 /* ***************************************************************** */
 /*
- * RemoveWhitespace - removes whitespace from str
- * @str: char buffer to modify
+ * MakeLinkURL - makes the url of a link from its href value
+ * @base: base url to resolve relative links from
+ * @href: the value of the href attribute, not '\0' terminated
+ * @end: the end of the value
  *
- * Eliminates whitespace by shifting and condensing all the non-whitespace
- * toward the beginning of the buffer. This does not alter the size of the
- * buffer.
+ * Surrounding whitespace and any #fragment are dropped. Returns a newly
+ * allocated absolute url, or NULL if the link is empty, only a
+ * #fragment, absolute but not http(s), or cannot be resolved.
  *
  * Should have no use outside of this file, thus declared static.
  */
-static void RemoveWhitespace(char* str)
+static char *MakeLinkURL(char *base, const char *href, const char *end)
 {
-  char *prev;                              // previous whitespace
-  char *cur;                               // current non-whitespace
+  const char *hash;                        // hash mark character
+  const char *ptr;                         // absolute vs. relative
+  char *url;
 
-  // start at beginning of str
-  cur = prev = str;
+  while (href < end && isspace((unsigned char)*href)) href++;
+  while (end > href && isspace((unsigned char)end[-1])) end--;
 
-  do {
-    while (isspace(*cur)) cur++;          // consume any whitespace
-  } while ((*prev++ = *cur++));            // condense to front of str
+  // exclude the #fragment; nothing left is an internal reference
+  if ((hash = memchr(href, '#', end - href)) != NULL) {
+    end = hash;
+  }
+  if (end == href) {
+    return NULL;
+  }
+
+  // is the url absolute, i.e, ':' must precede any '/' or '?'
+  for (ptr = href; ptr < end && *ptr != ':' && *ptr != '/' && *ptr != '?'; ptr++)
+    ;
+  if (ptr == end || *ptr != ':') {         // relative: fix it up
+    return FixupRelativeURL(base, (char*)href, end - href);
+  }
+  if (end - href < 4 || strncasecmp(href, "http", 4)) {
+    return NULL;                           // absolute, but not http(s)
+  }
+
+  url = calloc(end - href + 1, sizeof(char));
+  if (url) {
+    memcpy(url, href, end - href);
+  }
+  return url;
 }
 
 /**************** checkp ****************/
@@ -925,7 +1093,7 @@ static size_t WriteMemoryCallback(void *contents, size_t size, size_t nmemb, voi
  */
 bool webpage_fetch(webpage_t *page) {
   const int MAX_TRY = 3;               // maximum attempts to fetch
-  static char errbuf[CURL_ERROR_SIZE]; // buffer for error messages
+  char errbuf[CURL_ERROR_SIZE];        // buffer for error messages
   int tries = 0;		       // number of attempts at curl
   bool status = true;		       // return value
   CURL* curl_handle;		       // curl handle
@@ -980,9 +1148,19 @@ bool webpage_fetch(webpage_t *page) {
 
   // cleanup curl stuff
   curl_easy_cleanup(curl_handle);
-  curl_global_cleanup();
 
   return status;
 }
 
+/* ************* webpage_init / webpage_cleanup ******************** */
+/* see webpage.h for usage documentation.
+ */
+bool webpage_init(void) {
+  return curl_global_init(CURL_GLOBAL_DEFAULT) == CURLE_OK;
+}
+
+void webpage_cleanup(void) {
+  curl_global_cleanup();
+}
+
 
@@ -73,6 +73,20 @@ void webpage_delete(void *data);
  */
 bool webpage_fetch(webpage_t *page);
 
+/***************** webpage_init / webpage_cleanup ********************/
+/* set up and release the global state of the curl library
+ *
+ * webpage_init() must be called once, before any thread calls
+ * webpage_fetch(); webpage_cleanup() once, after every fetch is done.
+ * Neither may run concurrently with other webpage functions.
+ * webpage_fetch() itself keeps no shared state, so any number of
+ * threads may fetch at once between the two calls.
+ *
+ * Returns (webpage_init): true on success; false otherwise.
+ */
+bool webpage_init(void);
+void webpage_cleanup(void);
+
 
 /**************** webpage_getNextWord ***********************************/
 /* return the next word from html[pos] into word
@@ -90,6 +104,39 @@ bool webpage_fetch(webpage_t *page);
 
 int webpage_getNextWord(webpage_t *page, int pos, char **word);
 
+/**************** webpage_getWords ***************************************/
+/* return the next words from html[*pos], without copying them
+ * @page: pointer to the webpage info
+ * @pos: current position in html buffer, advanced past the last word
+ * @slices: filled with the (offset, length) of each word in the html
+ * @max: the room in slices
+ * @lower: NULL, or webpage_getHTMLlen(page)+1 bytes of scratch
+ *
+ * The words are those webpage_getNextWord returns. If lower is given,
+ * each word of the batch is also written there at its offset,
+ * lowercased and terminated with '\0', valid until the next call.
+ *
+ * Returns the number of words found, at most max; 0 once the html is
+ * exhausted; < 0 on bad arguments. *pos should be 0 on the first call.
+ *
+ * Usage example: (print the words of a page in lowercase)
+ * int pos = 0, n;
+ * wordslice_t slices[64];
+ * char *lower = malloc(webpage_getHTMLlen(page) + 1);
+ *
+ * while ((n = webpage_getWords(page, &pos, slices, 64, lower)) > 0) {
+ *     for (int i = 0; i < n; i++)
+ *         printf("Found word: %s\n", lower + slices[i].offset);
+ * }
+ * free(lower);
+ */
+typedef struct wordslice {
+  int offset;                   // of the first character in the html
+  int len;
+} wordslice_t;
+
+int webpage_getWords(webpage_t *page, int *pos, wordslice_t *slices, int max, char *lower);
+
 /****************** webpage_getNextURL ***********************************/
 /* return the next url from html[pos] into result
  * @page: pointer to the webpage info
@@ -104,7 +151,7 @@ int webpage_getNextWord(webpage_t *page, int pos, char **word);
  * buffer; may be NULL on failed return. The caller is responsible for free'ing
  * this memory.
  *
- * Side effect: the page's html will be compressed to remove white space.
+ * The urls are those webpage_getURLs returns, one at a time.
  *
  * Usage example: (retrieve all urls in a page)
  * int pos = 0;
@@ -116,9 +163,39 @@ int webpage_getNextWord(webpage_t *page, int pos, char **word);
  * }
  *
  */
-
 int webpage_getNextURL(webpage_t *page, int pos, char **result);
 
+/****************** webpage_getURLs **************************************/
+/* return the next urls from html[*pos]
+ * @page: pointer to the webpage info
+ * @pos: current position in html buffer, advanced past the last url
+ * @urls: filled with the urls found
+ * @max: the room in urls
+ *
+ * The urls are the first href of each <a> tag, in order, without any
+ * #fragment; relative ones are made absolute against the page url, and
+ * absolute ones that are not http(s) are left out. Tags in comments
+ * are not links, and quoted attribute values may hold a '>'.
+ *
+ * Returns the number of urls found, at most max; 0 once the html is
+ * exhausted; < 0 on bad arguments. *pos should be 0 on the first call.
+ * Each url is newly allocated; the caller is responsible for free'ing
+ * them. The html is not modified, and each call only reads on from
+ * *pos, so a page takes time linear in its length.
+ *
+ * Usage example: (retrieve all urls in a page)
+ * int pos = 0, n;
+ * char *urls[64];
+ *
+ * while ((n = webpage_getURLs(page, &pos, urls, 64)) > 0) {
+ *     for (int i = 0; i < n; i++) {
+ *         printf("Found url: %s\n", urls[i]);
+ *         free(urls[i]);
+ *     }
+ * }
+ */
+int webpage_getURLs(webpage_t *page, int *pos, char **urls, int max);
+
 /***********************************************************************
  * NormalizeURL - attempts to normalize the url
  * @url: absolute url to normalize